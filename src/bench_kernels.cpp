@@ -0,0 +1,588 @@
+// bench_kernels.cpp : Microbenchmarks of the helpers of utils.cpp and of each filter of filterhtml.
+//
+
+#include <stdio.h>
+#include <string>
+#include <iostream>     // std::cout
+#include <iomanip>      // std::setw
+#include <vector>
+#include <sstream>
+#include <algorithm>    // std::sort
+#include <chrono>
+
+#include "utils.h"
+#include "filters.h"
+#include "scan.h"
+#include "diff.h"
+
+// Number of measurements of each benchmark. The median is reported.
+static const size_t NUM_SAMPLES = 5;
+static double min_sample_time = 0.1; // in seconds
+
+// Prevents the compiler from removing the benchmarked code.
+static volatile size_t benchmark_sink = 0;
+
+struct Arguments {
+  std::string filter;
+  std::string min_time;
+  std::string output;
+  std::string scan;
+};
+
+// A function which runs one operation of a benchmark on the given fixture.
+typedef void (*BENCHMARK_FUNCTION)(const std::string & fixture);
+
+struct BENCHMARK {
+  std::string name;
+  const std::string * fixture;
+  BENCHMARK_FUNCTION function;
+};
+
+struct BENCHMARK_RESULT {
+  std::string name;
+  size_t bytes;         // size of the fixture
+  size_t iterations;    // number of operations of each sample
+  double ns_per_op;
+  double bytes_per_second;
+};
+
+//
+// Fixtures, based on the wordpress patterns described in filters.cpp.
+//
+
+static const std::string header_span_fixture = "# <span id=\"Introduction\">Introduction</span>\n";
+
+static const std::string custom_css_paragraph_fixture =
+  "<p class=\"postedit\">\n"
+  "  Source code is now moved to GitHub. Source code can be downloaded from [the project's GitHub page](http://github.com/end2endzone/msbuildreorder).\n"
+  "</p>\n";
+
+static const std::string justified_list_fixture =
+  "<ul>\n"
+  "  <li style=\"text-align: justify;\"><strong>Arduino</strong> tone() and delay() functions overrides.</li>\n"
+  "  <li style=\"text-align: justify;\">Play a melody with <em>non-blocking</em> functions.</li>\n"
+  "  <li>See <a href=\"http://www.end2endzone.com/nonblockingrtttl-a-non-blocking-arduino-library-for-playing-rtttl-melodies/\">NonBlockingRtttl</a> for details.</li>\n"
+  "</ul>\n";
+
+static const std::string wordpress_code_fixture =
+  "<pre class=\"wp-block-code\"><code>#include &lt;stdio.h&gt;\n"
+  "int main(int argc, char* argv[])\n"
+  "{\n"
+  "  printf(&quot;Hello World!\\n&quot;);\n"
+  "  return 0;\n"
+  "}</code></pre>\n";
+
+static const std::string markdown_characters_fixture =
+  "<p>&#35;1 is not a header.</p>\n"
+  "<p>&#45; This is not a list item, &#43; neither is this one.</p>\n"
+  "<p>&#33;&#91;This is not an image&#93;(http://www.end2endzone.com/)</p>\n";
+
+static const std::string crayon_fixture =
+  "<div class=\"crayon-line\">\n"
+  "  <pre class=\"lang:c++ decode:true\" title=\"Arduino tone and delay functions overrides\" data-url=\"http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino\">http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino</pre>\n"
+  "</div>\n";
+
+static const std::string gallery_fixture =
+  "<div id='gallery-22' class='gallery galleryid-1249 gallery-columns-3 gallery-size-thumbnail gallery1'>\n"
+  "  <dl class=\"gallery-item\">\n"
+  "    <dt class=\"gallery-icon\">\n"
+  "      <a href=\"http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png\" title=\"Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data\" rel=\"gallery1\"><img src=\"http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample-146x150.png\" width=\"146\" height=\"150\" alt=\"Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data\" /></a><span><a class=\"void\" href=\"http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png\" rel=\"nolightbox\" target=\"_blank\">498x510</a></span>\n"
+  "    </dt>\n"
+  "    <dd class=\"gallery-caption\" id=\"caption1519\">\n"
+  "      <span class=\"imagecaption\">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br /> <span class=\"imagedescription\">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br />\n"
+  "    </dd>\n"
+  "  </dl>\n"
+  "  <br style='clear: both' />\n"
+  "</div>\n";
+
+static const std::string table_fixture =
+  "<table>\n"
+  "  <tr class=\"header\">\n"
+  "    <td>Note</td>\n"
+  "    <td>Frequency (Hz)</td>\n"
+  "    <td>Duration</td>\n"
+  "  </tr>\n"
+  "  <tr>\n"
+  "    <td>C4</td>\n"
+  "    <td>261.63</td>\n"
+  "    <td>&frac14; note</td>\n"
+  "  </tr>\n"
+  "  <tr>\n"
+  "    <td>A4</td>\n"
+  "    <td>440.00</td>\n"
+  "    <td>&frac12; note</td>\n"
+  "  </tr>\n"
+  "</table>\n";
+
+static const std::string paragraph_fixture =
+  "<p>The <strong>NonBlockingRtttl</strong> library plays <em>RTTTL</em> melodies &#8211; also known as &#8220;ringtones&#8221; &#8211; "
+  "without blocking the <i>loop()</i> function. See the <code>begin()</code> and <code>play()</code> functions.&nbsp;</p>\n"
+  "<p>An image: <img src=\"http://www.end2endzone.com/wp-content/uploads/2016/10/melody.png\" alt=\"melody\" width=\"300\" height=\"150\" /> <small>(click to enlarge)</small></p>\n";
+
+static const std::string reference_links_fixture =
+  "Download the [latest release][1] or read the [documentation][2].\n"
+  "\n"
+  "  [1]: http://www.end2endzone.com/wp-content/uploads/2016/10/NonBlockingRtttl-v1.0.zip\n"
+  "  [2]: http://www.end2endzone.com/nonblockingrtttl-a-non-blocking-arduino-library-for-playing-rtttl-melodies/\n";
+
+static const std::string front_matter_fixture =
+  "---\n"
+  "title: NonBlockingRtttl \xE2\x80\x93 A non-blocking arduino library for playing RTTTL melodies\n"
+  "author: end2end\n"
+  "type: post\n"
+  "date: 2016-10-08T22:00:00+00:00\n"
+  "featured_image: /wp-content/uploads/2016/10/melody.png\n"
+  "categories:\n"
+  "  - Arduino\n"
+  "---\n"
+  "<!--more Lire la suite \xE2\x86\x92-->\n"
+  "<!--=================================================-->\n";
+
+// The front matter of a post saved with a utf-8 byte order mark.
+static const std::string bom_front_matter_fixture = "\xEF\xBB\xBF" + front_matter_fixture;
+
+static const std::string image_paths_fixture =
+  "/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png\n"
+  "/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample-146x150.png\n";
+
+// A complete post made of all the fixtures.
+static std::string post_fixture;
+
+// The post with the html tags of its code blocks, tables and galleries in upper case, compared with the post.
+static std::string modified_post_fixture;
+
+// The post starting with an unclosed paragraph, and the same post four times longer.
+// The tree engine converts both at the same throughput: the passes only convert the paragraph up to the next close tag.
+static std::string stray_paragraph_post_fixture;
+static std::string stray_paragraph_long_post_fixture;
+
+// Parsed once, outside of the arena of the operations.
+static HtmlTable parsed_table_fixture;
+
+void init_fixtures() {
+  std::string body;
+  body += header_span_fixture + "\n";
+  body += paragraph_fixture + "\n";
+  body += custom_css_paragraph_fixture + "\n";
+  body += justified_list_fixture + "\n";
+  body += wordpress_code_fixture + "\n";
+  body += crayon_fixture + "\n";
+  body += gallery_fixture + "\n";
+  body += table_fixture + "\n";
+
+  post_fixture = front_matter_fixture + "\n";
+  for(size_t i=0; i<10; i++)
+    post_fixture += body;
+  post_fixture += reference_links_fixture;
+
+  stray_paragraph_post_fixture = front_matter_fixture + "\n<p>Unclosed paragraph.\n\n";
+  for(size_t i=0; i<10; i++)
+    stray_paragraph_post_fixture += body;
+  stray_paragraph_long_post_fixture = front_matter_fixture + "\n<p>Unclosed paragraph.\n\n";
+  for(size_t i=0; i<40; i++)
+    stray_paragraph_long_post_fixture += body;
+
+  modified_post_fixture = post_fixture;
+  search_and_replace(modified_post_fixture, "<pre", "<PRE");
+  search_and_replace(modified_post_fixture, "<td", "<TD");
+  search_and_replace(modified_post_fixture, "<img", "<IMG");
+
+  parse_html_table(table_fixture, parsed_table_fixture);
+}
+
+//
+// Helper benchmarks
+//
+
+void bench_find_html_tag_boundaries(const std::string & fixture) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  size_t count = 0;
+  while(find_html_tag_boundaries(fixture, HTML_TAG_ID_SPAN, offset, info)) {
+    offset = info.close_end + 1;
+    count++;
+  }
+  benchmark_sink += count;
+}
+
+void bench_find_html_attribute_boundaries(const std::string & fixture) {
+  HTML_TAG_INFO tag_info;
+  HTML_ATTRIBUTE_INFO attr_info;
+  size_t offset = 0;
+  size_t count = 0;
+  while(find_html_tag_boundaries(fixture, HTML_TAG_ID_A, offset, tag_info)) {
+    if (find_html_attribute_boundaries(fixture, "href", tag_info.open_start, tag_info.open_end, attr_info))
+      count += attr_info.attr_value_end - attr_info.attr_value_start;
+    offset = tag_info.close_end + 1;
+  }
+  benchmark_sink += count;
+}
+
+void bench_has_inner_html_tags(const std::string & fixture) {
+  benchmark_sink += has_inner_html_tags(fixture);
+}
+
+void bench_search_and_replace(const std::string & fixture) {
+  std::string content = fixture;
+  search_and_replace(content, "http://www.end2endzone.com", "");
+  benchmark_sink += content.size();
+}
+
+void bench_trim_html_whitespace(const std::string & fixture) {
+  std::string content = fixture;
+  benchmark_sink += trim_html_whitespace(content);
+}
+
+void bench_string_length_utf8(const std::string & fixture) {
+  benchmark_sink += string_length_utf8(fixture);
+}
+
+void bench_string_display_width_utf8(const std::string & fixture) {
+  benchmark_sink += string_display_width_utf8(fixture.c_str(), fixture.size());
+}
+
+void bench_to_file_diff(const std::string & fixture) {
+  DIFF_STATS stats;
+  benchmark_sink += to_file_diff(fixture, modified_post_fixture, "post.md", DIFF_FORMAT_UNIFIED, stats).size();
+}
+
+// The table is parsed from the fixture by init_fixtures(). The fixture only gives the number of bytes of the benchmark.
+void bench_to_markdown(const std::string & /*fixture*/) {
+  // Measure the widths of the cells on each operation
+  parsed_table_fixture.widths.clear();
+  benchmark_sink += to_markdown(parsed_table_fixture).size();
+}
+
+void bench_is_sub_image_size(const std::string & fixture) {
+  static std::vector<std::string> paths;
+  if (paths.empty())
+    paths = split(fixture, '\n');
+  benchmark_sink += is_sub_image_size(paths[0].c_str(), paths[1].c_str());
+}
+
+void bench_scan_for_any(const std::string & fixture) {
+  static const char characters[] = { '<', '&', '\n' };
+  size_t count = 0;
+  size_t pos = scan_for_any(fixture.c_str(), fixture.size(), 0, characters, sizeof(characters));
+  while (pos != std::string::npos) {
+    count++;
+    pos = scan_for_any(fixture.c_str(), fixture.size(), pos + 1, characters, sizeof(characters));
+  }
+  benchmark_sink += count;
+}
+
+void bench_scan_for_nonwhite(const std::string & fixture) {
+  size_t count = 0;
+  size_t pos = scan_for_nonwhite(fixture.c_str(), fixture.size(), 0);
+  while (pos != std::string::npos) {
+    count++;
+    pos = find_in_buffer(fixture.c_str(), fixture.size(), '\n', pos);
+    if (pos != std::string::npos)
+      pos = scan_for_nonwhite(fixture.c_str(), fixture.size(), pos);
+  }
+  benchmark_sink += count;
+}
+
+void bench_scan_count_character(const std::string & fixture) {
+  benchmark_sink += scan_count_character(fixture.c_str(), fixture.size(), '\n');
+}
+
+// Measures the copy of the fixture, which is included in the benchmarks of the filters.
+void bench_string_copy(const std::string & fixture) {
+  std::string content = fixture;
+  benchmark_sink += content.size();
+}
+
+//
+// Filter benchmarks. The fixture is copied since filters modify the content.
+//
+
+#define DECLARE_FILTER_BENCHMARK(filter) \
+  void bench_##filter(const std::string & fixture) { \
+    std::string content = fixture; \
+    filter(content); \
+    benchmark_sink += content.size(); \
+  }
+
+DECLARE_FILTER_BENCHMARK(filter_span)
+DECLARE_FILTER_BENCHMARK(filter_paragraph_with_custom_css)
+DECLARE_FILTER_BENCHMARK(filter_paragraph)
+DECLARE_FILTER_BENCHMARK(filter_images)
+DECLARE_FILTER_BENCHMARK(filter_anchors)
+DECLARE_FILTER_BENCHMARK(filter_strong)
+DECLARE_FILTER_BENCHMARK(filter_italic)
+DECLARE_FILTER_BENCHMARK(filter_emphasized)
+DECLARE_FILTER_BENCHMARK(filter_code)
+DECLARE_FILTER_BENCHMARK(filter_unordered_lists)
+DECLARE_FILTER_BENCHMARK(filter_list_item)
+DECLARE_FILTER_BENCHMARK(filter_list_item_simplify)
+DECLARE_FILTER_BENCHMARK(filter_preformatted_code_simplify)
+DECLARE_FILTER_BENCHMARK(filter_division)
+DECLARE_FILTER_BENCHMARK(filter_division_gallery)
+DECLARE_FILTER_BENCHMARK(filter_table)
+DECLARE_FILTER_BENCHMARK(filter_preformatted)
+DECLARE_FILTER_BENCHMARK(filter_small)
+DECLARE_FILTER_BENCHMARK(filter_known_html_entities)
+DECLARE_FILTER_BENCHMARK(filter_useless_nbsp_entities)
+DECLARE_FILTER_BENCHMARK(filter_table_white_space)
+DECLARE_FILTER_BENCHMARK(force_inline_hyperlinks)
+DECLARE_FILTER_BENCHMARK(filter_missing_newline)
+DECLARE_FILTER_BENCHMARK(filter_missing_newline_after_header)
+DECLARE_FILTER_BENCHMARK(filter_front_matter)
+DECLARE_FILTER_BENCHMARK(filter_comment_separators)
+DECLARE_FILTER_BENCHMARK(filter_more_comment)
+DECLARE_FILTER_BENCHMARK(run_tree_filters)
+
+/// <summary>
+/// Runs the filters of the passes of filterhtml until a pass does not change anything.
+/// </summary>
+static void run_filter_passes(std::string & content) {
+  size_t count = 1;
+  for(size_t pass=0; count > 0 && pass < 15; pass++) {
+    count = 0;
+    count += filter_span(content);
+    count += filter_paragraph_with_custom_css(content);
+    count += filter_paragraph(content);
+    count += filter_images(content);
+    count += filter_strong(content);
+    count += filter_italic(content);
+    count += filter_anchors(content);
+    count += filter_emphasized(content);
+    count += filter_code(content);
+    count += filter_unordered_lists(content);
+    count += filter_list_item_simplify(content);
+    count += filter_list_item(content);
+    count += filter_division_gallery(content);
+    count += filter_table(content);
+    count += filter_division(content);
+    count += filter_preformatted(content);
+    count += filter_small(content);
+  }
+}
+
+// The tree engine of filterhtml, which converts the elements that it cannot convert with the passes.
+void bench_run_tree_filters_with_passes(const std::string & fixture) {
+  std::string content = fixture;
+  run_tree_filters(content, TREE_CONVERSION_ALL, &run_filter_passes);
+  benchmark_sink += content.size();
+}
+
+std::vector<BENCHMARK> get_benchmarks() {
+  std::vector<BENCHMARK> benchmarks;
+  BENCHMARK helpers[] = {
+    { "string_copy/post",                     &post_fixture,                bench_string_copy },
+    { "find_html_tag_boundaries/post",        &post_fixture,                bench_find_html_tag_boundaries },
+    { "find_html_attribute_boundaries/post",  &post_fixture,                bench_find_html_attribute_boundaries },
+    { "has_inner_html_tags/paragraph",        &paragraph_fixture,           bench_has_inner_html_tags },
+    { "has_inner_html_tags/post",             &post_fixture,                bench_has_inner_html_tags },
+    { "search_and_replace/post",              &post_fixture,                bench_search_and_replace },
+    { "trim_html_whitespace/paragraph",       &custom_css_paragraph_fixture, bench_trim_html_whitespace },
+    { "string_length_utf8/front_matter",      &front_matter_fixture,        bench_string_length_utf8 },
+    { "string_length_utf8/post",              &post_fixture,                bench_string_length_utf8 },
+    { "string_display_width_utf8/post",       &post_fixture,                bench_string_display_width_utf8 },
+    { "to_markdown/table",                    &table_fixture,               bench_to_markdown },
+    { "to_file_diff/post",                    &post_fixture,                bench_to_file_diff },
+    { "is_sub_image_size/paths",              &image_paths_fixture,         bench_is_sub_image_size },
+    { "scan_for_any/post",                    &post_fixture,                bench_scan_for_any },
+    { "scan_for_nonwhite/post",               &post_fixture,                bench_scan_for_nonwhite },
+    { "scan_count_character/post",            &post_fixture,                bench_scan_count_character },
+  };
+  benchmarks.insert(benchmarks.end(), helpers, helpers + sizeof(helpers) / sizeof(helpers[0]));
+
+  // Each filter runs on the snippet it targets and on the whole post
+  BENCHMARK filters[] = {
+    { "filter_span/header",                         &header_span_fixture,           bench_filter_span },
+    { "filter_paragraph_with_custom_css/paragraph", &custom_css_paragraph_fixture,  bench_filter_paragraph_with_custom_css },
+    { "filter_paragraph/paragraph",                 &paragraph_fixture,             bench_filter_paragraph },
+    { "filter_images/paragraph",                    &paragraph_fixture,             bench_filter_images },
+    { "filter_anchors/list",                        &justified_list_fixture,        bench_filter_anchors },
+    { "filter_strong/paragraph",                    &paragraph_fixture,             bench_filter_strong },
+    { "filter_italic/paragraph",                    &paragraph_fixture,             bench_filter_italic },
+    { "filter_emphasized/paragraph",                &paragraph_fixture,             bench_filter_emphasized },
+    { "filter_code/paragraph",                      &paragraph_fixture,             bench_filter_code },
+    { "filter_unordered_lists/list",                &justified_list_fixture,        bench_filter_unordered_lists },
+    { "filter_list_item/list",                      &justified_list_fixture,        bench_filter_list_item },
+    { "filter_list_item_simplify/list",             &justified_list_fixture,        bench_filter_list_item_simplify },
+    { "filter_preformatted_code_simplify/code",     &wordpress_code_fixture,        bench_filter_preformatted_code_simplify },
+    { "filter_division/crayon",                     &crayon_fixture,                bench_filter_division },
+    { "filter_division_gallery/gallery",            &gallery_fixture,               bench_filter_division_gallery },
+    { "filter_table/table",                         &table_fixture,                 bench_filter_table },
+    { "filter_preformatted/crayon",                 &crayon_fixture,                bench_filter_preformatted },
+    { "filter_small/paragraph",                     &paragraph_fixture,             bench_filter_small },
+    { "filter_known_html_entities/paragraph",       &paragraph_fixture,             bench_filter_known_html_entities },
+    { "filter_useless_nbsp_entities/paragraph",     &paragraph_fixture,             bench_filter_useless_nbsp_entities },
+    { "filter_table_white_space/table",             &table_fixture,                 bench_filter_table_white_space },
+    { "force_inline_hyperlinks/links",              &reference_links_fixture,       bench_force_inline_hyperlinks },
+    { "filter_missing_newline/paragraph",           &paragraph_fixture,             bench_filter_missing_newline },
+    { "filter_missing_newline_after_header/header", &header_span_fixture,           bench_filter_missing_newline_after_header },
+    { "filter_front_matter/front_matter",           &front_matter_fixture,          bench_filter_front_matter },
+    { "filter_comment_separators/front_matter",     &front_matter_fixture,          bench_filter_comment_separators },
+    { "filter_more_comment/front_matter",           &front_matter_fixture,          bench_filter_more_comment },
+  };
+  size_t num_filters = sizeof(filters) / sizeof(filters[0]);
+  for(size_t i=0; i<num_filters; i++) {
+    benchmarks.push_back(filters[i]);
+
+    BENCHMARK post = filters[i];
+    post.name = post.name.substr(0, post.name.find('/')) + "/post";
+    post.fixture = &post_fixture;
+    benchmarks.push_back(post);
+  }
+
+  BENCHMARK bom_front_matter = { "filter_front_matter/bom_front_matter", &bom_front_matter_fixture, bench_filter_front_matter };
+  benchmarks.push_back(bom_front_matter);
+
+  BENCHMARK markdown_characters = { "filter_known_html_entities/markdown_characters", &markdown_characters_fixture, bench_filter_known_html_entities };
+  benchmarks.push_back(markdown_characters);
+
+  BENCHMARK tree[] = {
+    { "run_tree_filters/post",                    &post_fixture,                      bench_run_tree_filters },
+    { "run_tree_filters/stray_paragraph_post",    &stray_paragraph_post_fixture,      bench_run_tree_filters_with_passes },
+    { "run_tree_filters/stray_paragraph_long_post", &stray_paragraph_long_post_fixture, bench_run_tree_filters_with_passes },
+  };
+  benchmarks.insert(benchmarks.end(), tree, tree + sizeof(tree) / sizeof(tree[0]));
+
+  return benchmarks;
+}
+
+/// <summary>
+/// Returns the duration in seconds of the given number of operations.
+/// </summary>
+double measure(const BENCHMARK & benchmark, size_t iterations) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(size_t i=0; i<iterations; i++) {
+    // Each operation is a file of filterhtml
+    FileArenaScope arena_scope;
+    benchmark.function(*benchmark.fixture);
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+/// <summary>
+/// Runs a benchmark enough times for a sample to last at least the minimum sample time.
+/// Returns the median of multiple samples.
+/// </summary>
+BENCHMARK_RESULT run_benchmark(const BENCHMARK & benchmark) {
+  // Find the number of iterations of a sample
+  size_t iterations = 1;
+  while(measure(benchmark, iterations) < min_sample_time && iterations < ((size_t)1 << 30))
+    iterations *= 2;
+
+  std::vector<double> samples;
+  for(size_t i=0; i<NUM_SAMPLES; i++)
+    samples.push_back(measure(benchmark, iterations) / (double)iterations);
+  std::sort(samples.begin(), samples.end());
+  double seconds_per_op = samples[samples.size() / 2];
+
+  BENCHMARK_RESULT result;
+  result.name = benchmark.name;
+  result.bytes = benchmark.fixture->size();
+  result.iterations = iterations;
+  result.ns_per_op = seconds_per_op * 1e9;
+  result.bytes_per_second = (seconds_per_op > 0.0 ? (double)result.bytes / seconds_per_op : 0.0);
+  return result;
+}
+
+/// <summary>
+/// Returns the results as comma-separated values, one benchmark per line.
+/// </summary>
+std::string to_csv(const std::vector<BENCHMARK_RESULT> & results) {
+  std::ostringstream output;
+  output << "name,bytes,iterations,ns_per_op,bytes_per_second\n";
+  for(size_t i=0; i<results.size(); i++) {
+    const BENCHMARK_RESULT & result = results[i];
+    output << result.name << "," << result.bytes << "," << result.iterations << ",";
+    output << std::fixed << std::setprecision(1) << result.ns_per_op << "," << std::setprecision(0) << result.bytes_per_second << "\n";
+  }
+  return output.str();
+}
+
+void show_usage() {
+  std::cout << "bench_kernels\n";
+  std::cout << "Usage:\n";
+  std::cout << "  Measure the time of the helper functions and of each filter of filterhtml.\n";
+  std::cout << "Arguments:\n";
+  std::cout << "  --filter=<text>\tRun only the benchmarks whose name contains the text.\n";
+  std::cout << "  --min-time=<ms>\tMinimum duration of a measurement, in milliseconds. Defaults to 100.\n";
+  std::cout << "  --output=<path>\tSave the results as comma-separated values.\n";
+  std::cout << "  --scan=<level>\tInstruction set of the scanning kernels: 'auto' (default), 'avx2', 'sse2' or 'scalar'.\n";
+  std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+  Arguments args;
+  args.filter = find_argument("filter", argc, argv);
+  args.min_time = find_argument("min-time", argc, argv);
+  args.output = find_argument("output", argc, argv);
+  args.scan = find_argument("scan", argc, argv);
+
+  if (has_argument("help", argc, argv)) {
+    show_usage();
+    return 0;
+  }
+
+  if (!args.min_time.empty()) {
+    int value = 0;
+    if (is_numeric(args.min_time.c_str()))
+      parse_value(args.min_time, value);
+    if (value <= 0) {
+      std::cout << "Error. Invalid minimum time '" << args.min_time << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    min_sample_time = value / 1000.0;
+  }
+
+  if (!args.scan.empty()) {
+    SCAN_LEVEL level = SCAN_LEVEL_SCALAR;
+    if (!parse_scan_level(args.scan.c_str(), level)) {
+      std::cout << "Error. Unknown scan level '" << args.scan << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    if (!set_scan_level(level)) {
+      std::cout << "Error. Scan level '" << args.scan << "' is not supported by this processor.\n";
+      return 1;
+    }
+  }
+  std::cout << "Scan level: " << get_scan_level_name(get_scan_level()) << "\n";
+
+  init_fixtures();
+  init_html_entity_mappings();
+
+  // Filters log their warnings. Keep them out of the results.
+  std::ostringstream log;
+  set_log_stream(&log);
+
+  std::vector<BENCHMARK> benchmarks = get_benchmarks();
+  std::vector<BENCHMARK_RESULT> results;
+  std::cout << std::left << std::setw(50) << "Benchmark" << std::right << std::setw(10) << "Bytes" << std::setw(14) << "ns/op" << std::setw(14) << "MB/s" << "\n";
+  for(size_t i=0; i<benchmarks.size(); i++) {
+    const BENCHMARK & benchmark = benchmarks[i];
+    if (!args.filter.empty() && benchmark.name.find(args.filter) == std::string::npos)
+      continue;
+
+    BENCHMARK_RESULT result = run_benchmark(benchmark);
+    results.push_back(result);
+    std::cout << std::left << std::setw(50) << result.name << std::right << std::setw(10) << result.bytes;
+    std::cout << std::setw(14) << std::fixed << std::setprecision(1) << result.ns_per_op;
+    std::cout << std::setw(14) << std::setprecision(1) << result.bytes_per_second / 1e6 << "\n";
+  }
+
+  set_log_stream(NULL);
+
+  if (!args.output.empty()) {
+    std::string error;
+    if (!replace_file(args.output, to_csv(results), error)) {
+      std::cout << "Error. " << error << "\n";
+      return 4;
+    }
+    std::cout << "Saved results to '" << args.output << "'.\n";
+  }
+
+	return 0;
+}
@@ -0,0 +1,224 @@
+// bench_throughput.cpp : Measures the throughput of filterhtml and filterimagesizes on synthetic corpora of increasing size.
+//
+
+#include <stdio.h>
+#include <string>
+#include <iostream>     // std::cout
+#include <iomanip>      // std::setw
+#include <vector>
+#include <sstream>
+
+#include "utils.h"
+#include "corpus.h"
+#include "process.h"
+
+struct Arguments {
+  std::string work_directory;
+  std::string bin_directory;
+  std::string posts;
+  std::string jobs;
+  std::string images_per_post;
+  std::string tools;
+  std::string output;
+};
+
+struct THROUGHPUT_RESULT {
+  std::string tool;
+  size_t num_posts;
+  size_t num_images;
+  size_t jobs;
+  size_t bytes;
+  PROCESS_STATISTICS process;
+};
+
+/// <summary>
+/// Parses a comma-separated list of positive numbers. Returns false if a value is invalid.
+/// </summary>
+bool parse_count_list(const std::string & value, std::vector<size_t> & counts) {
+  counts.clear();
+  std::vector<std::string> values = split(value, ',');
+  for(size_t i=0; i<values.size(); i++) {
+    size_t count = 0;
+    if (!is_numeric(values[i].c_str()))
+      return false;
+    parse_value(values[i], count);
+    if (count == 0)
+      return false;
+    counts.push_back(count);
+  }
+  return !counts.empty();
+}
+
+std::string get_executable_path(const std::string & bin_directory, const std::string & name) {
+#ifdef _WIN32
+  return bin_directory + get_file_separator() + name + ".exe";
+#else
+  return bin_directory + get_file_separator() + name;
+#endif
+}
+
+/// <summary>
+/// Returns the results as comma-separated values, one run per line.
+/// </summary>
+std::string to_csv(const std::vector<THROUGHPUT_RESULT> & results) {
+  std::ostringstream output;
+  output << "tool,posts,images,jobs,bytes,exit_code,seconds,files_per_second,bytes_per_second,peak_rss_bytes\n";
+  for(size_t i=0; i<results.size(); i++) {
+    const THROUGHPUT_RESULT & result = results[i];
+    double seconds = result.process.seconds;
+    output << result.tool << "," << result.num_posts << "," << result.num_images << "," << result.jobs << "," << result.bytes << ",";
+    output << result.process.exit_code << "," << std::fixed << std::setprecision(3) << seconds << ",";
+    output << std::setprecision(1) << (seconds > 0.0 ? result.num_posts / seconds : 0.0) << ",";
+    output << std::setprecision(0) << (seconds > 0.0 ? result.bytes / seconds : 0.0) << ",";
+    output << result.process.peak_memory << "\n";
+  }
+  return output.str();
+}
+
+void show_usage() {
+  std::cout << "bench_throughput\n";
+  std::cout << "Usage:\n";
+  std::cout << "  Generate synthetic wordpress corpora of increasing size and measure the files/s, MB/s and peak memory\n";
+  std::cout << "  of filterhtml and filterimagesizes on each corpus. The corpus is generated again before each run.\n";
+  std::cout << "Arguments:\n";
+  std::cout << "  --work-dir=<dir>\t\tDirectory where the corpora are generated. Defaults to the TEMP directory.\n";
+  std::cout << "  --bin-dir=<dir>\t\tDirectory of the filterhtml and filterimagesizes executables. Defaults to the directory of bench_throughput.\n";
+  std::cout << "  --posts=<n,n,...>\t\tNumber of posts of each corpus. Defaults to 100,500.\n";
+  std::cout << "  --images-per-post=<n>\tNumber of master images for each post. Defaults to 1.\n";
+  std::cout << "  --jobs=<n,n,...>\t\tNumber of jobs of each filterhtml run. Defaults to 1,2,4.\n";
+  std::cout << "  --tools=<name,...>\t\tTools to measure. Defaults to filterhtml,filterimagesizes.\n";
+  std::cout << "  --output=<path>\t\tSave the results as comma-separated values.\n";
+  std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+  Arguments args;
+  args.work_directory = find_argument("work-dir", argc, argv);
+  args.bin_directory = find_argument("bin-dir", argc, argv);
+  args.posts = find_argument("posts", argc, argv);
+  args.jobs = find_argument("jobs", argc, argv);
+  args.images_per_post = find_argument("images-per-post", argc, argv);
+  args.tools = find_argument("tools", argc, argv);
+  args.output = find_argument("output", argc, argv);
+
+  if (has_argument("help", argc, argv)) {
+    show_usage();
+    return 0;
+  }
+
+  if (args.work_directory.empty())
+    args.work_directory = get_temp_directory() + get_file_separator() + "bench_throughput";
+  if (args.bin_directory.empty())
+    args.bin_directory = get_parent_directory(argv[0]);
+  if (args.bin_directory.empty())
+    args.bin_directory = ".";
+  if (args.posts.empty())
+    args.posts = "100,500";
+  if (args.jobs.empty())
+    args.jobs = "1,2,4";
+  if (args.images_per_post.empty())
+    args.images_per_post = "1";
+  if (args.tools.empty())
+    args.tools = "filterhtml,filterimagesizes";
+
+  std::vector<size_t> posts_list;
+  std::vector<size_t> jobs_list;
+  size_t images_per_post = 0;
+  if (!parse_count_list(args.posts, posts_list) || !parse_count_list(args.jobs, jobs_list) || !is_numeric(args.images_per_post.c_str())) {
+    std::cout << "Error. Invalid list of posts, jobs or images per post.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  parse_value(args.images_per_post, images_per_post);
+
+  std::vector<std::string> tools = split(args.tools, ',');
+  for(size_t i=0; i<tools.size(); i++) {
+    if (tools[i] != "filterhtml" && tools[i] != "filterimagesizes") {
+      std::cout << "Error. Unknown tool '" << tools[i] << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    std::string path = get_executable_path(args.bin_directory, tools[i]);
+    if (!file_exists(path.c_str())) {
+      std::cout << "Error. File not found: '" << path << "'.\n";
+      return 2;
+    }
+  }
+
+  std::vector<THROUGHPUT_RESULT> results;
+  std::cout << std::left << std::setw(18) << "Tool" << std::right << std::setw(8) << "Posts" << std::setw(8) << "Images" << std::setw(6) << "Jobs";
+  std::cout << std::setw(12) << "Seconds" << std::setw(12) << "Files/s" << std::setw(10) << "MB/s" << std::setw(12) << "Peak MB" << "\n";
+  for(size_t i=0; i<posts_list.size(); i++) {
+    CorpusOptions options;
+    options.num_posts = posts_list[i];
+    options.num_images = posts_list[i] * images_per_post;
+    options.seed = 1;
+    std::string corpus_directory = args.work_directory + get_file_separator() + "corpus-" + to_string(options.num_posts) + "-" + to_string(options.num_images);
+
+    for(size_t j=0; j<tools.size(); j++) {
+      const std::string & tool = tools[j];
+
+      // filterimagesizes is single threaded
+      std::vector<size_t> tool_jobs_list = jobs_list;
+      if (tool == "filterimagesizes")
+        tool_jobs_list = std::vector<size_t>(1, 1);
+
+      for(size_t k=0; k<tool_jobs_list.size(); k++) {
+        // Both tools modify the corpus. Start each run from the original corpus.
+        CORPUS_INFO corpus;
+        std::string error;
+        if (!generate_corpus(corpus_directory, options, corpus, error)) {
+          std::cout << "Error. " << error << "\n";
+          return 4;
+        }
+
+        std::vector<std::string> command;
+        command.push_back(get_executable_path(args.bin_directory, tool));
+        if (tool == "filterhtml") {
+          command.push_back("--id=" + corpus.content_directory);
+          command.push_back("--jobs=" + to_string(tool_jobs_list[k]));
+          command.push_back("--manifest=off");
+        } else {
+          command.push_back("--wp-content=" + corpus.wp_content_directory);
+          command.push_back("--content=" + corpus.content_directory);
+        }
+
+        THROUGHPUT_RESULT result;
+        result.tool = tool;
+        result.num_posts = corpus.num_posts;
+        result.num_images = corpus.num_images;
+        result.jobs = tool_jobs_list[k];
+        result.bytes = corpus.posts_size;
+        if (!run_process(command, result.process)) {
+          std::cout << "Error. Failed to execute '" << command[0] << "'.\n";
+          return 5;
+        }
+        results.push_back(result);
+
+        double seconds = result.process.seconds;
+        std::cout << std::left << std::setw(18) << result.tool << std::right << std::setw(8) << result.num_posts << std::setw(8) << result.num_images << std::setw(6) << result.jobs;
+        std::cout << std::fixed << std::setprecision(3) << std::setw(12) << seconds;
+        std::cout << std::setprecision(1) << std::setw(12) << (seconds > 0.0 ? result.num_posts / seconds : 0.0);
+        std::cout << std::setprecision(2) << std::setw(10) << (seconds > 0.0 ? result.bytes / seconds / 1e6 : 0.0);
+        std::cout << std::setprecision(1) << std::setw(12) << result.process.peak_memory / 1e6;
+        if (result.process.exit_code != 0)
+          std::cout << "  (exit code " << result.process.exit_code << ")";
+        std::cout << "\n";
+      }
+    }
+  }
+
+  if (!args.output.empty()) {
+    std::string error;
+    if (!replace_file(args.output, to_csv(results), error)) {
+      std::cout << "Error. " << error << "\n";
+      return 4;
+    }
+    std::cout << "Saved results to '" << args.output << "'.\n";
+  }
+
+	return 0;
+}
@@ -0,0 +1,349 @@
+#include "corpus.h"
+#include "utils.h"
+#include <random>
+
+static const std::string WEBSITE_HOSTNAME = "http://www.end2endzone.com";
+
+static const char * words[] = {
+  "arduino", "melody", "tone", "delay", "library", "rtttl", "knob", "switch", "analog", "multiplexing",
+  "sample", "data", "capture", "function", "override", "project", "github", "release", "source", "code",
+  "led", "button", "serial", "timer", "interrupt", "build", "windows", "linux", "install", "package",
+};
+static const size_t num_words = sizeof(words) / sizeof(words[0]);
+
+static const char * entities[] = { "&#8211;", "&#8220;", "&#8221;", "&#8217;", "&nbsp;", "&amp;", "&lt;", "&gt;", "&eacute;", "&#215;", "&#8230;", "&frac12;" };
+static const size_t num_entities = sizeof(entities) / sizeof(entities[0]);
+
+static const char * custom_css_classes[] = { "pleasenote", "postedit" };
+static const size_t num_custom_css_classes = sizeof(custom_css_classes) / sizeof(custom_css_classes[0]);
+
+static const char * categories[] = { "Arduino", "Programming", "Hardware", "Tools", "Uncategorized" };
+static const size_t num_categories = sizeof(categories) / sizeof(categories[0]);
+
+// Sub sizes generated by wordpress for each uploaded image.
+struct IMAGE_SIZE {
+  size_t width;
+  size_t height;
+};
+static const IMAGE_SIZE image_sizes[] = { { 150, 150 }, { 300, 200 }, { 1024, 768 } };
+static const size_t num_image_sizes = sizeof(image_sizes) / sizeof(image_sizes[0]);
+
+// An image of the wp-content directory, identified by its path relative to the 'uploads' directory, without extension.
+struct CORPUS_IMAGE {
+  std::string path;
+  std::string extension;
+};
+
+// Returns a random number in [0, count). The modulo of the generator's output is used instead of
+// a distribution so that the same seed generates the same corpus with any standard library.
+inline size_t random_index(std::mt19937 & random, size_t count) {
+  return (size_t)(random() % count);
+}
+
+inline const char * random_word(std::mt19937 & random) {
+  return words[random_index(random, num_words)];
+}
+
+std::string random_words(std::mt19937 & random, size_t min_count, size_t max_count) {
+  size_t count = min_count + random_index(random, max_count - min_count + 1);
+  std::string text;
+  for(size_t i=0; i<count; i++) {
+    if (i > 0)
+      text += " ";
+    text += random_word(random);
+  }
+  return text;
+}
+
+std::string get_image_url(const CORPUS_IMAGE & image, const IMAGE_SIZE * size) {
+  std::string url = WEBSITE_HOSTNAME + "/wp-content/uploads/" + image.path;
+  if (size != NULL)
+    url += "-" + to_string(size->width) + "x" + to_string(size->height);
+  url += "." + image.extension;
+  return url;
+}
+
+std::string random_text(std::mt19937 & random) {
+  std::string text = random_words(random, 3, 12);
+  if (random_index(random, 3) == 0)
+    text += std::string(" ") + entities[random_index(random, num_entities)] + " " + random_words(random, 1, 6);
+  return text;
+}
+
+std::string random_inline(std::mt19937 & random, size_t depth) {
+  std::string text = random_text(random);
+  if (depth == 0)
+    return text;
+
+  switch(random_index(random, 8)) {
+  case 0: return text + " <strong>" + random_inline(random, depth-1) + "</strong>";
+  case 1: return text + " <em>" + random_inline(random, depth-1) + "</em>";
+  case 2: return text + " <i>" + random_text(random) + "</i>";
+  case 3: return text + " <code>" + random_word(random) + "()</code>";
+  case 4: return text + " <a href=\"" + WEBSITE_HOSTNAME + "/" + random_word(random) + "-" + random_word(random) + "/\">" + random_inline(random, depth-1) + "</a>";
+  case 5: return text + " <span style=\"text-decoration: underline;\">" + random_inline(random, depth-1) + "</span>";
+  case 6: return text + " <small>" + random_text(random) + "</small>";
+  default: return text + ".";
+  };
+}
+
+std::string random_image(std::mt19937 & random, const std::vector<CORPUS_IMAGE> & images) {
+  if (images.empty())
+    return random_text(random);
+
+  const CORPUS_IMAGE & image = images[random_index(random, images.size())];
+  const IMAGE_SIZE & size = image_sizes[random_index(random, num_image_sizes)];
+  std::string alt = random_words(random, 2, 6);
+
+  std::string srcset;
+  for(size_t i=0; i<num_image_sizes; i++) {
+    if (i > 0)
+      srcset += ", ";
+    srcset += get_image_url(image, &image_sizes[i]) + " " + to_string(image_sizes[i].width) + "w";
+  }
+
+  std::string img;
+  img += "<img class=\"aligncenter size-medium\" src=\"" + get_image_url(image, &size) + "\" alt=\"" + alt + "\" ";
+  img += "width=\"" + to_string(size.width) + "\" height=\"" + to_string(size.height) + "\" ";
+  img += "srcset=\"" + srcset + "\" sizes=\"(max-width: " + to_string(size.width) + "px) 100vw, " + to_string(size.width) + "px\" />";
+  return "<a href=\"" + get_image_url(image, NULL) + "\">" + img + "</a>";
+}
+
+std::string random_gallery(std::mt19937 & random, const std::vector<CORPUS_IMAGE> & images, size_t gallery_index) {
+  if (images.empty())
+    return "";
+
+  std::string gallery;
+  gallery += "<div id='gallery-" + to_string(gallery_index) + "' class='gallery galleryid-" + to_string(gallery_index) + " gallery-columns-3 gallery-size-thumbnail gallery" + to_string(gallery_index) + "'>\n";
+  size_t count = 2 + random_index(random, 4);
+  for(size_t i=0; i<count; i++) {
+    const CORPUS_IMAGE & image = images[random_index(random, images.size())];
+    std::string title = random_words(random, 3, 8);
+    gallery += "  <dl class=\"gallery-item\">\n";
+    gallery += "    <dt class=\"gallery-icon\">\n";
+    gallery += "      <a href=\"" + get_image_url(image, NULL) + "\" title=\"" + title + "\" rel=\"gallery" + to_string(gallery_index) + "\">";
+    gallery += "<img src=\"" + get_image_url(image, &image_sizes[0]) + "\" width=\"150\" height=\"150\" alt=\"" + title + "\" /></a>";
+    gallery += "<span><a class=\"void\" href=\"" + get_image_url(image, NULL) + "\" rel=\"nolightbox\" target=\"_blank\">1024x768</a></span>\n";
+    gallery += "    </dt>\n";
+    gallery += "    <dd class=\"gallery-caption\">\n";
+    gallery += "      <span class=\"imagecaption\">" + title + "</span><br /> <span class=\"imagedescription\">" + title + "</span><br />\n";
+    gallery += "    </dd>\n";
+    gallery += "  </dl>\n";
+  }
+  gallery += "  <br style='clear: both' />\n";
+  gallery += "</div>\n";
+  return gallery;
+}
+
+std::string random_table(std::mt19937 & random) {
+  size_t num_rows = 2 + random_index(random, 5);
+  size_t num_columns = 2 + random_index(random, 3);
+  std::string table = "<table>\n";
+  for(size_t i=0; i<num_rows; i++) {
+    table += (i == 0 && random_index(random, 2) == 0 ? "  <tr class=\"header\">\n" : "  <tr>\n");
+    for(size_t j=0; j<num_columns; j++) {
+      table += "    <td>" + random_words(random, 1, 3) + "</td>\n";
+    }
+    table += "  </tr>\n";
+  }
+  table += "</table>\n";
+  return table;
+}
+
+std::string random_code(std::mt19937 & random) {
+  std::string function = random_word(random);
+  std::string code;
+  if (random_index(random, 2) == 0) {
+    code += "<pre class=\"wp-block-code\"><code>#include &lt;stdio.h&gt;\n";
+    code += "void " + function + "(int value)\n{\n";
+    code += "  printf(&quot;" + random_words(random, 2, 5) + " %d\\n&quot;, value);\n";
+    code += "}</code></pre>\n";
+  } else {
+    std::string file_url = WEBSITE_HOSTNAME + "/wp-content/uploads/2016/10/" + function + "-" + random_word(random) + ".ino";
+    code += "<div class=\"crayon-line\">\n";
+    code += "  <pre class=\"lang:c++ decode:true\" title=\"" + random_words(random, 3, 6) + "\" data-url=\"" + file_url + "\">" + file_url + "</pre>\n";
+    code += "</div>\n";
+  }
+  return code;
+}
+
+std::string random_list(std::mt19937 & random) {
+  std::string list = "<ul>\n";
+  size_t count = 2 + random_index(random, 5);
+  for(size_t i=0; i<count; i++) {
+    list += (random_index(random, 2) == 0 ? "  <li style=\"text-align: justify;\">" : "  <li>");
+    list += random_inline(random, 1) + "</li>\n";
+  }
+  list += "</ul>\n";
+  return list;
+}
+
+// Returns nested <div>, <p> and <span> blocks.
+std::string random_division(std::mt19937 & random, size_t depth) {
+  if (depth == 0)
+    return "<p>" + random_inline(random, 2) + "</p>";
+
+  switch(random_index(random, 3)) {
+  case 0: return "<div class=\"wp-caption alignnone\">\n" + random_division(random, depth-1) + "\n</div>";
+  case 1: return "<div>" + random_division(random, depth-1) + "</div>";
+  default: return "<span>" + random_division(random, depth-1) + "</span>";
+  };
+}
+
+std::string generate_post(std::mt19937 & random, size_t post_index, const std::vector<CORPUS_IMAGE> & images) {
+  std::string title = random_words(random, 2, 6);
+  std::string slug = title;
+  search_and_replace(slug, " ", "-");
+
+  // Some posts are saved with a utf-8 byte order mark or with trailing blanks after the front matter separators
+  std::string separator = (post_index % 16 == 11 ? "--- \n" : "---\n");
+
+  std::string post;
+  if (post_index % 16 == 7)
+    post += "\xEF\xBB\xBF";
+  post += separator;
+  post += "title: " + title + " \xE2\x80\x93 " + random_words(random, 2, 5) + "\n";
+  post += "author: end2end\n";
+  post += "type: post\n";
+  post += "date: " + to_string(2014 + post_index % 6) + "-0" + to_string(1 + post_index % 9) + "-1" + to_string(post_index % 10) + "T12:00:00+00:00\n";
+  post += "url: /" + slug + "-" + to_string(post_index) + "/\n";
+  if (!images.empty()) {
+    const CORPUS_IMAGE & featured_image = images[random_index(random, images.size())];
+    post += "featured_image: /wp-content/uploads/" + featured_image.path + "." + featured_image.extension + "\n";
+  }
+  post += "categories:\n";
+  post += "  - " + std::string(categories[random_index(random, num_categories)]) + "\n";
+  post += "tags:\n";
+  post += "  - " + std::string(random_word(random)) + "\n";
+  post += "  - " + std::string(random_word(random)) + "\n";
+  post += separator;
+  post += "<p>" + random_inline(random, 2) + "</p>\n";
+
+  // Some paragraphs start with encoded markdown characters, which must not become a header or a list item
+  if (post_index % 16 == 3) {
+    post += "<p>&#35;" + to_string(post_index) + " is the number of this post.</p>\n";
+    post += "<p>&#45; " + to_string(post_index) + " posts are older than this post.</p>\n";
+  }
+  post += "<!--more Lire la suite \xE2\x86\x92-->\n";
+  post += "\n";
+
+  std::vector<std::string> references;
+  size_t num_blocks = 5 + random_index(random, 20);
+  for(size_t i=0; i<num_blocks; i++) {
+    switch(random_index(random, 12)) {
+    case 0:
+      post += "## <span id=\"" + std::string(random_word(random)) + "\">" + random_words(random, 1, 4) + "</span>\n";
+      break;
+    case 1:
+      post += "<p class=\"" + std::string(custom_css_classes[random_index(random, num_custom_css_classes)]) + "\">\n  " + random_inline(random, 2) + "\n</p>\n";
+      break;
+    case 2:
+      post += random_list(random);
+      break;
+    case 3:
+      post += "<p>" + random_image(random, images) + "</p>\n";
+      break;
+    case 4:
+      post += random_gallery(random, images, post_index * 100 + i);
+      break;
+    case 5:
+      post += random_table(random);
+      break;
+    case 6:
+      post += random_code(random);
+      break;
+    case 7:
+      post += random_division(random, 1 + random_index(random, 4)) + "\n";
+      break;
+    case 8:
+      references.push_back(WEBSITE_HOSTNAME + "/" + random_word(random) + "-" + random_word(random) + "/");
+      post += random_text(random) + " [" + random_words(random, 1, 3) + "][" + to_string(references.size()) + "].\n";
+      break;
+    case 9:
+      post += "<!--=================================================-->\n";
+      break;
+    default:
+      post += "<p>" + random_inline(random, 3) + "</p>\n";
+      break;
+    };
+    post += "\n";
+  }
+
+  for(size_t i=0; i<references.size(); i++) {
+    post += "  [" + to_string(i+1) + "]: " + references[i] + "\n";
+  }
+
+  return post;
+}
+
+/// <summary>
+/// Generates a synthetic wordpress export in the given directory:
+/// the posts in 'content/posts' and the uploaded images in 'wp-content/uploads/YYYY/MM'.
+/// Each master image has multiple sub sizes named '<name>-<width>x<height>.<ext>' which are referenced by the posts.
+/// Existing files are overwritten, so a corpus can be regenerated in place after a tool has modified it.
+/// </summary>
+bool generate_corpus(const std::string & directory, const CorpusOptions & options, CORPUS_INFO & info, std::string & error) {
+  std::string separator = get_file_separator();
+  info.content_directory = directory + separator + "content" + separator + "posts";
+  info.wp_content_directory = directory + separator + "wp-content";
+  info.num_posts = 0;
+  info.num_images = 0;
+  info.posts_size = 0;
+
+  std::mt19937 random(options.seed);
+
+  // Images are spread over the months of a few years, like a real upload directory
+  static const std::string image_content = "This is not a real image. The tools only look at the file names.\n";
+  std::vector<CORPUS_IMAGE> images;
+  for(size_t i=0; i<options.num_images; i++) {
+    size_t month_index = i % 72;
+    std::string year = to_string(2014 + month_index / 12);
+    std::string month = to_string(101 + month_index % 12).substr(1);
+    std::string name = std::string(random_word(random)) + "-" + random_word(random) + "-" + to_string(100000 + i).substr(1);
+
+    CORPUS_IMAGE image;
+    image.path = year + "/" + month + "/" + name;
+    image.extension = (random_index(random, 4) == 0 ? "jpg" : "png");
+    images.push_back(image);
+
+    std::string image_directory = info.wp_content_directory + separator + "uploads" + separator + year + separator + month;
+    if (!create_directories(image_directory)) {
+      error = "Unable to create directory '" + image_directory + "'.";
+      return false;
+    }
+
+    std::string master_path = image_directory + separator + name + "." + image.extension;
+    if (!save_file(master_path, image_content)) {
+      error = "Unable to write file '" + master_path + "'.";
+      return false;
+    }
+    info.num_images++;
+
+    for(size_t j=0; j<num_image_sizes; j++) {
+      std::string size_path = image_directory + separator + name + "-" + to_string(image_sizes[j].width) + "x" + to_string(image_sizes[j].height) + "." + image.extension;
+      if (!save_file(size_path, image_content)) {
+        error = "Unable to write file '" + size_path + "'.";
+        return false;
+      }
+      info.num_images++;
+    }
+  }
+
+  if (!create_directories(info.content_directory)) {
+    error = "Unable to create directory '" + info.content_directory + "'.";
+    return false;
+  }
+
+  for(size_t i=0; i<options.num_posts; i++) {
+    std::string post = generate_post(random, i, images);
+    std::string post_path = info.content_directory + separator + "post-" + to_string(100000 + i).substr(1) + ".md";
+    if (!save_file(post_path, post)) {
+      error = "Unable to write file '" + post_path + "'.";
+      return false;
+    }
+    info.num_posts++;
+    info.posts_size += post.size();
+  }
+
+  return true;
+}
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Options of a synthetic wordpress corpus.
+struct CorpusOptions {
+  size_t num_posts;
+  size_t num_images;      // number of master images. Each master image has multiple sub sizes.
+  unsigned int seed;      // the same seed always generates the same corpus
+};
+
+// Content of a generated corpus.
+struct CORPUS_INFO {
+  std::string content_directory;      // directory of the posts
+  std::string wp_content_directory;   // directory of the uploaded images
+  size_t num_posts;
+  size_t num_images;                  // number of images, including sub sizes
+  size_t posts_size;                  // size of all posts, in bytes
+};
+
+// declarations
+bool generate_corpus(const std::string & directory, const CorpusOptions & options, CORPUS_INFO & info, std::string & error);
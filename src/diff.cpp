@@ -0,0 +1,325 @@
+#include "diff.h"
+#include "utils.h"
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+// Number of unchanged lines displayed before and after the changes of a hunk.
+static const size_t DIFF_CONTEXT_LINES = 3;
+
+// Maximum number of edits searched from each end of a range before the whole range is considered changed.
+// This bounds the time spent on files that are completely rewritten. The diff is still valid but not minimal.
+static const size_t DIFF_MAX_COST = 4096;
+
+// The lines of the two versions of a file. Identical lines share the same id so that lines are compared as integers.
+struct DiffLines {
+  std::vector<std::string_view> old_lines;
+  std::vector<std::string_view> new_lines;
+  std::vector<uint32_t> old_ids;
+  std::vector<uint32_t> new_ids;
+  std::vector<char> old_changed;  // 1 if the line is removed
+  std::vector<char> new_changed;  // 1 if the line is added
+};
+
+// A range of lines to compare, [old_start, old_end) and [new_start, new_end).
+struct DIFF_RANGE {
+  size_t old_start;
+  size_t old_end;
+  size_t new_start;
+  size_t new_end;
+};
+
+bool parse_diff_format(const std::string & name, DIFF_FORMAT & format) {
+  if (name == "unified")
+    format = DIFF_FORMAT_UNIFIED;
+  else if (name == "stats")
+    format = DIFF_FORMAT_STATS;
+  else
+    return false;
+  return true;
+}
+
+/// <summary>
+/// Splits the content in lines. Each line includes its newline, except the last line if the content does not end with a newline.
+/// </summary>
+static void split_diff_lines(std::string_view content, std::vector<std::string_view> & lines) {
+  lines.clear();
+  size_t pos = 0;
+  while (pos < content.size()) {
+    const char * newline = (const char *)memchr(content.data() + pos, '\n', content.size() - pos);
+    size_t line_end = (newline == NULL ? content.size() : (size_t)(newline - content.data()) + 1);
+    lines.push_back(content.substr(pos, line_end - pos));
+    pos = line_end;
+  }
+}
+
+/// <summary>
+/// Assigns the same id to identical lines of both versions.
+/// </summary>
+static void assign_line_ids(DiffLines & lines) {
+  std::unordered_map<std::string_view, uint32_t> ids;
+  ids.reserve(lines.old_lines.size() + lines.new_lines.size());
+  lines.old_ids.resize(lines.old_lines.size());
+  lines.new_ids.resize(lines.new_lines.size());
+  for(size_t i=0; i<lines.old_lines.size(); i++)
+    lines.old_ids[i] = ids.emplace(lines.old_lines[i], (uint32_t)ids.size()).first->second;
+  for(size_t i=0; i<lines.new_lines.size(); i++)
+    lines.new_ids[i] = ids.emplace(lines.new_lines[i], (uint32_t)ids.size()).first->second;
+}
+
+/// <summary>
+/// Searches the middle snake of the shortest edit script of a range with the forward and reverse searches of Myers' algorithm.
+/// Only the furthest path of each diagonal is kept, so the memory is linear in the size of the range.
+/// Returns false if the cost of the range exceeds DIFF_MAX_COST.
+/// See "An O(ND) Difference Algorithm and Its Variations", Eugene W. Myers, 1986.
+/// </summary>
+static bool find_middle_snake(const DiffLines & lines, const DIFF_RANGE & range, std::vector<ptrdiff_t> & forward, std::vector<ptrdiff_t> & reverse, size_t & old_split, size_t & new_split) {
+  const uint32_t * a = &lines.old_ids[range.old_start];
+  const uint32_t * b = &lines.new_ids[range.new_start];
+  const ptrdiff_t n = (ptrdiff_t)(range.old_end - range.old_start);
+  const ptrdiff_t m = (ptrdiff_t)(range.new_end - range.new_start);
+  const ptrdiff_t max_d = std::min((n + m + 1) / 2, (ptrdiff_t)DIFF_MAX_COST);
+  const ptrdiff_t offset = max_d + 1;
+  const ptrdiff_t length = 2 * max_d + 3;
+  const ptrdiff_t delta = n - m;
+  const bool odd = (delta % 2 != 0);
+
+  // Each value is the furthest x reached on a diagonal k = x - y, from the start (forward) or from the end (reverse) of the range
+  forward.assign((size_t)length, -1);
+  reverse.assign((size_t)length, -1);
+  forward[(size_t)(offset + 1)] = 0;
+  reverse[(size_t)(offset + 1)] = 0;
+
+  // Diagonals which left the range are not searched again
+  ptrdiff_t forward_start = 0;
+  ptrdiff_t forward_end = 0;
+  ptrdiff_t reverse_start = 0;
+  ptrdiff_t reverse_end = 0;
+  for(ptrdiff_t d=0; d<=max_d; d++) {
+    for(ptrdiff_t k=-d+forward_start; k<=d-forward_end; k+=2) {
+      ptrdiff_t k_offset = offset + k;
+      ptrdiff_t x;
+      if (k == -d || (k != d && forward[k_offset - 1] < forward[k_offset + 1]))
+        x = forward[k_offset + 1];
+      else
+        x = forward[k_offset - 1] + 1;
+      ptrdiff_t y = x - k;
+      while (x < n && y < m && a[x] == b[y]) {
+        x++;
+        y++;
+      }
+      forward[k_offset] = x;
+      if (x > n) {
+        forward_end += 2;
+      } else if (y > m) {
+        forward_start += 2;
+      } else if (odd) {
+        ptrdiff_t reverse_offset = offset + delta - k;
+        if (reverse_offset >= 0 && reverse_offset < length && reverse[reverse_offset] != -1 && x >= n - reverse[reverse_offset]) {
+          old_split = range.old_start + (size_t)x;
+          new_split = range.new_start + (size_t)y;
+          return true;
+        }
+      }
+    }
+
+    for(ptrdiff_t k=-d+reverse_start; k<=d-reverse_end; k+=2) {
+      ptrdiff_t k_offset = offset + k;
+      ptrdiff_t x;
+      if (k == -d || (k != d && reverse[k_offset - 1] < reverse[k_offset + 1]))
+        x = reverse[k_offset + 1];
+      else
+        x = reverse[k_offset - 1] + 1;
+      ptrdiff_t y = x - k;
+      while (x < n && y < m && a[n - x - 1] == b[m - y - 1]) {
+        x++;
+        y++;
+      }
+      reverse[k_offset] = x;
+      if (x > n) {
+        reverse_end += 2;
+      } else if (y > m) {
+        reverse_start += 2;
+      } else if (!odd) {
+        ptrdiff_t forward_offset = offset + delta - k;
+        if (forward_offset >= 0 && forward_offset < length && forward[forward_offset] != -1) {
+          ptrdiff_t forward_x = forward[forward_offset];
+          ptrdiff_t forward_y = forward_x - (forward_offset - offset);
+          if (forward_x >= n - x) {
+            old_split = range.old_start + (size_t)forward_x;
+            new_split = range.new_start + (size_t)forward_y;
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/// <summary>
+/// Marks the lines that are removed from the old version and the lines that are added to the new version.
+/// The ranges are split at their middle snake until they only contain removed or added lines.
+/// </summary>
+static void compare_lines(DiffLines & lines) {
+  lines.old_changed.assign(lines.old_lines.size(), 0);
+  lines.new_changed.assign(lines.new_lines.size(), 0);
+
+  std::vector<ptrdiff_t> forward;
+  std::vector<ptrdiff_t> reverse;
+  std::vector<DIFF_RANGE> ranges;
+  DIFF_RANGE all = { 0, lines.old_lines.size(), 0, lines.new_lines.size() };
+  ranges.push_back(all);
+  while (!ranges.empty()) {
+    DIFF_RANGE range = ranges.back();
+    ranges.pop_back();
+
+    // Skip the common lines at the beginning and at the end of the range
+    while (range.old_start < range.old_end && range.new_start < range.new_end && lines.old_ids[range.old_start] == lines.new_ids[range.new_start]) {
+      range.old_start++;
+      range.new_start++;
+    }
+    while (range.old_start < range.old_end && range.new_start < range.new_end && lines.old_ids[range.old_end - 1] == lines.new_ids[range.new_end - 1]) {
+      range.old_end--;
+      range.new_end--;
+    }
+
+    size_t old_split = 0;
+    size_t new_split = 0;
+    bool split = (range.old_start < range.old_end && range.new_start < range.new_end && find_middle_snake(lines, range, forward, reverse, old_split, new_split));
+    if (split && (old_split + new_split == range.old_start + range.new_start || old_split + new_split == range.old_end + range.new_end))
+      split = false;
+    if (!split) {
+      for(size_t i=range.old_start; i<range.old_end; i++)
+        lines.old_changed[i] = 1;
+      for(size_t i=range.new_start; i<range.new_end; i++)
+        lines.new_changed[i] = 1;
+      continue;
+    }
+
+    DIFF_RANGE before = { range.old_start, old_split, range.new_start, new_split };
+    DIFF_RANGE after = { old_split, range.old_end, new_split, range.new_end };
+    ranges.push_back(after);
+    ranges.push_back(before);
+  }
+}
+
+/// <summary>
+/// Returns the range of a hunk header: the first line and the number of lines.
+/// An empty range is identified by the line before the hunk.
+/// </summary>
+static std::string to_hunk_range(size_t start, size_t count) {
+  if (count == 1)
+    return to_string(start + 1);
+  if (count == 0)
+    return to_string(start) + ",0";
+  return to_string(start + 1) + "," + to_string(count);
+}
+
+static void append_diff_line(std::string & diff, char prefix, std::string_view line) {
+  diff += prefix;
+  diff.append(line);
+  if (line.empty() || line[line.size() - 1] != '\n')
+    diff += "\n\\ No newline at end of file\n";
+}
+
+/// <summary>
+/// Returns the unified diff of the changed lines. Changes closer than twice the number of context lines are merged in the same hunk.
+/// </summary>
+static std::string to_unified_diff(const DiffLines & lines, const std::string & path) {
+  // A block is a sequence of removed lines and added lines between unchanged lines
+  std::vector<DIFF_RANGE> blocks;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < lines.old_lines.size() || j < lines.new_lines.size()) {
+    if (i < lines.old_lines.size() && j < lines.new_lines.size() && !lines.old_changed[i] && !lines.new_changed[j]) {
+      i++;
+      j++;
+      continue;
+    }
+    DIFF_RANGE block = { i, i, j, j };
+    while (i < lines.old_lines.size() && lines.old_changed[i])
+      i++;
+    while (j < lines.new_lines.size() && lines.new_changed[j])
+      j++;
+    block.old_end = i;
+    block.new_end = j;
+    blocks.push_back(block);
+  }
+
+  std::string diff;
+  if (blocks.empty())
+    return diff;
+  diff += "--- " + path + "\n";
+  diff += "+++ " + path + "\n";
+
+  size_t first = 0;
+  while (first < blocks.size()) {
+    size_t last = first;
+    while (last + 1 < blocks.size() && blocks[last + 1].old_start - blocks[last].old_end <= 2 * DIFF_CONTEXT_LINES)
+      last++;
+
+    size_t before = std::min(DIFF_CONTEXT_LINES, blocks[first].old_start);
+    size_t after = std::min(DIFF_CONTEXT_LINES, lines.old_lines.size() - blocks[last].old_end);
+    size_t old_start = blocks[first].old_start - before;
+    size_t new_start = blocks[first].new_start - before;
+    size_t old_count = blocks[last].old_end + after - old_start;
+    size_t new_count = blocks[last].new_end + after - new_start;
+    diff += "@@ -" + to_hunk_range(old_start, old_count) + " +" + to_hunk_range(new_start, new_count) + " @@\n";
+
+    size_t old_pos = old_start;
+    for(size_t b=first; b<=last; b++) {
+      const DIFF_RANGE & block = blocks[b];
+      for(; old_pos<block.old_start; old_pos++)
+        append_diff_line(diff, ' ', lines.old_lines[old_pos]);
+      for(size_t k=block.old_start; k<block.old_end; k++)
+        append_diff_line(diff, '-', lines.old_lines[k]);
+      for(size_t k=block.new_start; k<block.new_end; k++)
+        append_diff_line(diff, '+', lines.new_lines[k]);
+      old_pos = block.old_end;
+    }
+    for(; old_pos<blocks[last].old_end + after; old_pos++)
+      append_diff_line(diff, ' ', lines.old_lines[old_pos]);
+
+    first = last + 1;
+  }
+  return diff;
+}
+
+/// <summary>
+/// Compares the two versions of a file line by line.
+/// Returns the unified diff of the file, or a line with the number of added lines, the number of removed lines and the path of the file.
+/// Returns an empty string if the versions are identical.
+/// </summary>
+std::string to_file_diff(std::string_view old_content, std::string_view new_content, const std::string & path, DIFF_FORMAT format, DIFF_STATS & stats) {
+  stats.lines_added = 0;
+  stats.lines_removed = 0;
+  if (old_content == new_content)
+    return std::string();
+
+  DiffLines lines;
+  split_diff_lines(old_content, lines.old_lines);
+  split_diff_lines(new_content, lines.new_lines);
+  assign_line_ids(lines);
+  compare_lines(lines);
+
+  for(size_t i=0; i<lines.old_changed.size(); i++)
+    stats.lines_removed += lines.old_changed[i];
+  for(size_t i=0; i<lines.new_changed.size(); i++)
+    stats.lines_added += lines.new_changed[i];
+
+  if (format == DIFF_FORMAT_STATS)
+    return to_string(stats.lines_added) + "\t" + to_string(stats.lines_removed) + "\t" + path + "\n";
+  return to_unified_diff(lines, path);
+}
+
+/// <summary>
+/// Returns the diff of a deleted file, in the format of 'diff -r' for a file which only exists in the old version.
+/// </summary>
+std::string to_deleted_file_diff(const std::string & path, DIFF_FORMAT format) {
+  if (format == DIFF_FORMAT_STATS)
+    return "-\t-\t" + path + "\n";
+  std::string parent_directory = get_parent_directory(path.c_str());
+  std::string file_name = get_file_name_with_extension(path.c_str());
+  return "Only in " + parent_directory + ": " + file_name + "\n";
+}
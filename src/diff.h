@@ -0,0 +1,20 @@
+#include <stdio.h>
+#include <string>
+#include <string_view>
+
+// Output of a dry run.
+enum DIFF_FORMAT {
+  DIFF_FORMAT_UNIFIED,  // unified diff of each modified file
+  DIFF_FORMAT_STATS     // number of added and removed lines of each modified file
+};
+
+// The number of lines that differ between two versions of a file.
+struct DIFF_STATS {
+  size_t lines_added;
+  size_t lines_removed;
+};
+
+// declarations
+bool parse_diff_format(const std::string & name, DIFF_FORMAT & format);
+std::string to_file_diff(std::string_view old_content, std::string_view new_content, const std::string & path, DIFF_FORMAT format, DIFF_STATS & stats);
+std::string to_deleted_file_diff(const std::string & path, DIFF_FORMAT format);
@@ -0,0 +1,397 @@
+// diffcheck.cpp : Compares the output of a candidate build of filterhtml or filterimagesizes with a reference build.
+//
+
+#include <stdio.h>
+#include <string>
+#include <iostream>     // std::cout
+#include <vector>
+#include <map>
+#include <sstream>
+
+#include "utils.h"
+#include "corpus.h"
+#include "process.h"
+
+// Number of bytes displayed before and after the first difference of a file.
+static const size_t DIFFERENCE_CONTEXT_SIZE = 40;
+
+struct Arguments {
+  std::string tool;
+  std::string reference;
+  std::string candidate;
+  std::string reference_args;
+  std::string candidate_args;
+  std::string input_directory;
+  std::string work_directory;
+  std::string posts;
+  std::string seed;
+  std::string runs;
+  std::string idempotence;
+};
+
+// The files of a directory, indexed by their path relative to the directory.
+typedef std::map<std::string, std::string> DirectoryContent;
+
+struct CHECK_SUMMARY {
+  size_t num_files;
+  size_t num_differences;
+  size_t num_not_idempotent;
+  size_t num_errors;
+};
+
+/// <summary>
+/// Loads all files of a directory and its sub directories.
+/// </summary>
+bool load_directory(const std::string & directory, DirectoryContent & files, std::string & error) {
+  files.clear();
+  std::vector<std::string> paths = get_files_in_directory(directory.c_str());
+  for(size_t i=0; i<paths.size(); i++) {
+    const std::string & path = paths[i];
+    if (dir_exists(path.c_str()))
+      continue;
+
+    std::string content;
+    if (!load_file(path, content, error))
+      return false;
+    files[path.substr(directory.size())] = content;
+  }
+  return true;
+}
+
+/// <summary>
+/// Writes the files in a directory. Returns false if a file cannot be written.
+/// </summary>
+bool save_directory(const std::string & directory, const DirectoryContent & files, std::string & error) {
+  for(DirectoryContent::const_iterator it = files.begin(); it != files.end(); ++it) {
+    std::string path = directory + it->first;
+    std::string parent = get_parent_directory(path.c_str());
+    if (!create_directories(parent)) {
+      error = "Unable to create directory '" + parent + "'.";
+      return false;
+    }
+    if (!save_file(path, it->second)) {
+      error = "Unable to write file '" + path + "'.";
+      return false;
+    }
+  }
+  return true;
+}
+
+/// <summary>
+/// Deletes the files of a directory which are not in the given list, so that the directory matches the list after save_directory().
+/// </summary>
+void delete_other_files(const std::string & directory, const DirectoryContent & files) {
+  std::vector<std::string> paths = get_files_in_directory(directory.c_str());
+  for(size_t i=0; i<paths.size(); i++) {
+    const std::string & path = paths[i];
+    if (!dir_exists(path.c_str()) && files.find(path.substr(directory.size())) == files.end())
+      delete_file(path);
+  }
+}
+
+/// <summary>
+/// Returns the content around the given offset, with the special characters escaped.
+/// </summary>
+std::string get_difference_context(const std::string & content, size_t offset) {
+  size_t start = (offset > DIFFERENCE_CONTEXT_SIZE ? offset - DIFFERENCE_CONTEXT_SIZE : 0);
+  size_t end = std::min(content.size(), offset + DIFFERENCE_CONTEXT_SIZE);
+
+  std::string context;
+  for(size_t i=start; i<end; i++) {
+    if (i == offset)
+      context += "[>]";
+    char c = content[i];
+    if (c == '\n')
+      context += "\\n";
+    else if (c == '\r')
+      context += "\\r";
+    else if (c == '\t')
+      context += "\\t";
+    else
+      context += c;
+  }
+  if (offset >= content.size())
+    context += "[>]<end of file>";
+  return context;
+}
+
+/// <summary>
+/// Compares two versions of a file. Displays the first differing byte and its context.
+/// Returns true if the files are identical.
+/// </summary>
+bool compare_file(const std::string & name, const std::string & expected, const std::string & actual, const char * expected_label, const char * actual_label) {
+  if (expected == actual)
+    return true;
+
+  size_t offset = 0;
+  size_t line = 1;
+  size_t column = 1;
+  while(offset < expected.size() && offset < actual.size() && expected[offset] == actual[offset]) {
+    if (expected[offset] == '\n') {
+      line++;
+      column = 1;
+    } else {
+      column++;
+    }
+    offset++;
+  }
+
+  std::cout << "  " << name << ": first difference at byte " << offset << " (line " << line << ", column " << column << ").\n";
+  std::cout << "    " << expected_label << ": " << get_difference_context(expected, offset) << "\n";
+  std::cout << "    " << actual_label << ": " << get_difference_context(actual, offset) << "\n";
+  return false;
+}
+
+/// <summary>
+/// Compares all files of two directories. Returns the number of files that are different or missing in one of the directories.
+/// </summary>
+size_t compare_directories(const DirectoryContent & expected, const DirectoryContent & actual, const char * expected_label, const char * actual_label) {
+  size_t num_differences = 0;
+  for(DirectoryContent::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+    DirectoryContent::const_iterator other = actual.find(it->first);
+    if (other == actual.end()) {
+      std::cout << "  " << it->first << ": missing from " << actual_label << ".\n";
+      num_differences++;
+    } else if (!compare_file(it->first, it->second, other->second, expected_label, actual_label)) {
+      num_differences++;
+    }
+  }
+  for(DirectoryContent::const_iterator it = actual.begin(); it != actual.end(); ++it) {
+    if (expected.find(it->first) == expected.end()) {
+      std::cout << "  " << it->first << ": missing from " << expected_label << ".\n";
+      num_differences++;
+    }
+  }
+  return num_differences;
+}
+
+/// <summary>
+/// Runs a tool on a directory prepared by prepare_directory().
+/// </summary>
+bool run_tool(const Arguments & args, const std::string & executable, const std::string & tool_args, const std::string & directory, bool generated) {
+  std::string separator = get_file_separator();
+  std::vector<std::string> command;
+  command.push_back(executable);
+  if (args.tool == "filterhtml") {
+    command.push_back("--id=" + (generated ? directory + separator + "content" + separator + "posts" : directory));
+    command.push_back("--manifest=off");
+  } else {
+    command.push_back("--wp-content=" + directory + separator + "wp-content");
+    command.push_back("--content=" + directory + separator + "content");
+  }
+  std::vector<std::string> extra_args = split(tool_args, ' ');
+  for(size_t i=0; i<extra_args.size(); i++) {
+    if (!extra_args[i].empty())
+      command.push_back(extra_args[i]);
+  }
+
+  PROCESS_STATISTICS statistics;
+  if (!run_process(command, statistics)) {
+    std::cout << "Error. Failed to execute '" << executable << "'.\n";
+    return false;
+  }
+  if (statistics.exit_code != 0) {
+    std::cout << "Error. '" << executable << "' exited with code " << statistics.exit_code << ".\n";
+    return false;
+  }
+  return true;
+}
+
+/// <summary>
+/// Resets a working directory to the original files.
+/// </summary>
+bool prepare_directory(const std::string & directory, const DirectoryContent & original, std::string & error) {
+  if (!create_directories(directory)) {
+    error = "Unable to create directory '" + directory + "'.";
+    return false;
+  }
+  delete_other_files(directory, original);
+  return save_directory(directory, original, error);
+}
+
+/// <summary>
+/// Converts the original files with the reference and the candidate, compares the outputs
+/// and checks that converting the output of the candidate again does not change anything.
+/// </summary>
+void check_corpus(const Arguments & args, const DirectoryContent & original, const std::string & run_directory, bool generated, CHECK_SUMMARY & summary) {
+  std::string separator = get_file_separator();
+  std::string reference_directory = run_directory + separator + "reference";
+  std::string candidate_directory = run_directory + separator + "candidate";
+
+  std::string error;
+  if (!prepare_directory(reference_directory, original, error) || !prepare_directory(candidate_directory, original, error)) {
+    std::cout << "Error. " << error << "\n";
+    summary.num_errors++;
+    return;
+  }
+
+  if (!run_tool(args, args.reference, args.reference_args, reference_directory, generated) ||
+      !run_tool(args, args.candidate, args.candidate_args, candidate_directory, generated)) {
+    summary.num_errors++;
+    return;
+  }
+
+  DirectoryContent reference_output;
+  DirectoryContent candidate_output;
+  if (!load_directory(reference_directory, reference_output, error) || !load_directory(candidate_directory, candidate_output, error)) {
+    std::cout << "Error. " << error << "\n";
+    summary.num_errors++;
+    return;
+  }
+
+  summary.num_files += reference_output.size();
+  summary.num_differences += compare_directories(reference_output, candidate_output, "reference", "candidate");
+
+  if (args.idempotence == "off")
+    return;
+
+  // A second conversion of the output must not change anything
+  if (!run_tool(args, args.candidate, args.candidate_args, candidate_directory, generated)) {
+    summary.num_errors++;
+    return;
+  }
+  DirectoryContent second_output;
+  if (!load_directory(candidate_directory, second_output, error)) {
+    std::cout << "Error. " << error << "\n";
+    summary.num_errors++;
+    return;
+  }
+  summary.num_not_idempotent += compare_directories(candidate_output, second_output, "first run", "second run");
+}
+
+void show_usage() {
+  std::cout << "diffcheck\n";
+  std::cout << "Usage:\n";
+  std::cout << "  Convert the same files with a reference and a candidate build of filterhtml or filterimagesizes\n";
+  std::cout << "  and display the first differing byte of each file. Also checks that converting the output of\n";
+  std::cout << "  the candidate a second time changes nothing.\n";
+  std::cout << "Arguments:\n";
+  std::cout << "  --reference=<path>\t\tPath to the reference executable.\n";
+  std::cout << "  --candidate=<path>\t\tPath to the candidate executable. Defaults to the reference executable.\n";
+  std::cout << "  --reference-args=<args>\tSpace separated arguments of the reference executable.\n";
+  std::cout << "  --candidate-args=<args>\tSpace separated arguments of the candidate executable.\n";
+  std::cout << "  --tool=<name>\t\t\t'filterhtml' (default) or 'filterimagesizes'.\n";
+  std::cout << "  --input=<dir>\t\t\tDirectory of the files to convert. The directory is not modified.\n";
+  std::cout << "  --posts=<n>\t\t\tNumber of posts of the generated corpus, if --input is not specified. Defaults to 100.\n";
+  std::cout << "  --seed=<n>\t\t\tSeed of the first generated corpus. Defaults to 1.\n";
+  std::cout << "  --runs=<n>\t\t\tNumber of generated corpora, with consecutive seeds. Defaults to 1.\n";
+  std::cout << "  --idempotence=<on|off>\tCheck that a second conversion changes nothing. Defaults to on.\n";
+  std::cout << "  --work-dir=<dir>\t\tDirectory where the files are converted. Defaults to the TEMP directory.\n";
+  std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+  Arguments args;
+
+  // Show usage if nothing is specified.
+  if (argc <= 1) {
+    show_usage();
+    return 1;
+  }
+
+  args.tool = find_argument("tool", argc, argv);
+  args.reference = find_argument("reference", argc, argv);
+  args.candidate = find_argument("candidate", argc, argv);
+  args.reference_args = find_argument("reference-args", argc, argv);
+  args.candidate_args = find_argument("candidate-args", argc, argv);
+  args.input_directory = find_argument("input", argc, argv);
+  args.work_directory = find_argument("work-dir", argc, argv);
+  args.posts = find_argument("posts", argc, argv);
+  args.seed = find_argument("seed", argc, argv);
+  args.runs = find_argument("runs", argc, argv);
+  args.idempotence = find_argument("idempotence", argc, argv);
+
+  if (args.tool.empty())
+    args.tool = "filterhtml";
+  if (args.tool != "filterhtml" && args.tool != "filterimagesizes") {
+    std::cout << "Error. Unknown tool '" << args.tool << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  if (args.reference.empty()) {
+    std::cout << "Error. Please specify --reference=<path> argument.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  if (args.candidate.empty())
+    args.candidate = args.reference;
+  if (!file_exists(args.reference.c_str()) || !file_exists(args.candidate.c_str())) {
+    std::cout << "Error. File not found: '" << (file_exists(args.reference.c_str()) ? args.candidate : args.reference) << "'.\n";
+    return 2;
+  }
+  if (args.work_directory.empty())
+    args.work_directory = get_temp_directory() + get_file_separator() + "diffcheck";
+  if (!args.idempotence.empty() && args.idempotence != "on" && args.idempotence != "off") {
+    std::cout << "Error. Invalid idempotence option '" << args.idempotence << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+
+  size_t num_posts = 100;
+  size_t seed = 1;
+  size_t num_runs = 1;
+  if (!args.posts.empty() && is_numeric(args.posts.c_str()))
+    parse_value(args.posts, num_posts);
+  if (!args.seed.empty() && is_numeric(args.seed.c_str()))
+    parse_value(args.seed, seed);
+  if (!args.runs.empty() && is_numeric(args.runs.c_str()))
+    parse_value(args.runs, num_runs);
+
+  CHECK_SUMMARY summary = { 0, 0, 0, 0 };
+  std::string separator = get_file_separator();
+  while (args.input_directory.size() > 1 && args.input_directory[args.input_directory.size() - 1] == separator[0])
+    args.input_directory.erase(args.input_directory.size() - 1);
+  if (!args.input_directory.empty()) {
+    if (!dir_exists(args.input_directory.c_str())) {
+      std::cout << "Directory not found: '" << args.input_directory << "'.\n";
+      return 2;
+    }
+
+    std::cout << "Checking directory '" << args.input_directory << "'.\n";
+    DirectoryContent original;
+    std::string error;
+    if (!load_directory(args.input_directory, original, error)) {
+      std::cout << "Error. " << error << "\n";
+      return 3;
+    }
+    check_corpus(args, original, args.work_directory + separator + "input", false, summary);
+  } else {
+    for(size_t i=0; i<num_runs; i++) {
+      CorpusOptions options;
+      options.num_posts = num_posts;
+      options.num_images = num_posts;
+      options.seed = (unsigned int)(seed + i);
+      std::cout << "Checking generated corpus with seed " << options.seed << ".\n";
+
+      // Generate the corpus in its own directory, then use it as the original files
+      std::string run_directory = args.work_directory + separator + "seed-" + to_string(options.seed);
+      std::string source_directory = run_directory + separator + "source";
+      CORPUS_INFO corpus;
+      DirectoryContent original;
+      std::string error;
+      if (!generate_corpus(source_directory, options, corpus, error) || !load_directory(source_directory, original, error)) {
+        std::cout << "Error. " << error << "\n";
+        return 4;
+      }
+      check_corpus(args, original, run_directory, true, summary);
+    }
+  }
+
+  std::cout << "Compared " << summary.num_files << " files. " << summary.num_differences << " files differ from the reference.";
+  if (args.idempotence != "off")
+    std::cout << " " << summary.num_not_idempotent << " files change when converted again.";
+  std::cout << "\n";
+
+  if (summary.num_errors > 0) {
+    std::cout << "Error. " << summary.num_errors << " conversions failed.\n";
+    return 5;
+  }
+  if (summary.num_differences > 0 || summary.num_not_idempotent > 0)
+    return 6;
+
+	return 0;
+}
@@ -7,1395 +7,666 @@
 #include <fstream>      // std::ifstream
 #include <vector>
 #include <sstream>
-#include <algorithm>    // std::min
+#include <algorithm>    // std::min, std::remove_if
 
 #include "utils.h"
+#include "filters.h"
+#include "threadpool.h"
+#include "manifest.h"
+#include "profiler.h"
+#include "scan.h"
+#include "pipeline.h"
+#include "site.h"
+#include "frontmatter.h"
+#include "diff.h"
 
-static std::string WEBSITE_HOSTNAME = "http://www.end2endzone.com";
 static bool process_file_in_place = true;
 
-static const char link_reference_endding_characters[] = { '\n', '\0' };
-static const size_t num_link_reference_endding_characters = sizeof(link_reference_endding_characters) / sizeof(link_reference_endding_characters[0]);
+enum CONVERSION_ENGINE {
+  CONVERSION_ENGINE_PASSES,
+  CONVERSION_ENGINE_TREE
+};
+static CONVERSION_ENGINE conversion_engine = CONVERSION_ENGINE_PASSES;
+static size_t max_passes = 15;
+static size_t num_jobs = 1;
+static bool use_manifest = true;
+static bool use_profile = false;
+static std::string trace_path;
+static bool dry_run = false;
+static std::string diff_path;
+static DIFF_FORMAT diff_format = DIFF_FORMAT_UNIFIED;
+
+// Version of the filters. Increase this value when a change to the filters modifies the converted files.
+// Files converted by another version are converted again even if they are listed in the manifest.
+static const int FILTER_SET_VERSION = 5;
 
 struct Arguments {
   std::string input_file;
   std::string input_directory;
+  std::string engine;
+  std::string profile_set;
+  std::string site;
+  std::string max_passes;
+  std::string jobs;
+  std::string manifest;
+  std::string trace;
+  std::string scan;
+  std::string diff;
+  std::string diff_format;
+};
+
+// The result of the conversion of a file.
+struct FileConversion {
+  std::string saved_file; // path of the saved file, empty if the file was not saved
+  uint64_t input_hash;
+  uint64_t output_hash;
+  bool skipped;           // true if the file was already converted by a previous run
+  EOL_TYPE eol_type;      // newline of the input file, restored in the output file
+  std::string diff;       // changes of a dry run, see to_file_diff()
+  DIFF_STATS diff_stats;
 };
 
 int process_directory(const std::string & input_directory);
-int process_file(const std::string & input_file);
-
-void filter_span(std::string & content);
-void filter_paragraph_with_custom_css(std::string & content);
-void filter_paragraph(std::string & content);
-void filter_images(std::string & content);
-void filter_anchors(std::string & content);
-void filter_strong(std::string & content);
-void filter_italic(std::string & content);
-void filter_emphasized(std::string & content);
-void filter_code(std::string & content);
-void filter_unordered_lists(std::string & content);
-void filter_list_item(std::string & content);
-void filter_list_item_simplify(std::string & content);
-void filter_preformatted_code_simplify(std::string & content);
-void filter_division(std::string & content);
-void filter_division_gallery(std::string & content);
-void filter_table(std::string & content);
-void filter_preformatted(std::string & content);
-void filter_small(std::string & content);
-void filter_known_html_entities(std::string & content);
-void filter_more_html_entities(std::string & content);
-void filter_useless_nbsp_entities(std::string & content);
-void filter_table_cells_inner_white_space(std::string & content);
-void filter_table_cells_outer_white_space(std::string & content);
-void filter_table_rows_outer_white_space(std::string & content);
-void force_inline_hyperlinks(std::string & content);
-void filter_missing_newline(std::string & content, const std::string & tag_close_definition);
-void filter_missing_newline(std::string & content);
-void filter_missing_newline_after_header(std::string & content);
-void filter_featured_image(std::string & content);
-void filter_comment_separators(std::string & content);
-void filter_type_post(std::string & content);
-void filter_more_comment(std::string & content);
+int process_file(const std::string & input_file, const MANIFEST_ENTRY * previous_conversion, FileConversion & conversion);
+int save_files_to_disk(const std::vector<std::string> & saved_files);
+int report_profile(const Profile & profile, size_t num_files);
+int report_dry_run(const std::vector<FileConversion> & conversions);
+std::string get_filter_settings();
 
 void run_all_filters(std::string & content);
 
 /// <summary>
-/// This filter is required since all my headers (h1, h2, h3...) are wrapped in a "<span>".
+/// Runs a filter and records its statistics in the profile of the current thread, if any.
 /// </summary>
-/// <remarks>
-/// For example: "# <span id="Introduction">Introduction</span>"
-/// This filter removes the "<span>" tags but only if there is no html inside the tag.
-/// </remarks>
-void filter_span(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "span", offset, info)) {
-    size_t tag_length = info.close_end - info.open_start + 1;
-    std::string tag_content = content.substr(info.open_start, tag_length);
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag. Do not use close_end to prevent skipping tags within other tags of the same type.
-      // For example, <span><span>foo bar</span></span>
-      offset = info.open_end + 1;
-    } else {
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-    }
-  }
-}
+template <typename Filter>
+inline size_t run_filter(size_t pass, std::string & content) {
+  // The temporaries of the filter are released as soon as the filter completes
+  FileArenaScope arena_scope;
+  Profile * profile = get_profile();
+  if (profile == NULL)
+    return Filter::run(content);
 
-inline bool is_custom_css_class(const std::string & class_) {
-  if (class_.find("pleasenote") != std::string::npos)
-    return true;
-  if (class_.find("postedit") != std::string::npos)
-    return true;
-  if (class_.find("renamep") != std::string::npos)
-    return true;
-  return false;
+  int64_t start = get_profile_time();
+  size_t count = Filter::run(content);
+  add_filter_sample(*profile, Filter::name(), pass, start, get_profile_time(), count);
+  return count;
 }
 
-/// <summary>
-/// This filter removes all <p> tags.
-/// I use multiple custom css classes in my original wordpress posts. For example: 
-///  * `pleasenote` is used to emphasise a note.
-///  * `postedit`, to highlight post edits after publishing (after first public release).
-/// Each paragraph that had custom css classes are wrapped in a shortcode which name matches the name of the class.
-/// For example:
-///   {{< postedit >}}
-///     Source code is now moved to GitHub. Source code can be downloaded from [the project's GitHub page](http://github.com/end2endzone/msbuildreorder).
-///   {{< /postedit >}}
-/// And the shortcode for postedit is the following:
-///   <p class="postedit">
-///     {{ .Inner | markdownify }}
-///   </p>
-/// This filter removes the "<p>" tags but only if there is no html inside the tag.
-/// </summary>
-void filter_paragraph_with_custom_css(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "p", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    std::string class_value = get_html_attribute_value(content, "class", info);
-    bool has_custom_css_class = is_custom_css_class(class_value);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else if (has_custom_css_class) {
-      // Wrap the content inside a custom shortcode that matches the name of the css class
-      
-      // Clean up inner text
-      trim_html_whitespace(inner_text);
-
-      std::string markdown;
-      markdown.append("{{< ");
-      markdown.append(class_value);
-      markdown.append(" >}}\n");
-      markdown.append("  ");
-      markdown.append(inner_text + "\n");
-      markdown.append("{{< /");
-      markdown.append(class_value);
-      markdown.append(" >}}\n");
-      
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown);
-    } else {
-
-      // Clean up inner text
-      trim_html_whitespace(inner_text);
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-    }
-  }
+inline size_t call_filter(size_t (*filter)(std::string &), std::string & content) {
+  return filter(content);
 }
 
-/// <summary>
-/// This filter removes all <p> tags.
-/// This filter removes the "<p>" tags but only if there is no html inside the tag.
-/// The "<p>" tag is skipped if it uses one of my custom css classes.
-/// </summary>
-void filter_paragraph(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "p", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    std::string class_value = get_html_attribute_value(content, "class", info);
-    bool has_custom_css_class = is_custom_css_class(class_value);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else if (has_custom_css_class) {
-      // Do not replace <p> tags that has our custom css classes.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-
-      // Clean up inner text
-      trim_html_whitespace(inner_text);
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-    }
-  }
-}
-
-/// <summary>
-/// This filter replaces all <img> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_images(std::string & content) {
-  HTML_TAG_INFO info = {0};
-  info.open_start = content.find("<img", 0);
-  while(!content.empty() && info.open_start != std::string::npos) {
-    size_t open_end_1 = content.find(">", info.open_start);
-    size_t open_end_2 = content.find("/>", info.open_start);
-    size_t open_end_pattern_length = 0;
-    if (open_end_1 != std::string::npos && open_end_2 != std::string::npos)
-      info.open_end = std::min(open_end_1, open_end_2);
-    else if (open_end_1 != std::string::npos)
-      info.open_end = open_end_1;
-    else if (open_end_2 != std::string::npos)
-      info.open_end = open_end_2;
-    if (info.open_end == open_end_1)
-      open_end_pattern_length = 1;
-    else if (info.open_end == open_end_2)
-      open_end_pattern_length = 2;
-
-    std::string src = get_html_attribute_value(content, "src", info);
-    std::string alt = get_html_attribute_value(content, "alt", info);
-
-    if (!src.empty() && !alt.empty()) {
-      std::string markdown_image = std::string("![") + alt + "](" + src + ")";
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.open_end + open_end_pattern_length, markdown_image);
-    } else if (!src.empty()) {
-      std::string markdown_image = std::string("![](") + src + ")";
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.open_end + open_end_pattern_length, markdown_image);
-
-      // next tag
-      info.open_start = content.find("<img", info.open_start);
-    } else {
-      // next tag
-      info.open_start = content.find("<img", info.open_start + 1);
-    }
-  }
-}
-
-/// <summary>
-/// This filter replaces all <a> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_anchors(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "a", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    std::string href_value  = get_html_attribute_value(content, "href", info);
-    std::string title_value = get_html_attribute_value(content, "title", info);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html || href_value.empty() || inner_text.empty()) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      std::string markdown_anchor;
-      
-      if (!inner_text.empty()) {
-        markdown_anchor = std::string("[") + inner_text + "](" + href_value + ")";
-        if (!title_value.empty()) {
-          markdown_anchor.erase(markdown_anchor.size() - 1, 1);
-          markdown_anchor.append(" \"");
-          markdown_anchor.append(title_value);
-          markdown_anchor.append("\")");
-        }
-      }
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_anchor);
-    }
-  }
-}
-
-/// <summary>
-/// This filter replaces all <strong> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_strong(std::string & content, const char * tag_name) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, tag_name, offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      std::string markdown_strong;
-      
-      if (!inner_text.empty()) {
-        markdown_strong = std::string("**") + inner_text + "**";
-      }
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_strong);
-    }
-  }
+inline size_t call_filter(void (*filter)(std::string &), std::string & content) {
+  filter(content);
+  return 0;
 }
 
-/// <summary>
-/// This filter replaces all <strong> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-inline void filter_strong(std::string & content) {
-  filter_strong(content, "strong");
-  filter_strong(content, "b");
-}
+// Declares the type of a filter function for the filter lists.
+#define DECLARE_FILTER_TYPE(type, filter, dependencies) \
+  struct type { \
+    typedef dependencies RunsAfter; \
+    static const char * name() { return #filter; } \
+    static size_t run(std::string & content) { return call_filter(filter, content); } \
+  };
+
+DECLARE_FILTER_TYPE(FilterPreformattedCodeSimplify,   filter_preformatted_code_simplify,    FilterList<>)
+DECLARE_FILTER_TYPE(FilterKnownHtmlEntities,          filter_known_html_entities,           FilterList<>)
+DECLARE_FILTER_TYPE(FilterUselessNbspEntities,        filter_useless_nbsp_entities,         FilterList<>)
+DECLARE_FILTER_TYPE(FilterCommentSeparators,          filter_comment_separators,            FilterList<>)
+DECLARE_FILTER_TYPE(FilterMissingNewlineAfterHeader,  filter_missing_newline_after_header,  FilterList<>)
+DECLARE_FILTER_TYPE(FilterMissingNewline,             filter_missing_newline,               FilterList<>)
+DECLARE_FILTER_TYPE(FilterMoreComment,                filter_more_comment,                  FilterList<>)
+DECLARE_FILTER_TYPE(FilterFrontMatter,                filter_front_matter,                  FilterList<>)
+DECLARE_FILTER_TYPE(FilterSpan,                       filter_span,                          FilterList<>)
+DECLARE_FILTER_TYPE(FilterParagraphWithCustomCss,     filter_paragraph_with_custom_css,     FilterList<>)
+DECLARE_FILTER_TYPE(FilterParagraph,                  filter_paragraph,                     FilterList<>)
+DECLARE_FILTER_TYPE(FilterImages,                     filter_images,                        FilterList<>)
+DECLARE_FILTER_TYPE(FilterStrong,                     filter_strong,                        FilterList<>)
+DECLARE_FILTER_TYPE(FilterItalic,                     filter_italic,                        FilterList<>)
+DECLARE_FILTER_TYPE(FilterAnchors,                    filter_anchors,                       FilterList<>)
+DECLARE_FILTER_TYPE(FilterEmphasized,                 filter_emphasized,                    FilterList<>)
+DECLARE_FILTER_TYPE(FilterCode,                       filter_code,                          FilterList<FilterPreformattedCodeSimplify>)
+DECLARE_FILTER_TYPE(FilterUnorderedLists,             filter_unordered_lists,               FilterList<>)
+DECLARE_FILTER_TYPE(FilterListItemSimplify,           filter_list_item_simplify,            FilterList<>)
+DECLARE_FILTER_TYPE(FilterListItem,                   filter_list_item,                     FilterList<FilterListItemSimplify>)
+DECLARE_FILTER_TYPE(FilterDivisionGallery,            filter_division_gallery,              FilterList<>)
+DECLARE_FILTER_TYPE(FilterTable,                      filter_table,                         FilterList<>)
+DECLARE_FILTER_TYPE(FilterDivision,                   filter_division,                      FilterList<FilterDivisionGallery>)
+DECLARE_FILTER_TYPE(FilterPreformatted,               filter_preformatted,                  FilterList<>)
+DECLARE_FILTER_TYPE(FilterSmall,                      filter_small,                         FilterList<>)
+DECLARE_FILTER_TYPE(FilterTableWhiteSpace,            filter_table_white_space,             FilterList<>)
+DECLARE_FILTER_TYPE(ForceInlineHyperlinks,            force_inline_hyperlinks,              FilterList<>)
+
+// The conversion of the tree engine which replaces a filter of the passes. Filters without a conversion have none.
+template <typename Filter>
+struct TreeConversion {
+  static constexpr unsigned int value = 0;
+};
 
-/// <summary>
-/// This filter replaces all <i> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_italic(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "i", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      std::string markdown_italic;
-      
-      if (!markdown_italic.empty()) {
-        markdown_italic = std::string("_") + inner_text + "_";
-      }
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_italic);
-    }
-  }
-}
+#define DECLARE_TREE_CONVERSION(type, conversion) \
+  template <> \
+  struct TreeConversion<type> { \
+    static constexpr unsigned int value = conversion; \
+  };
+
+DECLARE_TREE_CONVERSION(FilterSpan,                   TREE_CONVERSION_SPAN)
+DECLARE_TREE_CONVERSION(FilterParagraphWithCustomCss, TREE_CONVERSION_PARAGRAPH_WITH_CUSTOM_CSS)
+DECLARE_TREE_CONVERSION(FilterParagraph,              TREE_CONVERSION_PARAGRAPH)
+DECLARE_TREE_CONVERSION(FilterImages,                 TREE_CONVERSION_IMAGES)
+DECLARE_TREE_CONVERSION(FilterStrong,                 TREE_CONVERSION_STRONG)
+DECLARE_TREE_CONVERSION(FilterItalic,                 TREE_CONVERSION_ITALIC)
+DECLARE_TREE_CONVERSION(FilterAnchors,                TREE_CONVERSION_ANCHORS)
+DECLARE_TREE_CONVERSION(FilterEmphasized,             TREE_CONVERSION_EMPHASIZED)
+DECLARE_TREE_CONVERSION(FilterCode,                   TREE_CONVERSION_CODE)
+DECLARE_TREE_CONVERSION(FilterUnorderedLists,         TREE_CONVERSION_UNORDERED_LISTS)
+DECLARE_TREE_CONVERSION(FilterListItemSimplify,       TREE_CONVERSION_LIST_ITEM_SIMPLIFY)
+DECLARE_TREE_CONVERSION(FilterListItem,               TREE_CONVERSION_LIST_ITEM)
+DECLARE_TREE_CONVERSION(FilterDivisionGallery,        TREE_CONVERSION_DIVISION_GALLERY)
+DECLARE_TREE_CONVERSION(FilterTable,                  TREE_CONVERSION_TABLE)
+DECLARE_TREE_CONVERSION(FilterDivision,               TREE_CONVERSION_DIVISION)
+DECLARE_TREE_CONVERSION(FilterPreformatted,           TREE_CONVERSION_PREFORMATTED)
+DECLARE_TREE_CONVERSION(FilterSmall,                  TREE_CONVERSION_SMALL)
 
 /// <summary>
-/// This filter replaces all <em> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// Returns the conversions of the tree engine that replace the filters of the list.
 /// </summary>
-void filter_emphasized(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "em", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      std::string markdown_emphasized = inner_text;
-      
-      if (!markdown_emphasized.empty()) {
-        markdown_emphasized = std::string("_") + inner_text + "_";
-      }
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_emphasized);
-    }
-  }
+template <typename... Filters>
+constexpr unsigned int get_tree_conversions(FilterList<Filters...>) {
+  return (0u | ... | TreeConversion<Filters>::value);
 }
 
 /// <summary>
-/// This filter replaces all <code> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// Runs the pass filters of a profile set until a pass does not change the document.
 /// </summary>
-/// <remarks>
-/// If the text inside the tag is on a single line,  the content is wrapped inside '`' (backticks characters).
-/// If the text inside the tag is on multiple lines, the content is wrapped inside fenced code blocks (a triple "```" character sequence)
-/// </remarks>
-void filter_code(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "code", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-
-      bool is_single_line = (inner_text.find('\n') == std::string::npos);
-
-      trim_html_whitespace(inner_text);
-
-      // filter more html entities
-      filter_more_html_entities(inner_text);
-
-      std::string markdown_code;
-      if (!inner_text.empty()) {
-        if (is_single_line) {
-          markdown_code = std::string("`") + inner_text + "`";
-        } else {
-          markdown_code = std::string("\n```\n") + inner_text + "\n```\n";
-        }
-      }
+template <typename ProfileSet>
+void run_profile_set_passes(std::string & content) {
+  // Each pass converts at least one level of nested tags.
+  size_t depth = get_html_max_depth(content);
+  if (depth > max_passes)
+    get_log_stream() << "Warning. The document has " << depth << " levels of nested tags but the number of passes is limited to " << max_passes << ".\n";
+
+  // run multiple passes for tag that can embed other tags, until a pass does not change anything
+  size_t num_passes = 0;
+  size_t count = 1;
+  while(count > 0 && num_passes < max_passes) {
+    size_t pass = num_passes + 1;
+    ProfileScope pass_scope("pass " + to_string(pass), "pass");
+    count = run_filter_list(typename ProfileSet::PassFilters(), [&](auto filter) { return run_filter<decltype(filter)>(pass, content); });
+    num_passes++;
+  }
+  if (count > 0)
+    get_log_stream() << "Warning. The document is still changing after " << num_passes << " passes. Use --max-passes=<n> to allow more passes.\n";
+}
+
+// The tree engine, limited to the conversions of the pass filters of a profile set.
+// The elements that the tree engine cannot convert exactly like the passes are converted by the passes of the profile set.
+template <typename ProfileSet>
+struct RunTreeFilters {
+  typedef FilterList<> RunsAfter;
+  static constexpr unsigned int conversions = get_tree_conversions(typename ProfileSet::PassFilters());
+  static const char * name() { return "run_tree_filters"; }
+  static size_t run(std::string & content) { run_tree_filters(content, conversions, &run_profile_set_passes<ProfileSet>); return 0; }
+};
 
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_code);
-    }
-  }
-}
+// Filters that run once before and after the conversion of the html tags, for all profile sets.
+typedef FilterList<
+  FilterKnownHtmlEntities,
+  FilterUselessNbspEntities,
+  FilterCommentSeparators,
+  FilterMissingNewlineAfterHeader,
+  FilterMissingNewline,
+  FilterMoreComment> FrontFilters;
+
+typedef FilterList<
+  FilterTableWhiteSpace,
+  ForceInlineHyperlinks> FinalFilters;
+
+// All filters. This is the default profile set.
+struct AllProfileSet {
+  typedef FilterList<FilterPreformattedCodeSimplify> SingleRunFilters;
+  typedef FilterList<
+    FilterSpan,
+    FilterParagraphWithCustomCss,
+    FilterParagraph,
+    FilterImages,
+    FilterStrong,
+    FilterItalic,
+    FilterAnchors,
+    FilterEmphasized,
+    FilterCode,
+    FilterUnorderedLists,
+    FilterListItemSimplify,
+    FilterListItem,
+    FilterDivisionGallery,
+    FilterTable,
+    FilterDivision,
+    FilterPreformatted,
+    FilterSmall> PassFilters;
+};
+static_assert(get_tree_conversions(AllProfileSet::PassFilters()) == TREE_CONVERSION_ALL, "A conversion of the tree engine has no filter in the passes.");
+
+// Posts of the classic editor: header spans, custom css paragraphs, attachments and galleries.
+// Code blocks are plain <code> tags.
+struct ClassicProfileSet {
+  typedef FilterList<> SingleRunFilters;
+  typedef FilterList<
+    FilterSpan,
+    FilterParagraphWithCustomCss,
+    FilterParagraph,
+    FilterImages,
+    FilterStrong,
+    FilterItalic,
+    FilterAnchors,
+    FilterEmphasized,
+    FilterCode,
+    FilterUnorderedLists,
+    FilterListItemSimplify,
+    FilterListItem,
+    FilterDivisionGallery,
+    FilterTable,
+    FilterDivision,
+    FilterSmall> PassFilters;
+};
 
-/// <summary>
-/// This filter replaces all <li> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_list_item(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "li", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      trim_html_whitespace(inner_text);
-      std::string markdown_list_item = std::string("* ") + inner_text;
+// Posts of the block editor: code blocks are <pre class="wp-block-code"> tags. There are no spans, divisions or galleries.
+struct GutenbergProfileSet {
+  typedef FilterList<FilterPreformattedCodeSimplify> SingleRunFilters;
+  typedef FilterList<
+    FilterParagraph,
+    FilterImages,
+    FilterStrong,
+    FilterItalic,
+    FilterAnchors,
+    FilterEmphasized,
+    FilterCode,
+    FilterUnorderedLists,
+    FilterListItemSimplify,
+    FilterListItem,
+    FilterTable,
+    FilterPreformatted> PassFilters;
+};
 
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_list_item);
-    }
-  }
-}
+// Posts of the classic editor with code blocks of the Crayon Syntax Highlighter plugin (<div> and <pre> tags).
+struct CrayonProfileSet {
+  typedef FilterList<> SingleRunFilters;
+  typedef FilterList<
+    FilterSpan,
+    FilterParagraphWithCustomCss,
+    FilterParagraph,
+    FilterImages,
+    FilterStrong,
+    FilterItalic,
+    FilterAnchors,
+    FilterEmphasized,
+    FilterCode,
+    FilterUnorderedLists,
+    FilterListItemSimplify,
+    FilterListItem,
+    FilterDivisionGallery,
+    FilterTable,
+    FilterDivision,
+    FilterPreformatted,
+    FilterSmall> PassFilters;
+};
 
 /// <summary>
-/// This filter replaces all <ul> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// Execute all filters of a profile set one by one.
 /// </summary>
-void filter_unordered_lists(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "ul", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
+template <typename ProfileSet>
+void run_profile_set_filters(std::string & content) {
+  typedef typename ConcatFilterLists<typename ProfileSet::SingleRunFilters, FrontFilters, typename ProfileSet::PassFilters, FinalFilters>::type AllFilters;
+  static_assert(is_filter_list_ordered(AllFilters()), "A filter of the profile set runs before a filter it depends on.");
+
+  // The front matter is edited on its own. The other filters only process the body of the post.
+  size_t front_matter_length = get_front_matter_length(content);
+  std::string front_matter = content.substr(0, front_matter_length);
+  content.erase(0, front_matter_length);
+  run_filter<FilterFrontMatter>(0, front_matter);
+
+  auto run_single = [&](auto filter) { return run_filter<decltype(filter)>(0, content); };
+  run_filter_list(typename ProfileSet::SingleRunFilters(), run_single);
+  run_filter_list(FrontFilters(), run_single);
+
+  if (conversion_engine == CONVERSION_ENGINE_TREE)
+    run_filter<RunTreeFilters<ProfileSet> >(0, content);
+  else
+    run_profile_set_passes<ProfileSet>(content);
 
-    trim_html_whitespace(inner_text);
+  run_filter_list(FinalFilters(), run_single);
 
-    // replace
-    content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-  }
+  content.insert(0, front_matter);
 }
 
-/// <summary>
-/// This filter replaces all css justified <li> tags by plain <li> tags.
-/// This filter must be run before `filter_list_item()` function is called.
-/// </summary>
-/// <remarks>
-/// This is a custom issue about my posts on my previous web site. Some lists was formatted justified.
-/// This filter basically runs a search and replace to replace erase the "style='text-align: justify;'" html attribute in list items.
-/// </remarks>
-void filter_list_item_simplify(std::string & content) {
-  static const std::string complex_list_item = "<li style=\"text-align: justify;\">";
-  static const std::string simplified_list_item = "<li>";
-  size_t offset = content.find(complex_list_item);
-  while(offset != std::string::npos) {
-    // replace by a simplified version of the justified list item
-    content.replace(content.begin() + offset, content.begin() + offset + complex_list_item.size(), simplified_list_item);
-
-    // next tag
-    offset = content.find(complex_list_item, offset);
-  }
-}
-
-/// <summary>
-/// This filter removes all wordpress-generated <pre> tags which directly encloses <code> tags.
-/// </summary>
-/// <remarks>
-/// This filter must be run before `filter_code()` function is called.
-/// </remarks>
-void filter_preformatted_code_simplify(std::string & content) {
-  static const std::string complex_preformatted = "<pre class=\"wp-block-code\"><code>";
-  static const std::string simplified_preformatted = "<code>";
-  static const std::string complex_close_pattern = "</code></pre>";
-  static const std::string simplified_close_pattern = "</code>";
-  size_t offset = content.find(complex_preformatted);
-  while(offset != std::string::npos) {
-    // replace by a simplified version of the preformatted code
-    content.replace(content.begin() + offset, content.begin() + complex_preformatted.size() + 1, simplified_preformatted);
-
-    // search for the closing tags
-    size_t offset_close = content.find(complex_close_pattern);
-    if (offset_close != std::string::npos) {
-      // replace by a simplified version of the preformatted code
-      content.replace(content.begin() + offset_close, content.begin() + complex_close_pattern.size() + 1, simplified_close_pattern);
-    }
+struct PROFILE_SET {
+  const char * name;
+  void (*run_filters)(std::string & content);
+};
 
-    // next tag
-    offset = content.find(complex_preformatted, offset);
-  }
-}
+static const PROFILE_SET profile_sets[] = {
+  { "all",        run_profile_set_filters<AllProfileSet>        },
+  { "classic",    run_profile_set_filters<ClassicProfileSet>    },
+  { "gutenberg",  run_profile_set_filters<GutenbergProfileSet>  },
+  { "crayon",     run_profile_set_filters<CrayonProfileSet>     },
+};
+static const size_t num_profile_sets = sizeof(profile_sets) / sizeof(profile_sets[0]);
+static const PROFILE_SET * profile_set = &profile_sets[0];
 
 /// <summary>
-/// This filter removes all <div> tags, but only if there is no html inside the tag.
+/// Execute all filters of the selected profile set.
 /// </summary>
-/// <remarks>
-/// Most <div> tags are file downloads (attachments) like `<div id="attachment_2357" style="width: 560px" class="wp-caption alignnone">`.
-/// Divisions that are galleries must be processed first with function `filter_division_gallery()`.
-/// </remarks>
-void filter_division(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "div", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    std::string class_value = get_html_attribute_value(content, "class", info);
-    bool has_custom_css_class = is_custom_css_class(class_value);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else if (has_custom_css_class) {
-      // Do not replace <div> tags that has our custom css classes.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-      
-      // Check if the indentation of the content inside the division must be decreased.
-      size_t div_indentation = 0;
-      size_t inner_html_indentation = 0;
-      if (content[info.inner_start] == '\n' || (content[info.inner_start] == '\r' && content[info.inner_start+1] == '\n')) { // If div is the only tag on the line
-        size_t div_html_length = info.close_end - info.open_start;
-        std::string div_html = content.substr(info.open_start, div_html_length); 
-
-        // Check if the inner_html is more indented than the divivision itself
-        div_indentation = get_line_indentation(content.c_str(), info.open_start);
-        size_t nonwhite_pos = get_first_nonwhite_html_character(content.c_str(), info.inner_start);
-        if (nonwhite_pos != std::string::npos) {
-          inner_html_indentation = get_line_indentation(content.c_str(), nonwhite_pos);
-        }
-      }
-
-      // Remove first and last newline characters
-      if (!inner_text.empty() && inner_text[0] == '\n')
-        inner_text.erase(0, 1);
-      if (!inner_text.empty() && inner_text[inner_text.size()-1] == '\n')
-        inner_text.erase(inner_text.size()-1, 1);
-
-      // Check if we need to decease the indentation of the inner_text
-      if (inner_html_indentation > div_indentation) {
-
-        // Decrease indentation of inner_text
-        std::vector<std::string> lines = split(inner_text, '\n');
-        decrease_indent(lines, 2);
-        inner_text = join(lines, '\n');
-
-        // and then trim the inner text
-        trim_html_whitespace(inner_text);
-      } else {
-        // Trim the inner text
-        trim_html_whitespace(inner_text);
-      }
-
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-    }
-  }
+void run_all_filters(std::string & content) {
+  profile_set->run_filters(content);
 }
 
-inline bool is_division_gallery(const std::string & content, const HTML_TAG_INFO & info) {
-  if (content.empty() ||
-    (info.open_start == 0 && info.open_end == 0) ||
-    (info.open_start == std::string::npos || info.open_end == std::string::npos))
-    return false;
-
-  std::string id_value = get_html_attribute_value(content, "id", info);
-  std::string class_value = get_html_attribute_value(content, "id", info);
-
-  if (id_value.find("gallery") != std::string::npos && class_value.find("gallery") != std::string::npos)
-    return true;
-  return false;
+void show_usage() {
+  std::cout << "filterhtml\n";
+  std::cout << "Usage:\n";
+  std::cout << "  Replace html formatting in a markdown file by native markdown syntax.\n";
+  std::cout << "Features:\n";
+  std::cout << "  The following html tags are supported: span, p, img, a, strong, i, em, code, ul, li, pre, div, table.\n";
+  std::cout << "  The function 'filter_paragraph_with_custom_css()' supports paragraph with custom css classes.\n";
+  std::cout << "  These paragraphs are converted and a shortcode matching the custom css class is added before and after the paragraph's content.\n";
+  std::cout << "  Wordpress galleries are properly identified and converted to a markdown table.\n";
+  std::cout << "  Html tables which are missing an header row (or if the header row cannot be identified) have an additional empty row added at the beginning as the header.\n";
+  std::cout << "  All html5 named and numeric entities are decoded to their corresponding utf-8 character.\n";
+  std::cout << "  Whitespace is removed as much as possible.\n";
+  std::cout << "  Reference-style links are replaced by inline links.\n";
+  std::cout << "  Featured_image element in front matter is replaced by image.src format and 'type: post' is removed.\n";
+  std::cout << "  The front matter is parsed on its own: the html filters never modify it.\n";
+  std::cout << "Arguments:\n";
+  std::cout << "  --if=<path>\t\tPath to markdown file.\n";
+  std::cout << "  --id=<path>\t\tPath to directory with markdown files.\n";
+  std::cout << "  --engine=<name>\tConversion engine: 'passes' (default) or 'tree'.\n";
+  std::cout << "  --profile-set=<name>\tFilters to run: 'all' (default), 'classic', 'gutenberg' or 'crayon'.\n";
+  std::cout << "  --site=<path>\t\tSite profile file: hostname, encoding, custom css classes and Crayon languages. Defaults to www.end2endzone.com.\n";
+  std::cout << "  --max-passes=<n>\tMaximum number of passes of the 'passes' engine. Defaults to 15.\n";
+  std::cout << "  --jobs=<n>\t\tNumber of files converted in parallel with --id. Use 0 for the number of processors. Defaults to 1.\n";
+  std::cout << "  --manifest=<on|off>\tSkip the files of --id that are unchanged since the last run. Defaults to on.\n";
+  std::cout << "  --profile\t\tDisplay the time spent in each filter and each pass at the end of the run.\n";
+  std::cout << "  --trace=<path>\tSave the time spent in each file, pass and filter as a Chrome trace file.\n";
+  std::cout << "  --scan=<level>\tInstruction set of the scanning kernels: 'auto' (default), 'avx2', 'sse2' or 'scalar'.\n";
+  std::cout << "  --dry-run\t\tConvert the files in memory without modifying them and display the changes as a unified diff.\n";
+  std::cout << "  --diff=<path>\t\tSave the changes of --dry-run to a file instead of displaying them.\n";
+  std::cout << "  --diff-format=<name>\tFormat of the changes of --dry-run: 'unified' (default) or 'stats'.\n";
+  std::cout << "\n";
 }
 
-bool parse_gallery_table(std::string & content, HtmlTable & table) {
-  table.first_row_is_header = false;
-
-  HtmlTableRow tmp_row;
-
-  HTML_TAG_INFO dl_info;
-  size_t dl_offset = 0;
-  while (find_html_tag_boundaries(content, "dl", dl_offset, dl_info)) {
-    size_t dl_inner_length = dl_info.close_start - dl_info.inner_start;
-    std::string dl_inner_text = content.substr(dl_info.inner_start, dl_inner_length);
-
-    HTML_TAG_INFO dt_info;
-    size_t dt_offset = 0;
-    while (find_html_tag_boundaries(dl_inner_text, "dt", dt_offset, dt_info)) {
-      size_t dt_inner_length = dt_info.close_start - dt_info.inner_start;
-      std::string dt_inner_text = dl_inner_text.substr(dt_info.inner_start, dt_inner_length);
-
-      // Create a new cell in current row
-      tmp_row.push_back(dt_inner_text);
-
-      // next tag dt
-      dt_offset = dt_info.close_end + 1;
-    }
-
-    // If we read all column inside the row, flush the temporary row
-    if (!tmp_row.empty()) {
-      // Flush the row accumulator to the table
-      table.rows.push_back(tmp_row);
-      tmp_row.clear();
-    }
-
-    // next tag dl
-    dl_offset = dl_info.close_end + 1;
-  }
-
-  // If there is still cells in the temporary row (accumulator), flush them in the table
-  if (!tmp_row.empty()) {
-    table.rows.push_back(tmp_row);
-    tmp_row.clear();
-  }
-
-  if (!table.rows.empty()) {
-    return true;
+int process_directory(const std::string & input_directory) {
+  if (!dir_exists(input_directory.c_str())) {
+    std::cout << "Directory not found: '" << input_directory << "'.\n";
+    return 2;
   }
-  return false;
-}
 
-/// <summary>
-/// This filter removes all <div> tags, which are displaying image galleries, but only if there is no html inside the tag.
-/// </summary>
-/// <remarks>
-/// For example:
-///    <div id='gallery-22' class='gallery galleryid-1249 gallery-columns-3 gallery-size-thumbnail gallery1'>
-///      <dl class="gallery-item">
-///        <dt class="gallery-icon">
-///          <a href="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png" title="Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data" rel="gallery1"><img src="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample-146x150.png" width="146" height="150" alt="Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data" /></a><span><a class="void" href="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png" rel="nolightbox" target="_blank">498x510</a></span>
-///        </dt>
-///        <dd class="gallery-caption" id="caption1519">
-///          <span class="imagecaption">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br /> <span class="imagedescription">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br />
-///        </dd>
-///      </dl>
-///      <br style='clear: both' />
-///    </div>
-/// </remarks>
-void filter_division_gallery(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "div", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    if (!is_division_gallery(content, info)) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-
-      // Parse the gallery
-      HtmlTable table;
-      table.first_row_is_header = false;
-      bool parsed = parse_gallery_table(inner_text, table);
-
-      if (parsed && !has_inner_html_tags(table)) {
-        // trim the table
-        trim_html_whitespace(table);
+  std::cout << "Reading directory file '" << input_directory << "'.\n";
+  std::vector<std::string> files = get_files_in_directory(input_directory.c_str());
 
-        // convert to markdown
-        std::string markdown_table = to_markdown(table);
+  // Skip the temporary files left by an interrupted run
+  files.erase(std::remove_if(files.begin(), files.end(), is_temp_file), files.end());
 
-        // replace
-        content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_table);
-      } else {
-        // next tag
-        offset = info.close_end + 1;
-      }
-    }
+  if (files.empty()) {
+    std::cout << "Error. No files in directory '" << input_directory << "'.\n";
+    return 3;
   }
-}
-
-bool parse_html_table(std::string & content, HtmlTable & table) {
-  table.first_row_is_header = false;
-
-  HtmlTableRow tmp_row;
-
-  HTML_TAG_INFO tr_info;
-  size_t tr_offset = 0;
-  while (find_html_tag_boundaries(content, "tr", tr_offset, tr_info)) {
-    size_t tr_inner_length = tr_info.close_start - tr_info.inner_start;
-    std::string tr_inner_text = content.substr(tr_info.inner_start, tr_inner_length);
-
-    // Check if this row is a header
-    bool is_first_row = (table.rows.size() == 0);
-    std::string class_value = get_html_attribute_value(content, "class", tr_info);
-    if (class_value.find("header") != std::string::npos) {
-      table.first_row_is_header = true;
-    }
 
-    HTML_TAG_INFO td_info;
-    size_t td_offset = 0;
-    while (find_html_tag_boundaries(tr_inner_text, "td", td_offset, td_info)) {
-      size_t td_inner_length = td_info.close_start - td_info.inner_start;
-      std::string td_inner_text = tr_inner_text.substr(td_info.inner_start, td_inner_length);
-
-      std::string colspan_value = get_html_attribute_value(tr_inner_text, "colspan", td_info);
-
-      // Create a new cell in current row
-      tmp_row.push_back(td_inner_text);
-
-      // Check if the spell spans across multiple column
-      if (!colspan_value.empty() && is_numeric(colspan_value.c_str())) {
-        // markdown does not support colspan, repeat the cell multiple times.
-        int colspan = -1;
-        parse_value(colspan_value, colspan);
-        if (colspan > 1) {
-          for(int i=1; i<colspan; i++) {
-            tmp_row.push_back("");
-          }
-        }
-      }
-
-      // next tag dt
-      td_offset = td_info.close_end + 1;
-    }
+  std::cout << "Processing " << files.size() << " files in directory.\n";
 
-    // If we read all column inside the row, flush the temporary row
-    if (!tmp_row.empty()) {
-      // Flush the row accumulator to the table
-      table.rows.push_back(tmp_row);
-      tmp_row.clear();
+  // Start with the largest files so that a large file is not left alone at the end of the run
+  std::vector<size_t> file_sizes(files.size());
+  std::vector<size_t> tasks(files.size());
+  for(size_t i=0; i<files.size(); i++) {
+    file_sizes[i] = get_file_size(files[i]);
+    tasks[i] = i;
+  }
+  std::stable_sort(tasks.begin(), tasks.end(), [&file_sizes](size_t a, size_t b) { return file_sizes[a] > file_sizes[b]; });
+
+  // Load the conversions of the previous run
+  std::string manifest_path = get_manifest_path(input_directory);
+  Manifest previous_manifest;
+  if (use_manifest && load_manifest(manifest_path, previous_manifest) && previous_manifest.settings != get_filter_settings()) {
+    std::cout << "Filters have changed since the last run. All files will be converted.\n";
+    previous_manifest.entries.clear();
+  }
+
+  // Each file is logged in its own buffer. Buffers are displayed in the order of the files once all files are processed.
+  std::vector<int> return_codes(files.size(), 0);
+  std::vector<std::string> logs(files.size());
+  std::vector<FileConversion> conversions(files.size());
+  std::vector<Profile> profiles(files.size());
+  for(size_t i=0; i<profiles.size(); i++)
+    init_profile(profiles[i], !trace_path.empty());
+  run_tasks(tasks, num_jobs, [&](size_t file_index) {
+    const std::string & file_path = files[file_index];
+    const MANIFEST_ENTRY * previous_conversion = NULL;
+    std::map<std::string, MANIFEST_ENTRY>::const_iterator it = previous_manifest.entries.find(get_manifest_key(input_directory, file_path));
+    if (it != previous_manifest.entries.end())
+      previous_conversion = &it->second;
+
+    std::ostringstream log;
+    set_log_stream(&log);
+    if (use_profile || !trace_path.empty())
+      set_profile(&profiles[file_index]);
+    return_codes[file_index] = process_file(file_path, previous_conversion, conversions[file_index]);
+    set_profile(NULL);
+    set_log_stream(NULL);
+    logs[file_index] = log.str();
+  });
+
+  int return_code = 0;
+  size_t num_errors = 0;
+  size_t num_skipped = 0;
+  Manifest manifest;
+  manifest.settings = get_filter_settings();
+  std::vector<std::string> saved_files;
+  for(size_t i=0; i<files.size(); i++) {
+    std::cout << logs[i];
+    if (return_codes[i] != 0) {
+      num_errors++;
+      if (return_code == 0)
+        return_code = return_codes[i];
+      continue;
     }
 
-    // next tag dl
-    tr_offset = tr_info.close_end + 1;
-  }
+    const FileConversion & conversion = conversions[i];
+    if (conversion.skipped)
+      num_skipped++;
+    if (!conversion.saved_file.empty())
+      saved_files.push_back(conversion.saved_file);
 
-  // If there is still cells in the temporary row (accumulator), flush them in the table
-  if (!tmp_row.empty()) {
-    table.rows.push_back(tmp_row);
-    tmp_row.clear();
+    MANIFEST_ENTRY entry = { conversion.input_hash, conversion.output_hash };
+    manifest.entries[get_manifest_key(input_directory, files[i])] = entry;
   }
 
-  if (!table.rows.empty()) {
-    return true;
-  }
-  return false;
-}
+  std::cout << "Converted " << (files.size() - num_skipped - num_errors) << " files. Skipped " << num_skipped << " unchanged files.\n";
 
-/// <summary>
-/// This filter replaces all <table> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// Unless the table header is obviously identified with css of with tags, an empty header is inserted since markdown does not support tables without headers.
-/// </summary>
-void filter_table(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "table", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    // Skip html tables that have colspan or rowspan cells which is not supported in markdown
-    if (!has_cell_spanning(inner_text)) {
-
-      // Parse the table
-      HtmlTable table;
-      table.first_row_is_header = false;
-      bool parsed = parse_html_table(inner_text, table);
-
-      if (parsed && !has_inner_html_tags(table)) {
-        // trim the table
-        trim_html_whitespace(table);
-
-        // convert to markdown
-        std::string markdown_table = to_markdown(table);
-
-        // replace
-        content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_table);
-      } else {
-        // next tag
-        offset = info.close_end + 1;
-      }
+  // Save the manifest for the next run
+  if (use_manifest && !dry_run) {
+    std::string error;
+    if (replace_file(manifest_path, to_manifest_content(manifest), error)) {
+      saved_files.push_back(manifest_path);
     } else {
-      // next tag
-      offset = info.close_end + 1;
+      std::cout << "Error. " << error << "\n";
+      if (return_code == 0)
+        return_code = 4;
     }
   }
-}
 
-/// <summary>
-/// This filter replaces all <pre> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// Most <pre> tags are used for embedding code.
-/// </summary>
-/// <remarks>
-/// See also `filter_code()` for details.
-/// The `Crayon Syntax Highlighter` wordpress plugin also generates <div> and <pre> tags. For example:
-///    <div class="crayon-line">
-///      <pre class="lang:c++ decode:true" title="Arduino tone and delay functions overrides" data-url="http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino">http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino</pre>
-///    </div>
-/// </remarks>
-void filter_preformatted(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "pre", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // Search for the next tag
-      offset = info.close_end + 1;
-    } else {
+  // Flush all saved files to disk at once
+  int sync_return_code = save_files_to_disk(saved_files);
+  if (return_code == 0)
+    return_code = sync_return_code;
 
-      bool is_single_line = (inner_text.find('\n') == std::string::npos);
-
-      // Check if this <pre> tag has a class that would described the content's language.
-      // For example: `<pre class="lang:c++ decode:true" title="Arduino tone and delay functions overrides" data-url="http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino">`
-      std::string lang;
-      std::string class_value = get_html_attribute_value(content, "class", info);
-      if (!class_value.empty()) {
-        // get the 'lang' parameter
-        lang = find_class_property(class_value, "lang");
-        if (lang == "default")
-          lang = "";
-        else if (lang == "c++")
-          lang = "cpp";
-      }
-
-      // Detect if the code is inlined in the content or if the code is from a local static file
-      HTML_ATTRIBUTE_INFO data_url_info;
-      bool has_data_url_value = find_html_attribute_boundaries(content, "data-url", info.open_start, info.open_end, data_url_info);
-      if (has_data_url_value) {
-        is_single_line = false;
-
-        // Read the url of the file and trim the hostname from the url
-        std::string data_url_value = get_html_attribute_value(content, "data-url", info);
-        search_and_replace(data_url_value, WEBSITE_HOSTNAME, "");
-
-        // Hugo's storage file starts with /static/
-        data_url_value.insert(0, "/static");
-
-        // Use a hugo shortcode to highlight file identified by the data-url into this content
-        // The file hightlight-static-file.html should have the following content: `{{ highlight (readFile (.Get "file")) (.Get "lang") "" }}`
-        // and should be called with the following syntax: `{{< hightlight-static-file file="/static/wp-content/uploads/2015/01/guess.cpp" lang="cpp" >}}`
-        std::string markdown_code;
-        markdown_code.append("{{< hightlight-static-file file=\"");
-        markdown_code.append(data_url_value);
-        markdown_code.append("\" lang=\"");
-        markdown_code.append(lang);
-        markdown_code.append("\" >}}");
-
-        // replace
-        content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_code);
-      }
-      else {
-        trim_html_whitespace(inner_text);
-
-        // filter more html entities
-        filter_more_html_entities(inner_text);
-
-        std::string markdown_code;
-        if (is_single_line) {
-          markdown_code = std::string("`") + inner_text + "`";
-        } else {
-          markdown_code = std::string("\n```") + lang + "\n" + inner_text + "\n```\n";
-        }
-
-        // replace
-        content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, markdown_code);
-      }
-    }
-  }
-}
+  if (num_errors > 0)
+    std::cout << "Error. Failed to process " << num_errors << " of " << files.size() << " files.\n";
 
-/// <summary>
-/// This filter replaces all <small> tags with their markdown equivalent, but only if there is no html inside the tag.
-/// </summary>
-void filter_small(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "small", offset, info)) {
-    size_t tag_length = info.close_end - info.open_start + 1;
-    std::string tag_content = content.substr(info.open_start, tag_length);
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag. Do not use close_end to prevent skipping tags within other tags of the same type.
-      // For example, <small><small>foo bar</small></small>
-      offset = info.open_end + 1;
-    } else {
-      // replace
-      content.replace(content.begin() + info.open_start, content.begin() + info.close_end + 1, inner_text);
-    }
-  }
-}
+  int dry_run_return_code = report_dry_run(conversions);
+  if (return_code == 0)
+    return_code = dry_run_return_code;
 
-void filter_known_html_entities(std::string & content) {
-  // look for &nbsp; encoded as a utf8 code point
-  search_and_replace(content, "\xc2\xa0", "&nbsp;");
-
-  search_and_replace(content, "&quot;", "\"");
-  search_and_replace(content, "&ldquo;", "\"");
-  search_and_replace(content, "&rdquo;", "\"");
-  search_and_replace(content, "&ndash;", "-");
-
-  search_and_replace(content, "&#215;", "x");
-  search_and_replace(content, "&#8211;", "-");
-  search_and_replace(content, "&#8216;", "'");
-  search_and_replace(content, "&#8217;", "'");
-  search_and_replace(content, "&#8230;", "...");
-  search_and_replace(content, "&#8220;", "&quot;");
-  search_and_replace(content, "&#8221;", "&quot;");
-  search_and_replace(content, "&#8242;", "'");
-}
+  // Aggregate the profiles in the order of the files
+  Profile profile;
+  init_profile(profile, !trace_path.empty());
+  for(size_t i=0; i<profiles.size(); i++)
+    merge_profile(profile, profiles[i]);
+  int profile_return_code = report_profile(profile, files.size());
+  if (return_code == 0)
+    return_code = profile_return_code;
 
-void filter_more_html_entities(std::string & content) {
-  search_and_replace(content, "&lt;", "<");
-  search_and_replace(content, "&gt;", ">");
-  search_and_replace(content, "&equals;", "=");
+  return return_code;
 }
 
 /// <summary>
-/// This filter replaces all non-breaking space ( "&nbsp;" ) entities by a normal space, where a non-breaking space is not mandatory.
-/// For examples, if the non-breaking space is between two words, a normal space is enough.
-/// At multiple locations, wordpress seems to had prefered to insert "&nbsp;" instead of normal spaces.
+/// Returns the version of the filters and the options that modify the converted files.
 /// </summary>
-void filter_useless_nbsp_entities(std::string & content) {
-  static const std::string pattern = "&nbsp;";
-  size_t pos = content.find(pattern);
-  while(pos != std::string::npos) {
-
-    // Check characters before and after.
-    char c_before = '\0';
-    char c_after = '\0';
-    if (pos > 0)
-      c_before = content[pos - 1];
-    if (pos+1 < content.size())
-      c_after = content[pos + 1];
-
-    // If they are alphanumeric, the non-breaking space can be safely replaced by a normal space
-    if (is_text(c_before) && is_text(c_after)) {
-      // Replace the non-breaking space
-      content.replace(content.begin() + pos, content.begin() + pos + pattern.size(), " ");
-
-      // next nbsp entity
-      pos = content.find(pattern, pos);
-      continue;
-    }
-  
-    // next nbsp entity
-    pos = content.find(pattern, pos + 1);
-  }
+std::string get_filter_settings() {
+  std::string settings;
+  settings += "filters=" + to_string(FILTER_SET_VERSION);
+  settings += " engine=" + std::string(conversion_engine == CONVERSION_ENGINE_TREE ? "tree" : "passes");
+  settings += " max-passes=" + to_string(max_passes);
+  settings += " profile-set=" + std::string(profile_set->name);
+  std::string site_settings = get_site_profile_settings(get_site_profile());
+  settings += " site=" + to_string(hash_content(site_settings.c_str(), site_settings.size()));
+  return settings;
 }
 
 /// <summary>
-/// This filter trims the content of all <td> tags, but only if there is no html inside the tag.
-/// In other words, it removes all white space characters from the beginning and the end of the inner html.
+/// Flushes the files saved by process_file() to disk.
 /// </summary>
-void filter_table_cells_inner_white_space(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "td", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    if (!has_inner_html_tags(inner_text)) {
-      // trim the cell on a single line
-      trim_html_whitespace(inner_text);
-
-      // replace the tag's inner text
-      content.replace(content.begin() + info.inner_start, content.begin() + info.inner_end + 1, inner_text);
-
-      // next tag. Can't use close_end index as usual since replacing the inner text has modified close_end.
-      offset = info.open_end + 1;
-    } else {
-      // next tag
-      offset = info.close_end + 1;
-    }
-  }
-}
-
-/// <summary>
-/// This filter trims the content between <td> tags.
-/// In other words, it removes empty lines between a </td> and the next <td>.
-/// </summary>
-void filter_table_cells_outer_white_space(std::string & content) {
-  // For each possible indentations
-  for(size_t indent = 0; indent <= 10; indent += 2) {
-    
-    // Build the old pattern
-    std::string pattern_old;
-    pattern_old.append("</td>\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("<td");
-
-    // Build the new pattern
-    std::string pattern_new;
-    pattern_new.append("</td>\n");
-    pattern_new.append(indent, ' ');
-    pattern_new.append("<td");
-
-    // Search & replace
-    search_and_replace(content, pattern_old, pattern_new);
-
-    // Rebuild the old pattern assuming empty lines that separate each <td> element
-    pattern_old.clear();
-    pattern_old.append("</td>\n");
-    pattern_old.append("\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("<td");
-
-    // Search & replace
-    search_and_replace(content, pattern_old, pattern_new);
-  }
-}
-
-/// <summary>
-/// This filter trims the content between <tr> tags.
-/// In other words, it removes empty lines between a </tr> and the next <tr>.
-/// </summary>
-void filter_table_rows_outer_white_space(std::string & content) {
-  // For each possible indentations
-  for(size_t indent = 0; indent <= 10; indent += 2) {
-    
-    // Build the old pattern
-    std::string pattern_old;
-    pattern_old.append("</tr>\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("<tr");
-
-    // Build the new pattern
-    std::string pattern_new;
-    pattern_new.append("</tr>\n");
-    pattern_new.append(indent, ' ');
-    pattern_new.append("<tr");
-
-    // Search & replace
-    search_and_replace(content, pattern_old, pattern_new);
-
-    // Rebuild the old pattern assuming empty lines that separate each <tr> element
-    pattern_old.clear();
-    pattern_old.append("</tr>\n");
-    pattern_old.append("\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("<tr");
-
-    // Search & replace
-    search_and_replace(content, pattern_old, pattern_new);
-
-
-
-
-    // Rebuild the old pattern assuming empty lines that separate each the last </td> tag or the row
-    pattern_old.clear();
-    pattern_old.append("</td>\n");
-    pattern_old.append("\n");
-    pattern_old.append(indent, ' ');
-    pattern_old.append("</tr>");
-
-    // Rebuild the new pattern as well
-    pattern_new.clear();
-    pattern_new.append("</td>\n");
-    pattern_new.append(indent, ' ');
-    pattern_new.append("</tr>");
-
-    // Search & replace
-    search_and_replace(content, pattern_old, pattern_new);
-
+int save_files_to_disk(const std::vector<std::string> & saved_files) {
+  std::vector<std::string> paths;
+  for(size_t i=0; i<saved_files.size(); i++) {
+    if (!saved_files[i].empty())
+      paths.push_back(saved_files[i]);
+  }
+  if (paths.empty())
+    return 0;
+
+  std::string error;
+  if (!sync_files(paths, error)) {
+    std::cout << "Error. " << error << "\n";
+    return 4;
   }
+  return 0;
 }
 
 /// <summary>
-/// This filter looks for Reference-style links and converts them to inline links.
-/// See https://www.markdownguide.org/basic-syntax/#reference-style-links and https://commonmark.org/help/tutorial/07-links.html for details.
+/// Displays the profile table if --profile is specified and saves the trace file if --trace is specified.
 /// </summary>
-void force_inline_hyperlinks(std::string & content) {
-  for(size_t link_reference_id = 1; link_reference_id < std::string::npos; link_reference_id++) {
-    
-    // Search for the link position in text
-    std::string text_pattern = std::string("][") + to_string(link_reference_id) + "]";
-    std::string reference_pattern = std::string("\n [") + to_string(link_reference_id) + "]: ";
-    
-    size_t reference_pos = content.find(reference_pattern);
-    if (reference_pos == std::string::npos)
-      break; // All references processed.
-
-    // Extract url from reference
-    std::string url;
-    if (reference_pos != std::string::npos) {
-      url = read_until(content, reference_pos + reference_pattern.size(), link_reference_endding_characters, num_link_reference_endding_characters);
-      if (url.empty())
-        break; // Failed to find url
-    }
-
-    // Remove the bottom reference definition
-    content.replace(content.begin() + reference_pos, content.begin() + reference_pos + reference_pattern.size() + url.size(), "");
-
-    // Replace all text links of this refererence in content
-    size_t text_pos = content.find(text_pattern);
-    while(text_pos != std::string::npos) {
-      // replace text link
-      std::string inline_link_content = std::string("](") + url + ")";
-      content.replace(content.begin() + text_pos, content.begin() + text_pos + text_pattern.size(), inline_link_content);
-
-      // next link reference
-      text_pos = content.find(text_pattern, text_pos);
+int report_profile(const Profile & profile, size_t num_files) {
+  if (use_profile)
+    std::cout << to_profile_table(profile, num_files);
+
+  if (!trace_path.empty()) {
+    std::string error;
+    if (!replace_file(trace_path, to_trace_json(profile), error)) {
+      std::cout << "Error. " << error << "\n";
+      return 4;
     }
+    std::cout << "Saved trace file '" << trace_path << "'.\n";
   }
+  return 0;
 }
 
 /// <summary>
-/// This filter adds newline after some tags if text follows immediately after the tag close.
+/// Writes the changes of a dry run to the --diff file, or to the standard output.
+/// Does nothing if --dry-run is not specified.
 /// </summary>
-/// <remarks>
-/// For example:
-///   <div id="attachment_1197" style="width: 404px" class="wp-caption alignnone">
-///     <a href="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png"><img aria-describedby="caption-attachment-1197" loading="lazy" class="size-full wp-image-1197" src="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png" alt="VirtualDub Frameserver Mode" width="394" height="205" srcset="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png 394w, http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode-150x78.png 150w, http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode-300x156.png 300w" sizes="(max-width: 394px) 100vw, 394px" /></a>
-///     <p id="caption-attachment-1197" class="wp-caption-text">
-///       VirtualDub Frameserver Mode
-///     </p>
-///   </div> The frameserver is now ready to provide frames to other applications.
-/// </remarks>
-void filter_missing_newline(std::string & content, const std::string & tag_close_definition) {
-  size_t tag_close_pos = content.find(tag_close_definition);
-  while(tag_close_pos != std::string::npos) {
-    // Check the character following
-    char next = '\0';
-    size_t next_offset = tag_close_pos + tag_close_definition.size();
-    if (next_offset < content.size()) {
-      next = content[next_offset];
-    }
-
-    if (next == '\0')
-      return; // we reached the end of the document.
-
-    // Should a newline must be inserted ?
-    if (next != '\n') {
-
-      // If the next character is a space, replace it.
-      if (next == ' ')
-        content[next_offset] = '\n';
-      else {
-        // Otherwise, insert a newline
-        content.insert(next_offset, 1, '\n');
-      }
-    }
-
-    // next tag
-    tag_close_pos = content.find(tag_close_definition, tag_close_pos + 1);
+int report_dry_run(const std::vector<FileConversion> & conversions) {
+  if (!dry_run)
+    return 0;
+
+  std::string report;
+  size_t num_modified = 0;
+  size_t lines_added = 0;
+  size_t lines_removed = 0;
+  for(size_t i=0; i<conversions.size(); i++) {
+    const FileConversion & conversion = conversions[i];
+    if (conversion.diff.empty())
+      continue;
+    report += conversion.diff;
+    num_modified++;
+    lines_added += conversion.diff_stats.lines_added;
+    lines_removed += conversion.diff_stats.lines_removed;
   }
-}
 
-/// <summary>
-/// This filter replaces all "featured_image:" elements in front matter by the new way of defining images.
-/// </summary>
-/// <remarks>
-/// For examples:
-///   featured_image: /wp-content/uploads/2000/01/foobar.png
-/// Into:
-///   images:
-///     - src: /wp-content/uploads/2000/01/foobar.png
-/// </remarks>
-void filter_featured_image(std::string & content) {
-  static const std::string pattern = "featured_image: ";
-  static const std::string empty_string;
-
-  size_t pos = content.find(pattern);
-  while(pos != std::string::npos) {
-    // read until the end of the line
-    std::string line = get_line_at_offset(content, pos);
-
-    // Get the url of the featured image
-    std::string featured_image_url = line;
-    search_and_replace(featured_image_url, pattern, empty_string);
-
-    std::string yaml = "images:\n  - src: " + featured_image_url;
-
-    //replace in document
-    search_and_replace(content, line, yaml);
-
-    // next
-    pos = content.find(pattern, pos);
+  std::cout << "Dry run. " << num_modified << " files would be modified: " << lines_added << " lines added, " << lines_removed << " lines removed.\n";
+  if (diff_path.empty()) {
+    std::cout << report;
+    return 0;
   }
-}
 
-/// <summary>
-/// After some closing tags, a newline should be inserted if missing.
-/// </summary>
-void filter_missing_newline(std::string & content) {
-  filter_missing_newline(content, "</div>");
-  filter_missing_newline(content, "</table>");
-  filter_missing_newline(content, "</p>");
-}
-
-/// <summary>
-/// This filter adds newline after the end of an header.
-/// </summary>
-/// <remarks>
-/// Headers with a missing newline are identified as the following:
-/// ## <span id="Design">Design</span> The following section illustrate the design
-/// </remarks>
-void filter_missing_newline_after_header(std::string & content) {
-  HTML_TAG_INFO info;
-  size_t offset = 0;
-  while(find_html_tag_boundaries(content, "span", offset, info)) {
-    size_t inner_length = info.close_start - info.inner_start;
-    std::string inner_text = content.substr(info.inner_start, inner_length);
-
-    bool has_inner_html = has_inner_html_tags(inner_text);
-    if (has_inner_html) {
-      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
-      // next tag
-      offset = info.close_end + 1;
-    } else {
-
-      // Is this span a markdown header ?
-      std::string line = get_line_at_offset(content, info.open_start);
-      trim_html_whitespace(line);
-      if (!line.empty() && line[0] == '#') {
-
-        // Check the next character following </span>
-        char next = '\0';
-        size_t next_offset = info.close_end + 1;
-        if (next_offset < content.size()) {
-          next = content[next_offset];
-        }
-
-        if (next == '\0')
-          return; // we reached the end of the document.
-
-        // Should a newline must be inserted ?
-        if (next != '\n') {
-
-          // If the next character is a space, replace it.
-          if (next == ' ')
-            content[next_offset] = '\n';
-          else {
-            // Otherwise, insert a newline
-            content.insert(next_offset, 1, '\n');
-          }
-        }
-      }
-
-      // next tag
-      offset = info.close_end + 1;
-    }
+  std::string error;
+  if (!replace_file(diff_path, report, error)) {
+    std::cout << "Error. " << error << "\n";
+    return 4;
   }
-}
-
-void filter_comment_separators(std::string & content) {
-  static const std::string pattern = "<!--=================================================-->";
-  static const std::string empty_string;
-
-  search_and_replace(content, std::string() + "\n" + pattern + "\n", empty_string);
-  search_and_replace(content, std::string() + pattern + " ", empty_string);
-  search_and_replace(content, std::string() + pattern, empty_string);
-}
-
-/// <summary>
-/// This filter removes "type: post" inside the front matter.
-/// Hugo does not seems to like this. Posts with "type: post" don't show up in "recent posts" sections.
-/// </summary>
-void filter_type_post(std::string & content) {
-  static const std::string pattern = "type: post\n";
-  static const std::string empty_string;
-
-  search_and_replace(content, pattern, empty_string);
-}
-
-/// <summary>
-/// This filter removes messed up "more" identifiers.
-/// For an unknown reasons, some of my posts have a french-english "more" indentifier.
-/// </summary>
-void filter_more_comment(std::string & content) {
-  static const std::string pattern = "<!--more Lire la suite →-->";
-  static const std::string value = "<!--more-->";
-
-  search_and_replace(content, pattern, value);
+  std::cout << "Saved diff file '" << diff_path << "'.\n";
+  return 0;
 }
 
 /// <summary>
-/// Execute all filters one by one.
+/// Converts a file. The output file is saved only if its content has changed.
+/// If the file is the output of the previous conversion, the file is skipped without being converted.
+/// The path of the saved file is returned in the conversion. The saved file is not flushed to disk, see save_files_to_disk().
+/// With --dry-run, the file is not saved and the changes are returned in the conversion instead.
 /// </summary>
-void run_all_filters(std::string & content) {
-  EOL_TYPE eol_type = normalize_newlines(content);
-  filter_preformatted_code_simplify(content);
-  filter_known_html_entities(content);
-  filter_useless_nbsp_entities(content);
-  filter_comment_separators(content);
-  filter_missing_newline_after_header(content);
-  filter_missing_newline(content);
-  filter_type_post(content);
-  filter_more_comment(content);
-  filter_featured_image(content);
-
-  // run multiple passes for tag that can embed other tags
-  static const size_t num_passes = 15;
-  for(size_t i=0; i<num_passes; i++) {
-    filter_span(content);
-    filter_paragraph_with_custom_css(content);
-    filter_paragraph(content);
-    filter_images(content);
-    filter_strong(content);
-    filter_italic(content);
-    filter_anchors(content);
-    filter_emphasized(content);
-    filter_code(content);
-    filter_unordered_lists(content);
-    filter_list_item_simplify(content);
-    filter_list_item(content);
-    filter_division_gallery(content);
-    filter_table(content);
-    filter_division(content);
-    filter_preformatted(content);
-    filter_small(content);
-  }
-
-  filter_table_cells_inner_white_space(content);
-  filter_table_cells_outer_white_space(content);
-  filter_table_rows_outer_white_space(content);
-
-  force_inline_hyperlinks(content);
+int process_file(const std::string & input_file, const MANIFEST_ENTRY * previous_conversion, FileConversion & conversion) {
+  ProfileScope file_scope(input_file, "file");
+  FileArenaScope arena_scope;
+  std::ostream & log = get_log_stream();
+  conversion.saved_file.clear();
+  conversion.input_hash = 0;
+  conversion.output_hash = 0;
+  conversion.skipped = false;
+  conversion.eol_type = EOL_TYPE_UNIX;
+  conversion.diff.clear();
+  conversion.diff_stats.lines_added = 0;
+  conversion.diff_stats.lines_removed = 0;
 
-  restore_newlines(content, eol_type);
-}
-
-void show_usage() {
-  std::cout << "filterhtml\n";
-  std::cout << "Usage:\n";
-  std::cout << "  Replace html formatting in a markdown file by native markdown syntax.\n";
-  std::cout << "Features:\n";
-  std::cout << "  The following html tags are supported: span, p, img, a, strong, i, em, code, ul, li, pre, div, table.\n";
-  std::cout << "  The function 'filter_paragraph_with_custom_css()' supports paragraph with custom css classes.\n";
-  std::cout << "  These paragraphs are converted and a shortcode matching the custom css class is added before and after the paragraph's content.\n";
-  std::cout << "  Wordpress galleries are properly identified and converted to a markdown table.\n";
-  std::cout << "  Html tables which are missing an header row (or if the header row cannot be identified) have an additional empty row added at the beginning as the header.\n";
-  std::cout << "  Most known html entities are replaced by their corresponding utf-8 character.\n";
-  std::cout << "  Whitespace is removed as much as possible.\n";
-  std::cout << "  Reference-style links are replaced by inline links.\n";
-  std::cout << "  Featured_image element in front matter is replaced by image.src format.\n";
-  std::cout << "Arguments:\n";
-  std::cout << "  --if=<path>\t\tPath to markdown file.\n";
-  std::cout << "  --id=<path>\t\tPath to directory with markdown files.\n";
-  std::cout << "\n";
-}
-
-int process_directory(const std::string & input_directory) {
-  if (!dir_exists(input_directory.c_str())) {
-    std::cout << "Directory not found: '" << input_directory << "'.\n";
+  if (!file_exists(input_file.c_str())) {
+    log << "File not found: '" << input_file << "'.\n";
     return 2;
   }
 
-  std::cout << "Reading directory file '" << input_directory << "'.\n";
-  std::vector<std::string> files = get_files_in_directory(input_directory.c_str());
-  if (files.empty()) {
-    std::cout << "Error. No files in directory '" << input_directory << "'.\n";
+  log << "Loading file '" << input_file << "'.\n";
+  MappedFile file;
+  std::string error;
+  if (!map_file(input_file, file, error)) {
+    log << "Error. " << error << "\n";
     return 3;
   }
+  conversion.input_hash = hash_content(file.data, file.size);
 
-  std::cout << "Processing " << files.size() << " files in directory.\n";
-  for(size_t i=0; i<files.size(); i++) {
-    const std::string & file_path = files[i];
-    int return_code = process_file(file_path);
-    if (return_code != 0) {
-      return return_code;
-    }
+  // Skip the files that were converted in place by the previous run and not modified since
+  if (previous_conversion != NULL && process_file_in_place && conversion.input_hash == previous_conversion->output_hash) {
+    unmap_file(file);
+    conversion.input_hash = previous_conversion->input_hash;
+    conversion.output_hash = previous_conversion->output_hash;
+    conversion.skipped = true;
+    log << "File is already converted.\n";
+    return 0;
   }
 
-  return 0;
-}
+  // The filters process the document with unix newlines
+  std::string content;
+  conversion.eol_type = normalize_newlines(file.data, file.size, content);
+  if (!dry_run)
+    unmap_file(file);
 
-int process_file(const std::string & input_file) {
-  if (!file_exists(input_file.c_str())) {
-    std::cout << "File not found: '" << input_file << "'.\n";
-    return 2;
-  }
+  run_all_filters(content);
+  restore_newlines(content, conversion.eol_type);
+  conversion.output_hash = hash_content(content.c_str(), content.size());
 
-  std::cout << "Loading file '" << input_file << "'.\n";
-  std::string content = load_file(input_file.c_str());
-  if (content.empty()) {
-    std::cout << "Error. Unable to load file '" << input_file << "'.\n";
-    return 3;
+  // Compare with the original content instead of saving the file
+  if (dry_run) {
+    conversion.diff = to_file_diff(std::string_view(file.data, file.size), content, input_file, diff_format, conversion.diff_stats);
+    unmap_file(file);
+    if (conversion.diff.empty())
+      log << "File is unchanged.\n";
+    else
+      log << "File would be modified: " << conversion.diff_stats.lines_added << " lines added, " << conversion.diff_stats.lines_removed << " lines removed.\n";
+    return 0;
   }
 
-  run_all_filters(content);
-
   // use in-place replacement
   std::string output_path;
   if (process_file_in_place)
@@ -1403,17 +674,24 @@ int process_file(const std::string & input_file) {
   else
     output_path = input_file+".backup.md";
 
+  // Leave the file untouched if nothing has changed
+  if (is_file_content_equal(output_path, content)) {
+    log << "File is unchanged.\n";
+    return 0;
+  }
+
   // show output message
   if (process_file_in_place)
-    std::cout << "Saving file.\n";
+    log << "Saving file.\n";
   else
-    std::cout << "Saving file as '" << output_path << "'.\n";
+    log << "Saving file as '" << output_path << "'.\n";
 
-  bool saved = save_file(output_path, content);
+  bool saved = replace_file(output_path, content, error);
   if (!saved) {
-    std::cout << "Error. Unable to save file '" << output_path << "'.\n";
+    log << "Error. " << error << "\n";
     return 4;
   }
+  conversion.saved_file = output_path;
 
   return 0;
 }
@@ -1440,8 +718,148 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // Search --engine=<name> argument
+  args.engine = find_argument("engine", argc, argv);
+  if (args.engine.empty() || args.engine == "passes") {
+    conversion_engine = CONVERSION_ENGINE_PASSES;
+  } else if (args.engine == "tree") {
+    conversion_engine = CONVERSION_ENGINE_TREE;
+  } else {
+    std::cout << "Error. Unknown conversion engine '" << args.engine << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+
+  // Search --profile-set=<name> argument
+  args.profile_set = find_argument("profile-set", argc, argv);
+  if (!args.profile_set.empty()) {
+    profile_set = NULL;
+    for(size_t i=0; i<num_profile_sets && profile_set == NULL; i++) {
+      if (args.profile_set == profile_sets[i].name)
+        profile_set = &profile_sets[i];
+    }
+    if (profile_set == NULL) {
+      std::cout << "Error. Unknown profile set '" << args.profile_set << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+  }
+
+  // Search --site=<path> argument
+  args.site = find_argument("site", argc, argv);
+  if (!args.site.empty()) {
+    SiteProfile site_profile;
+    std::string error;
+    if (!load_site_profile(args.site, site_profile, error)) {
+      std::cout << "Error. " << error << "\n";
+      return 1;
+    }
+    set_site_profile(site_profile);
+  }
+
+  // Search --max-passes=<n> argument
+  args.max_passes = find_argument("max-passes", argc, argv);
+  if (!args.max_passes.empty()) {
+    int value = 0;
+    if (is_numeric(args.max_passes.c_str()))
+      parse_value(args.max_passes, value);
+    if (value <= 0) {
+      std::cout << "Error. Invalid number of passes '" << args.max_passes << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    max_passes = (size_t)value;
+  }
+
+  // Search --jobs=<n> argument
+  args.jobs = find_argument("jobs", argc, argv);
+  if (!args.jobs.empty()) {
+    int value = -1;
+    if (is_numeric(args.jobs.c_str()))
+      parse_value(args.jobs, value);
+    if (value < 0) {
+      std::cout << "Error. Invalid number of jobs '" << args.jobs << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    num_jobs = (value == 0 ? get_processor_count() : (size_t)value);
+  }
+
+  // Search --manifest=<on|off> argument
+  args.manifest = find_argument("manifest", argc, argv);
+  if (args.manifest.empty() || args.manifest == "on") {
+    use_manifest = true;
+  } else if (args.manifest == "off") {
+    use_manifest = false;
+  } else {
+    std::cout << "Error. Invalid manifest option '" << args.manifest << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+
+  // Search --profile argument
+  // Search --trace=<file> argument
+  use_profile = has_argument("profile", argc, argv);
+  args.trace = find_argument("trace", argc, argv);
+  trace_path = args.trace;
+
+  // Search --scan=<level> argument
+  args.scan = find_argument("scan", argc, argv);
+  if (!args.scan.empty()) {
+    SCAN_LEVEL level = SCAN_LEVEL_SCALAR;
+    if (!parse_scan_level(args.scan.c_str(), level)) {
+      std::cout << "Error. Unknown scan level '" << args.scan << "'.\n";
+      std::cout << "\n";
+      show_usage();
+      return 1;
+    }
+    if (!set_scan_level(level)) {
+      std::cout << "Error. Scan level '" << args.scan << "' is not supported by this processor.\n";
+      return 1;
+    }
+  }
+
+  // Search --dry-run argument
+  // Search --diff=<path> argument
+  // Search --diff-format=<name> argument
+  dry_run = has_argument("dry-run", argc, argv);
+  args.diff = find_argument("diff", argc, argv);
+  args.diff_format = find_argument("diff-format", argc, argv);
+  if (!dry_run && (!args.diff.empty() || !args.diff_format.empty())) {
+    std::cout << "Error. Please specify --dry-run with --diff or --diff-format arguments.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  if (!args.diff_format.empty() && !parse_diff_format(args.diff_format, diff_format)) {
+    std::cout << "Error. Unknown diff format '" << args.diff_format << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  diff_path = args.diff;
+
+  init_html_entity_mappings();
+
   if (!args.input_file.empty()) {
-    int return_code = process_file(args.input_file);
+    FileConversion conversion;
+    Profile profile;
+    init_profile(profile, !trace_path.empty());
+    if (use_profile || !trace_path.empty())
+      set_profile(&profile);
+    int return_code = process_file(args.input_file, NULL, conversion);
+    set_profile(NULL);
+    if (return_code == 0)
+      return_code = save_files_to_disk(std::vector<std::string>(1, conversion.saved_file));
+    if (return_code == 0)
+      return_code = report_dry_run(std::vector<FileConversion>(1, conversion));
+    if (return_code == 0)
+      return_code = report_profile(profile, 1);
     if (return_code != 0) {
       return return_code;
     }
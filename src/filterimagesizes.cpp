@@ -7,22 +7,39 @@
 #include <fstream>      // std::ifstream
 #include <vector>
 #include <sstream>
-#include <algorithm>    // std::min, std::sort
+#include <algorithm>    // std::min, std::sort, std::remove_if
+#include <map>
+#include <set>
 
 #include "utils.h"
+#include "diff.h"
 
 static std::string WEBSITE_HOSTNAME = "http://www.end2endzone.com";
+static bool dry_run = false;
+static DIFF_FORMAT diff_format = DIFF_FORMAT_UNIFIED;
 
 bool my_string_sorting_function (std::string i, std::string j) { return (i<j); }
 
 struct Arguments {
   std::string wp_content_dir;
   std::string content_dir;
+  std::string diff;
+  std::string diff_format;
 };
 
 struct Context {
   std::vector<std::string> image_files;
   std::vector<std::string> posts_files;
+
+  // Changes of a dry run. The files are not modified: the next searches read the modified posts from memory and ignore the deleted files.
+  std::map<std::string, std::string> modified_posts;
+  std::set<std::string> deleted_files;
+};
+
+// The content of a post, mapped from the file or, during a dry run, modified in memory.
+struct PostContent {
+  MappedFile file;
+  std::string_view content;
 };
 
 struct ImageCount {
@@ -30,26 +47,79 @@ struct ImageCount {
   std::vector<size_t> sizes;
 };
 
-void filter_img_srcset(std::string & content) {
+struct SRCSET_RANGE {
+  size_t start;
+  size_t end;
+};
+
+/// <summary>
+/// Search the values of the srcset attributes of <img> tags in a post.
+/// The image sizes listed in srcset attributes are not counted as an image usage.
+/// </summary>
+void find_img_srcset_ranges(const char * content, size_t length, std::vector<SRCSET_RANGE> & ranges) {
   static const std::string search_pattern1 = "SRCSET=\"";
-  
-  size_t pos_start = content.find(search_pattern1);
+
+  ranges.clear();
+  size_t pos_start = find_in_buffer_no_case(content, length, search_pattern1, 0);
   while(pos_start != std::string::npos) {
-    size_t next_pos = pos_start; // define the position where the next search offset
+    size_t next_pos = pos_start + search_pattern1.size(); // define the position where the next search offset
 
     // Search the end of the srcset string
-    size_t pos_end = content.find("\"", pos_start+search_pattern1.size());
+    size_t pos_end = find_in_buffer(content, length, '\"', pos_start+search_pattern1.size());
     if (pos_end != std::string::npos) {
-      content.erase(content.begin()+pos_start, content.begin()+pos_end);
-      // next search starts at same position
-    }
-    else {
-      next_pos = pos_start + search_pattern1.size();
+      SRCSET_RANGE range = { pos_start, pos_end };
+      ranges.push_back(range);
+      next_pos = pos_end;
     }
 
     // Search again
-    pos_start = content.find(search_pattern1, next_pos);
+    pos_start = find_in_buffer_no_case(content, length, search_pattern1, next_pos);
+  }
+}
+
+/// <summary>
+/// Returns true if the post is referencing the given file name outside of srcset attributes. The search is not case sensitive.
+/// </summary>
+bool is_file_name_used(const char * content, size_t length, const std::vector<SRCSET_RANGE> & srcset_ranges, const std::string & file_name) {
+  size_t pos = find_in_buffer_no_case(content, length, file_name, 0);
+  size_t range_index = 0;
+  while(pos != std::string::npos) {
+    // Skip the srcset values that ends before the file name
+    while (range_index < srcset_ranges.size() && srcset_ranges[range_index].end <= pos)
+      range_index++;
+
+    bool in_srcset = (range_index < srcset_ranges.size() && srcset_ranges[range_index].start < pos + file_name.size());
+    if (!in_srcset)
+      return true;
+
+    // Search again after the srcset value
+    pos = find_in_buffer_no_case(content, length, file_name, srcset_ranges[range_index].end);
+  }
+  return false;
+}
+
+/// <summary>
+/// Opens the content of a post. The post must be closed with close_post().
+/// </summary>
+bool open_post(const Context & c, const std::string & post_path, PostContent & post, std::string & error) {
+  post.file.data = NULL;
+  post.file.size = 0;
+
+  std::map<std::string, std::string>::const_iterator it = c.modified_posts.find(post_path);
+  if (it != c.modified_posts.end()) {
+    post.content = it->second;
+    return true;
   }
+
+  if (!map_file(post_path, post.file, error))
+    return false;
+  post.content = std::string_view(post.file.data, post.file.size);
+  return true;
+}
+
+void close_post(PostContent & post) {
+  unmap_file(post.file);
+  post.content = std::string_view();
 }
 
 ImageCount get_image_usage_count(const std::string & master_path, const std::vector<std::string> & image_sizes, const Context & c) {
@@ -62,73 +132,109 @@ ImageCount get_image_usage_count(const std::string & master_path, const std::vec
     usage.sizes.push_back(0);
   }
 
+  std::string master_file_name_ext = get_file_name_with_extension(master_path.c_str());
+  std::vector<std::string> image_size_file_name_exts;
+  for(size_t j=0; j<image_sizes.size(); j++) {
+    image_size_file_name_exts.push_back(get_file_name_with_extension(image_sizes[j].c_str()));
+  }
+
   // Search all posts for all image files
+  std::vector<SRCSET_RANGE> srcset_ranges;
   for(size_t i=0; i<c.posts_files.size(); i++) {
     const std::string & post_path = c.posts_files[i];
 
-    std::string post_content = load_file(post_path);
-    uppercase(post_content);
+    // The post is scanned directly from the file mapping
+    PostContent post;
+    std::string error;
+    if (!open_post(c, post_path, post, error)) {
+      std::cout << "Error. " << error << "\n";
+      continue;
+    }
+    const char * data = post.content.data();
+    size_t size = post.content.size();
 
-    // Remove multiple sources from <img> tags
-    filter_img_srcset(post_content);
+    // Ignore multiple sources from <img> tags
+    find_img_srcset_ranges(data, size, srcset_ranges);
 
     // Search for master image
-    std::string master_file_name_ext = get_file_name_with_extension(master_path.c_str());
-    uppercase(master_file_name_ext);
-    if (post_content.find(master_file_name_ext) != std::string::npos)
+    if (is_file_name_used(data, size, srcset_ranges, master_file_name_ext))
       usage.master++;
 
     // Check all image sizes
     for(size_t j=0; j<image_sizes.size(); j++) {
-      const std::string & image_size_path = image_sizes[j];
-      std::string image_size_file_name_ext = get_file_name_with_extension(image_size_path.c_str());
-      uppercase(image_size_file_name_ext);
-      if (post_content.find(image_size_file_name_ext) != std::string::npos)
+      if (is_file_name_used(data, size, srcset_ranges, image_size_file_name_exts[j]))
         usage.sizes[j]++;
     }
+
+    close_post(post);
   }
 
   return usage;
 }
 
-int sanitize_posts(const std::string & master_path, const std::vector<std::string> & image_sizes, const Context & c) {
+int sanitize_posts(const std::string & master_path, const std::vector<std::string> & image_sizes, Context & c) {
+  std::vector<std::string> saved_files;
+
+  // Search for master image
+  std::string_view master_file_name_ext = get_file_name_with_extension_view(master_path);
+
   // Search all posts for all image files
   for(size_t i=0; i<c.posts_files.size(); i++) {
     const std::string & post_path = c.posts_files[i];
 
-    std::string post_content = load_file(post_path);
-    std::string post_content_backup = post_content;
-
-    // Search for master image
-    std::string master_file_name_ext = get_file_name_with_extension(master_path.c_str());
+    PostContent post;
+    std::string error;
+    if (!open_post(c, post_path, post, error)) {
+      std::cout << "Error. " << error << "\n";
+      return 3;
+    }
 
-    // Replaces all sub images by the original filename
+    // Replaces all sub images by the original filename.
+    // The post is copied only if it references a sub image.
+    std::string post_content;
     bool corrected = false; // bit to know if the content of the post was modified
     for(size_t j=0; j<image_sizes.size(); j++) {
-      const std::string & image_size_path = image_sizes[j];
-      std::string image_size_file_name_ext = get_file_name_with_extension(image_size_path.c_str());
+      std::string_view image_size_file_name_ext = get_file_name_with_extension_view(image_sizes[j]);
 
-      search_and_replace(post_content, image_size_file_name_ext, master_file_name_ext);;
-      corrected = true;
+      if (!corrected) {
+        if (find_in_buffer(post.content.data(), post.content.size(), image_size_file_name_ext, 0) == std::string::npos)
+          continue;
+        post_content.assign(post.content);
+        corrected = true;
+      }
+
+      search_and_replace(post_content, image_size_file_name_ext, master_file_name_ext);
     }
 
-    if (corrected) {
-      // Check if the post has really changed
-      if (post_content != post_content_backup) {
-        // Save the modified content to file
-        bool saved = save_file(post_path.c_str(), post_content);
-        if (!saved) {
-          std::cout << "Error. Failed to save file: " << post_path << "\n";
-          return 4;
-        }
+    // Check if the post has really changed
+    bool changed = corrected && post_content != post.content;
+    close_post(post);
+
+    if (changed && dry_run) {
+      // Keep the modified content in memory for the next images
+      c.modified_posts[post_path].swap(post_content);
+    } else if (changed) {
+      // Save the modified content to file
+      bool saved = replace_file(post_path, post_content, error);
+      if (!saved) {
+        std::cout << "Error. Failed to save file: " << post_path << ". " << error << "\n";
+        return 4;
       }
+      saved_files.push_back(post_path);
     }
   }
 
+  // Make sure the posts are written to disk before the image sizes are deleted
+  std::string error;
+  if (!sync_files(saved_files, error)) {
+    std::cout << "Error. " << error << "\n";
+    return 4;
+  }
+
   return 0;
 }
 
-int search_image_sizes(const Arguments & args, const Context & c) {
+int search_image_sizes(const Arguments & args, Context & c) {
   std::cout << "Searching for master image files...\n";
 
   for(size_t i=0; i<c.image_files.size(); i++) {
@@ -152,6 +258,8 @@ int search_image_sizes(const Arguments & args, const Context & c) {
 
     for(size_t j=0; j<candidate_files.size(); j++) {
       const std::string & test_path = candidate_files[j];
+      if (c.deleted_files.find(test_path) != c.deleted_files.end())
+        continue;
 
       // Is this really an image sub size of the original file ?
       bool is_image_size = is_sub_image_size(master_path.c_str(), test_path.c_str());
@@ -184,6 +292,10 @@ int search_image_sizes(const Arguments & args, const Context & c) {
     // Delete sub file image sizes
     for(size_t j=0; j<sizes.size(); j++) {
       const std::string & image_size_path = sizes[j];
+      if (dry_run) {
+        c.deleted_files.insert(image_size_path);
+        continue;
+      }
       bool deleted = delete_file(image_size_path.c_str());
       if (!deleted)
         return 5;
@@ -195,6 +307,45 @@ int search_image_sizes(const Arguments & args, const Context & c) {
   return 0;
 }
 
+/// <summary>
+/// Writes the changes of a dry run to the --diff file, or to the standard output: the diff of each modified post followed by the deleted image sizes.
+/// </summary>
+int report_dry_run(const Arguments & args, const Context & c) {
+  std::string report;
+  size_t lines_added = 0;
+  size_t lines_removed = 0;
+  for(std::map<std::string, std::string>::const_iterator it = c.modified_posts.begin(); it != c.modified_posts.end(); it++) {
+    MappedFile post;
+    std::string error;
+    if (!map_file(it->first, post, error)) {
+      std::cout << "Error. " << error << "\n";
+      return 3;
+    }
+    DIFF_STATS stats;
+    report += to_file_diff(std::string_view(post.data, post.size), it->second, it->first, diff_format, stats);
+    unmap_file(post);
+    lines_added += stats.lines_added;
+    lines_removed += stats.lines_removed;
+  }
+  for(std::set<std::string>::const_iterator it = c.deleted_files.begin(); it != c.deleted_files.end(); it++) {
+    report += to_deleted_file_diff(*it, diff_format);
+  }
+
+  std::cout << "Dry run. " << c.modified_posts.size() << " posts would be modified: " << lines_added << " lines added, " << lines_removed << " lines removed. " << c.deleted_files.size() << " image sizes would be deleted.\n";
+  if (args.diff.empty()) {
+    std::cout << report;
+    return 0;
+  }
+
+  std::string error;
+  if (!replace_file(args.diff, report, error)) {
+    std::cout << "Error. " << error << "\n";
+    return 4;
+  }
+  std::cout << "Saved diff file '" << args.diff << "'.\n";
+  return 0;
+}
+
 void show_usage() {
   std::cout << "filterimagesizes\n";
   std::cout << "Usage:\n";
@@ -204,6 +355,9 @@ void show_usage() {
   std::cout << "Arguments:\n";
   std::cout << "  --wp-content=<dir>\t\tPath to a wordpress 'wp-content' directory.\n";
   std::cout << "  --content=<dir>\t\tPath to the 'content' directory of a hugo site repository.\n";
+  std::cout << "  --dry-run\t\t\tSearch the image sizes without modifying the posts or deleting the images and display the changes as a unified diff.\n";
+  std::cout << "  --diff=<path>\t\t\tSave the changes of --dry-run to a file instead of displaying them.\n";
+  std::cout << "  --diff-format=<name>\t\tFormat of the changes of --dry-run: 'unified' (default) or 'stats'.\n";
   std::cout << "\n";
 }
 
@@ -235,6 +389,25 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // Search --dry-run argument
+  // Search --diff=<path> argument
+  // Search --diff-format=<name> argument
+  dry_run = has_argument("dry-run", argc, argv);
+  args.diff = find_argument("diff", argc, argv);
+  args.diff_format = find_argument("diff-format", argc, argv);
+  if (!dry_run && (!args.diff.empty() || !args.diff_format.empty())) {
+    std::cout << "Error. Please specify --dry-run with --diff or --diff-format arguments.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  if (!args.diff_format.empty() && !parse_diff_format(args.diff_format, diff_format)) {
+    std::cout << "Error. Unknown diff format '" << args.diff_format << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+
   // Check that input directories exists
   if (!dir_exists(args.wp_content_dir.c_str())) {
     std::cout << "Error. Directory not found: " << args.wp_content_dir << "\n";
@@ -260,6 +433,7 @@ int main(int argc, char* argv[])
   // Read posts
   std::cout << "Reading files from directory: " << args.content_dir << "\n";
   c.posts_files = get_files_in_directory(args.content_dir.c_str());
+  c.posts_files.erase(std::remove_if(c.posts_files.begin(), c.posts_files.end(), is_temp_file), c.posts_files.end());
   if (c.posts_files.empty()) {
     std::cout << "Error. Directory is empty: " << args.content_dir << "\n";
     return 3;
@@ -272,5 +446,7 @@ int main(int argc, char* argv[])
 
   // Start the search
   int result = search_image_sizes(args, c);
+  if (result == 0 && dry_run)
+    result = report_dry_run(args, c);
   return result;
 }
@@ -0,0 +1,1835 @@
+// filters.cpp : Filters which replace html formatting by native markdown syntax.
+//
+
+#include <stdio.h>
+#include <string>
+#include <iostream>     // std::cout
+#include <vector>
+#include <sstream>
+#include <algorithm>    // std::min
+#include <unordered_map>
+
+#include "utils.h"
+#include "filters.h"
+#include "site.h"
+#include "frontmatter.h"
+
+static HtmlEntityMapping text_entity_mapping;
+static HtmlEntityMapping code_entity_mapping;
+
+static const char link_reference_endding_characters[] = { '\n', '\0' };
+static const size_t num_link_reference_endding_characters = sizeof(link_reference_endding_characters) / sizeof(link_reference_endding_characters[0]);
+
+bool convert_span(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_paragraph_with_custom_css(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_paragraph(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_image(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown, bool & has_alt);
+bool convert_anchor(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_strong(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_italic(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_emphasized(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_code(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_list_item(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_unordered_list(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_division(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_division_gallery(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_table(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_preformatted(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+bool convert_small(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+
+/// <summary>
+/// This filter is required since all my headers (h1, h2, h3...) are wrapped in a "<span>".
+/// </summary>
+/// <remarks>
+/// For example: "# <span id="Introduction">Introduction</span>"
+/// This filter removes the "<span>" tags but only if there is no html inside the tag.
+/// </remarks>
+bool convert_span(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.assign(inner_text);
+  return true;
+}
+
+size_t filter_span(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_SPAN, offset, info)) {
+    if (convert_span(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag. Do not use close_end to prevent skipping tags within other tags of the same type.
+      // For example, <span><span>foo bar</span></span>
+      offset = info.open_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+bool is_custom_css_class(std::string_view class_) {
+  return has_custom_css_class(get_site_profile(), class_);
+}
+
+/// <summary>
+/// This filter removes all <p> tags.
+/// I use multiple custom css classes in my original wordpress posts. For example: 
+///  * `pleasenote` is used to emphasise a note.
+///  * `postedit`, to highlight post edits after publishing (after first public release).
+/// Each paragraph that had custom css classes are wrapped in a shortcode which name matches the name of the class.
+/// For example:
+///   {{< postedit >}}
+///     Source code is now moved to GitHub. Source code can be downloaded from [the project's GitHub page](http://github.com/end2endzone/msbuildreorder).
+///   {{< /postedit >}}
+/// And the shortcode for postedit is the following:
+///   <p class="postedit">
+///     {{ .Inner | markdownify }}
+///   </p>
+/// This filter removes the "<p>" tags but only if there is no html inside the tag.
+/// </summary>
+bool convert_paragraph_with_custom_css(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  std::string_view class_value = get_html_attribute_view(content, "class", info);
+  bool has_custom_css_class = is_custom_css_class(class_value);
+
+  // Clean up inner text
+  inner_text = trim_html_whitespace_view(inner_text);
+
+  if (has_custom_css_class) {
+    // Wrap the content inside a custom shortcode that matches the name of the css class
+    markdown.clear();
+    markdown.append("{{< ");
+    markdown.append(class_value);
+    markdown.append(" >}}\n");
+    markdown.append("  ");
+    markdown.append(inner_text);
+    markdown.append("\n");
+    markdown.append("{{< /");
+    markdown.append(class_value);
+    markdown.append(" >}}\n");
+  } else {
+    markdown.assign(inner_text);
+  }
+  return true;
+}
+
+size_t filter_paragraph_with_custom_css(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_P, offset, info)) {
+    if (convert_paragraph_with_custom_css(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter removes all <p> tags.
+/// This filter removes the "<p>" tags but only if there is no html inside the tag.
+/// The "<p>" tag is skipped if it uses one of my custom css classes.
+/// </summary>
+bool convert_paragraph(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  std::string_view class_value = get_html_attribute_view(content, "class", info);
+  bool has_custom_css_class = is_custom_css_class(class_value);
+  if (has_custom_css_class)
+    return false; // Do not replace <p> tags that has our custom css classes.
+
+  // Clean up inner text
+  markdown.assign(trim_html_whitespace_view(inner_text));
+  return true;
+}
+
+size_t filter_paragraph(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_P, offset, info)) {
+    if (convert_paragraph(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <img> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_image(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown, bool & has_alt) {
+  HtmlAttributeTable attributes;
+  parse_html_attributes(content, info, attributes);
+  std::string_view src = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_SRC);
+  std::string_view alt = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_ALT);
+
+  has_alt = !alt.empty();
+  if (src.empty())
+    return false;
+
+  markdown.assign("![");
+  if (has_alt)
+    markdown.append(alt);
+  markdown.append("](");
+  markdown.append(src);
+  markdown.append(")");
+  return true;
+}
+
+size_t filter_images(std::string & content) {
+  HTML_TAG_INFO info = {0};
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  info.open_start = content.find("<img", 0);
+  size_t count = 0;
+  while(!content.empty() && info.open_start != std::string::npos) {
+    size_t open_end_1 = content.find(">", info.open_start);
+    size_t open_end_2 = content.find("/>", info.open_start);
+    size_t open_end_pattern_length = 0;
+    if (open_end_1 != std::string::npos && open_end_2 != std::string::npos)
+      info.open_end = std::min(open_end_1, open_end_2);
+    else if (open_end_1 != std::string::npos)
+      info.open_end = open_end_1;
+    else if (open_end_2 != std::string::npos)
+      info.open_end = open_end_2;
+    if (info.open_end == open_end_1)
+      open_end_pattern_length = 1;
+    else if (info.open_end == open_end_2)
+      open_end_pattern_length = 2;
+
+    bool has_alt = false;
+    if (convert_image(content, info, markdown, has_alt)) {
+      // replace
+      replace_piece(document, info.open_start, info.open_end + open_end_pattern_length, markdown);
+      count++;
+
+      // next tag
+      info.open_start = content.find("<img", info.open_end + open_end_pattern_length);
+    } else {
+      // next tag
+      info.open_start = content.find("<img", info.open_start + 1);
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <a> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_anchor(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  HtmlAttributeTable attributes;
+  parse_html_attributes(content, info, attributes);
+  std::string_view href_value  = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_HREF);
+  std::string_view title_value = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_TITLE);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html || href_value.empty() || inner_text.empty())
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.assign("[");
+  markdown.append(inner_text);
+  markdown.append("](");
+  markdown.append(href_value);
+  markdown.append(")");
+  if (!title_value.empty()) {
+    markdown.erase(markdown.size() - 1, 1);
+    markdown.append(" \"");
+    markdown.append(title_value);
+    markdown.append("\")");
+  }
+  return true;
+}
+
+size_t filter_anchors(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_A, offset, info)) {
+    if (convert_anchor(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <strong> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_strong(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.clear();
+  if (!inner_text.empty()) {
+    markdown.assign("**");
+    markdown.append(inner_text);
+    markdown.append("**");
+  }
+  return true;
+}
+
+size_t filter_strong(std::string & content, HTML_TAG_ID tag_id) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, tag_id, offset, info)) {
+    if (convert_strong(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <strong> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+size_t filter_strong(std::string & content) {
+  size_t count = 0;
+  count += filter_strong(content, HTML_TAG_ID_STRONG);
+  count += filter_strong(content, HTML_TAG_ID_B);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <i> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_italic(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.clear();
+  if (!markdown.empty()) {
+    markdown.assign("_");
+    markdown.append(inner_text);
+    markdown.append("_");
+  }
+  return true;
+}
+
+size_t filter_italic(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_I, offset, info)) {
+    if (convert_italic(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <em> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_emphasized(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.assign(inner_text);
+  if (!markdown.empty()) {
+    markdown.assign("_");
+    markdown.append(inner_text);
+    markdown.append("_");
+  }
+  return true;
+}
+
+size_t filter_emphasized(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_EM, offset, info)) {
+    if (convert_emphasized(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <code> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+/// <remarks>
+/// If the text inside the tag is on a single line,  the content is wrapped inside '`' (backticks characters).
+/// If the text inside the tag is on multiple lines, the content is wrapped inside fenced code blocks (a triple "```" character sequence)
+/// </remarks>
+bool convert_code(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  bool is_single_line = (inner_text.find('\n') == std::string::npos);
+
+  // filter more html entities of the trimmed code, then wrap the code
+  markdown.assign(trim_html_whitespace_view(inner_text));
+  filter_more_html_entities(markdown);
+
+  if (!markdown.empty()) {
+    if (is_single_line) {
+      markdown.insert(0, "`");
+      markdown.append("`");
+    } else {
+      markdown.insert(0, "\n```\n");
+      markdown.append("\n```\n");
+    }
+  }
+  return true;
+}
+
+size_t filter_code(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_CODE, offset, info)) {
+    if (convert_code(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <li> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_list_item(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.assign("* ");
+  markdown.append(trim_html_whitespace_view(inner_text));
+  return true;
+}
+
+size_t filter_list_item(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_LI, offset, info)) {
+    if (convert_list_item(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <ul> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_unordered_list(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  markdown.assign(trim_html_whitespace_view(get_html_inner_view(content, info)));
+  return true;
+}
+
+size_t filter_unordered_lists(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_UL, offset, info)) {
+    convert_unordered_list(content, info, markdown);
+
+    // replace
+    replace_piece(document, info.open_start, info.close_end + 1, markdown);
+    count++;
+
+    // next tag
+    offset = info.close_end + 1;
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all css justified <li> tags by plain <li> tags.
+/// This filter must be run before `filter_list_item()` function is called.
+/// </summary>
+/// <remarks>
+/// This is a custom issue about my posts on my previous web site. Some lists was formatted justified.
+/// This filter basically runs a search and replace to replace erase the "style='text-align: justify;'" html attribute in list items.
+/// </remarks>
+size_t filter_list_item_simplify(std::string & content) {
+  static const std::string complex_list_item = "<li style=\"text-align: justify;\">";
+  static const std::string simplified_list_item = "<li>";
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t offset = content.find(complex_list_item);
+  size_t count = 0;
+  while(offset != std::string::npos) {
+    // replace by a simplified version of the justified list item
+    replace_piece(document, offset, offset + complex_list_item.size(), simplified_list_item);
+    count++;
+
+    // next tag
+    offset = content.find(complex_list_item, offset + complex_list_item.size());
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter removes all wordpress-generated <pre> tags which directly encloses <code> tags.
+/// </summary>
+/// <remarks>
+/// This filter must be run before `filter_code()` function is called.
+/// </remarks>
+void filter_preformatted_code_simplify(std::string & content) {
+  static const std::string complex_preformatted = "<pre class=\"wp-block-code\"><code>";
+  static const std::string simplified_preformatted = "<code>";
+  static const std::string complex_close_pattern = "</code></pre>";
+  static const std::string simplified_close_pattern = "</code>";
+  size_t offset = content.find(complex_preformatted);
+  while(offset != std::string::npos) {
+    // replace by a simplified version of the preformatted code
+    content.replace(content.begin() + offset, content.begin() + complex_preformatted.size() + 1, simplified_preformatted);
+
+    // search for the closing tags
+    size_t offset_close = content.find(complex_close_pattern);
+    if (offset_close != std::string::npos) {
+      // replace by a simplified version of the preformatted code
+      content.replace(content.begin() + offset_close, content.begin() + complex_close_pattern.size() + 1, simplified_close_pattern);
+    }
+
+    // next tag
+    offset = content.find(complex_preformatted, offset);
+  }
+}
+
+/// <summary>
+/// This filter removes all <div> tags, but only if there is no html inside the tag.
+/// </summary>
+/// <remarks>
+/// Most <div> tags are file downloads (attachments) like `<div id="attachment_2357" style="width: 560px" class="wp-caption alignnone">`.
+/// Divisions that are galleries must be processed first with function `filter_division_gallery()`.
+/// </remarks>
+bool convert_division(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  std::string_view class_value = get_html_attribute_view(content, "class", info);
+  bool has_custom_css_class = is_custom_css_class(class_value);
+  if (has_custom_css_class)
+    return false; // Do not replace <div> tags that has our custom css classes.
+
+  // Check if the indentation of the content inside the division must be decreased.
+  size_t div_indentation = 0;
+  size_t inner_html_indentation = 0;
+  if (content[info.inner_start] == '\n' || (content[info.inner_start] == '\r' && content[info.inner_start+1] == '\n')) { // If div is the only tag on the line
+    // Check if the inner_html is more indented than the divivision itself
+    div_indentation = get_line_indentation(content.data(), info.open_start);
+    size_t nonwhite_pos = get_first_nonwhite_html_character(content.data(), content.size(), info.inner_start);
+    if (nonwhite_pos != std::string::npos) {
+      inner_html_indentation = get_line_indentation(content.data(), nonwhite_pos);
+    }
+  }
+
+  // Remove first and last newline characters
+  if (!inner_text.empty() && inner_text[0] == '\n')
+    inner_text.remove_prefix(1);
+  if (!inner_text.empty() && inner_text[inner_text.size()-1] == '\n')
+    inner_text.remove_suffix(1);
+
+  // Check if we need to decease the indentation of the inner_text
+  if (inner_html_indentation > div_indentation) {
+
+    // Decrease indentation of inner_text
+    markdown.assign(inner_text);
+    decrease_indent(markdown, 2);
+
+    // and then trim the inner text
+    trim_html_whitespace(markdown);
+  } else {
+    // Trim the inner text
+    markdown.assign(trim_html_whitespace_view(inner_text));
+  }
+  return true;
+}
+
+size_t filter_division(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_DIV, offset, info)) {
+    if (convert_division(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+inline bool is_division_gallery(std::string_view content, const HTML_TAG_INFO & info) {
+  if (content.empty() ||
+    (info.open_start == 0 && info.open_end == 0) ||
+    (info.open_start == std::string::npos || info.open_end == std::string::npos))
+    return false;
+
+  HtmlAttributeTable attributes;
+  parse_html_attributes(content, info, attributes);
+  std::string_view id_value = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_ID);
+  std::string_view class_value = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_CLASS);
+
+  if (id_value.find("gallery") != std::string::npos && class_value.find("gallery") != std::string::npos)
+    return true;
+  return false;
+}
+
+bool parse_gallery_table(std::string_view content, HtmlTable & table) {
+  table.first_row_is_header = false;
+
+  HtmlTableRow tmp_row(get_file_arena());
+
+  HTML_TAG_INFO dl_info;
+  size_t dl_offset = 0;
+  while (find_html_tag_boundaries(content, HTML_TAG_ID_DL, dl_offset, dl_info)) {
+    std::string_view dl_inner_text = get_html_inner_view(content, dl_info);
+
+    HTML_TAG_INFO dt_info;
+    size_t dt_offset = 0;
+    while (find_html_tag_boundaries(dl_inner_text, HTML_TAG_ID_DT, dt_offset, dt_info)) {
+      // Create a new cell in current row
+      std::string_view dt_inner_text = get_html_inner_view(dl_inner_text, dt_info);
+      tmp_row.emplace_back(dt_inner_text.data(), dt_inner_text.size());
+
+      // next tag dt
+      dt_offset = dt_info.close_end + 1;
+    }
+
+    // If we read all column inside the row, flush the temporary row
+    if (!tmp_row.empty()) {
+      // Flush the row accumulator to the table
+      table.rows.push_back(std::move(tmp_row));
+      tmp_row.clear();
+    }
+
+    // next tag dl
+    dl_offset = dl_info.close_end + 1;
+  }
+
+  // If there is still cells in the temporary row (accumulator), flush them in the table
+  if (!tmp_row.empty()) {
+    table.rows.push_back(std::move(tmp_row));
+    tmp_row.clear();
+  }
+
+  if (!table.rows.empty()) {
+    return true;
+  }
+  return false;
+}
+
+/// <summary>
+/// This filter removes all <div> tags, which are displaying image galleries, but only if there is no html inside the tag.
+/// </summary>
+/// <remarks>
+/// For example:
+///    <div id='gallery-22' class='gallery galleryid-1249 gallery-columns-3 gallery-size-thumbnail gallery1'>
+///      <dl class="gallery-item">
+///        <dt class="gallery-icon">
+///          <a href="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png" title="Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data" rel="gallery1"><img src="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample-146x150.png" width="146" height="150" alt="Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data" /></a><span><a class="void" href="http://www.end2endzone.com/wp-content/uploads/2016/02/Multiplexing-Analog-Knob-with-1x-2-Position-and-1x-3-Position-switches-Data-Capture-Sample.png" rel="nolightbox" target="_blank">498x510</a></span>
+///        </dt>
+///        <dd class="gallery-caption" id="caption1519">
+///          <span class="imagecaption">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br /> <span class="imagedescription">Demultiplexing an analog knob with a 2-Position and a 3-Position switch : Sample data</span><br />
+///        </dd>
+///      </dl>
+///      <br style='clear: both' />
+///    </div>
+/// </remarks>
+bool convert_division_gallery(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  if (!is_division_gallery(content, info))
+    return false;
+
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  // Parse the gallery
+  HtmlTable table;
+  table.first_row_is_header = false;
+  bool parsed = parse_gallery_table(inner_text, table);
+  if (!parsed || has_inner_html_tags(table))
+    return false;
+
+  // trim the table
+  trim_html_whitespace(table);
+
+  // convert to markdown
+  markdown = to_markdown(table);
+  return true;
+}
+
+size_t filter_division_gallery(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_DIV, offset, info)) {
+    if (convert_division_gallery(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Not a gallery or the gallery still has more html inside. Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+bool parse_html_table(std::string_view content, HtmlTable & table) {
+  table.first_row_is_header = false;
+
+  HtmlTableRow tmp_row(get_file_arena());
+
+  HTML_TAG_INFO tr_info;
+  size_t tr_offset = 0;
+  while (find_html_tag_boundaries(content, HTML_TAG_ID_TR, tr_offset, tr_info)) {
+    std::string_view tr_inner_text = get_html_inner_view(content, tr_info);
+
+    // Check if this row is a header
+    bool is_first_row = (table.rows.size() == 0);
+    std::string_view class_value = get_html_attribute_view(content, "class", tr_info);
+    if (class_value.find("header") != std::string::npos) {
+      table.first_row_is_header = true;
+    }
+
+    HTML_TAG_INFO td_info;
+    size_t td_offset = 0;
+    while (find_html_tag_boundaries(tr_inner_text, HTML_TAG_ID_TD, td_offset, td_info)) {
+      HtmlAttributeTable td_attributes;
+      parse_html_attributes(tr_inner_text, td_info, td_attributes);
+      std::string colspan_value(get_html_attribute_view(tr_inner_text, td_attributes, HTML_ATTRIBUTE_ID_COLSPAN));
+
+      // Create a new cell in current row
+      std::string_view td_inner_text = get_html_inner_view(tr_inner_text, td_info);
+      tmp_row.emplace_back(td_inner_text.data(), td_inner_text.size());
+
+      // Check if the spell spans across multiple column
+      if (!colspan_value.empty() && is_numeric(colspan_value.c_str())) {
+        // markdown does not support colspan, repeat the cell multiple times.
+        int colspan = -1;
+        parse_value(colspan_value, colspan);
+        if (colspan > 1) {
+          for(int i=1; i<colspan; i++) {
+            tmp_row.emplace_back();
+          }
+        }
+      }
+
+      // next tag dt
+      td_offset = td_info.close_end + 1;
+    }
+
+    // If we read all column inside the row, flush the temporary row
+    if (!tmp_row.empty()) {
+      // Flush the row accumulator to the table
+      table.rows.push_back(std::move(tmp_row));
+      tmp_row.clear();
+    }
+
+    // next tag dl
+    tr_offset = tr_info.close_end + 1;
+  }
+
+  // If there is still cells in the temporary row (accumulator), flush them in the table
+  if (!tmp_row.empty()) {
+    table.rows.push_back(std::move(tmp_row));
+    tmp_row.clear();
+  }
+
+  if (!table.rows.empty()) {
+    return true;
+  }
+  return false;
+}
+
+/// <summary>
+/// This filter replaces all <table> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// Unless the table header is obviously identified with css of with tags, an empty header is inserted since markdown does not support tables without headers.
+/// </summary>
+bool convert_table(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  // Skip html tables that have colspan or rowspan cells which is not supported in markdown
+  if (has_cell_spanning(inner_text))
+    return false;
+
+  // Parse the table
+  HtmlTable table;
+  table.first_row_is_header = false;
+  bool parsed = parse_html_table(inner_text, table);
+  if (!parsed || has_inner_html_tags(table))
+    return false;
+
+  // trim the table
+  trim_html_whitespace(table);
+
+  // convert to markdown
+  markdown = to_markdown(table);
+  return true;
+}
+
+size_t filter_table(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_TABLE, offset, info)) {
+    if (convert_table(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <pre> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// Most <pre> tags are used for embedding code.
+/// </summary>
+/// <remarks>
+/// See also `filter_code()` for details.
+/// The `Crayon Syntax Highlighter` wordpress plugin also generates <div> and <pre> tags. For example:
+///    <div class="crayon-line">
+///      <pre class="lang:c++ decode:true" title="Arduino tone and delay functions overrides" data-url="http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino">http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino</pre>
+///    </div>
+/// </remarks>
+bool convert_preformatted(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  bool is_single_line = (inner_text.find('\n') == std::string::npos);
+
+  // Check if this <pre> tag has a class that would described the content's language.
+  // For example: `<pre class="lang:c++ decode:true" title="Arduino tone and delay functions overrides" data-url="http://www.end2endzone.com/wp-content/uploads/2016/10/Arduino-tone-and-delay-functions-overrides.ino">`
+  HtmlAttributeTable attributes;
+  parse_html_attributes(content, info, attributes);
+  std::string lang;
+  std::string_view class_value = get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_CLASS);
+  if (!class_value.empty()) {
+    // get the 'lang' parameter
+    lang = find_class_property(class_value, "lang");
+    lang = get_site_language(get_site_profile(), lang);
+  }
+
+  // Detect if the code is inlined in the content or if the code is from a local static file
+  bool has_data_url_value = has_html_attribute(attributes, HTML_ATTRIBUTE_ID_DATA_URL);
+  if (has_data_url_value) {
+    is_single_line = false;
+
+    // Read the url of the file and trim the hostname from the url
+    std::string data_url_value(get_html_attribute_view(content, attributes, HTML_ATTRIBUTE_ID_DATA_URL));
+    search_and_replace(data_url_value, get_site_profile().hostname, "");
+
+    // Hugo's storage file starts with /static/
+    data_url_value.insert(0, "/static");
+
+    // Use a hugo shortcode to highlight file identified by the data-url into this content
+    // The file hightlight-static-file.html should have the following content: `{{ highlight (readFile (.Get "file")) (.Get "lang") "" }}`
+    // and should be called with the following syntax: `{{< hightlight-static-file file="/static/wp-content/uploads/2015/01/guess.cpp" lang="cpp" >}}`
+    markdown.clear();
+    markdown.append("{{< hightlight-static-file file=\"");
+    markdown.append(data_url_value);
+    markdown.append("\" lang=\"");
+    markdown.append(lang);
+    markdown.append("\" >}}");
+  }
+  else {
+    // filter more html entities of the trimmed code, then wrap the code
+    markdown.assign(trim_html_whitespace_view(inner_text));
+    filter_more_html_entities(markdown);
+
+    if (is_single_line) {
+      markdown.insert(0, "`");
+      markdown.append("`");
+    } else {
+      markdown.insert(0, "\n```\n");
+      markdown.insert(4, lang); // after "\n```"
+      markdown.append("\n```\n");
+    }
+  }
+  return true;
+}
+
+size_t filter_preformatted(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_PRE, offset, info)) {
+    if (convert_preformatted(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // Search for the next tag
+      offset = info.close_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// This filter replaces all <small> tags with their markdown equivalent, but only if there is no html inside the tag.
+/// </summary>
+bool convert_small(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown) {
+  std::string_view inner_text = get_html_inner_view(content, info);
+
+  bool has_inner_html = has_inner_html_tags(inner_text);
+  if (has_inner_html)
+    return false; // The inner text of the tag has more html inside. Do not proceed with the replacement.
+
+  markdown.assign(inner_text);
+  return true;
+}
+
+size_t filter_small(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  std::string markdown;
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t count = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_SMALL, offset, info)) {
+    if (convert_small(content, info, markdown)) {
+      // replace
+      replace_piece(document, info.open_start, info.close_end + 1, markdown);
+      count++;
+
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+      // Do more passes to replace all the code.
+      // next tag. Do not use close_end to prevent skipping tags within other tags of the same type.
+      // For example, <small><small>foo bar</small></small>
+      offset = info.open_end + 1;
+    }
+  }
+
+  flatten_piece_table(document, content);
+  return count;
+}
+
+/// <summary>
+/// Initialize the replacement of decoded html entities.
+/// In the markdown text, typographic quotes and dashes are replaced by their plain ascii equivalent.
+/// Characters that have a meaning in html or markdown are kept encoded.
+/// Inside code, all entities are decoded since markdown code is displayed as is.
+/// </summary>
+void init_html_entity_mappings() {
+  text_entity_mapping[0x0026] = "&amp;";
+  text_entity_mapping[0x003C] = "&lt;";
+  text_entity_mapping[0x003E] = "&gt;";
+  text_entity_mapping[0x0021] = "&#33;";  // !
+  text_entity_mapping[0x0023] = "&#35;";  // #
+  text_entity_mapping[0x002A] = "&#42;";  // *
+  text_entity_mapping[0x002B] = "&#43;";  // +
+  text_entity_mapping[0x002D] = "&#45;";  // -
+  text_entity_mapping[0x005B] = "&#91;";  // [
+  text_entity_mapping[0x005C] = "&#92;";  // backslash
+  text_entity_mapping[0x005D] = "&#93;";  // ]
+  text_entity_mapping[0x005F] = "&#95;";  // _
+  text_entity_mapping[0x0060] = "&#96;";  // `
+  text_entity_mapping[0x007B] = "&#123;"; // {
+  text_entity_mapping[0x007C] = "&#124;"; // |
+  text_entity_mapping[0x007D] = "&#125;"; // }
+  text_entity_mapping[0x00A0] = "&nbsp;";
+  text_entity_mapping[0x00D7] = "x";
+  text_entity_mapping[0x2013] = "-";
+  text_entity_mapping[0x2018] = "'";
+  text_entity_mapping[0x2019] = "'";
+  text_entity_mapping[0x201C] = "\"";
+  text_entity_mapping[0x201D] = "\"";
+  text_entity_mapping[0x2026] = "...";
+  text_entity_mapping[0x2032] = "'";
+
+  code_entity_mapping[0x00A0] = " ";
+}
+
+void filter_known_html_entities(std::string & content) {
+  // look for &nbsp; encoded as a utf8 code point
+  search_and_replace(content, "\xc2\xa0", "&nbsp;");
+
+  decode_html_entities(content, text_entity_mapping);
+}
+
+void filter_more_html_entities(std::string & content) {
+  decode_html_entities(content, code_entity_mapping);
+}
+
+/// <summary>
+/// This filter replaces all non-breaking space ( "&nbsp;" ) entities by a normal space, where a non-breaking space is not mandatory.
+/// For examples, if the non-breaking space is between two words, a normal space is enough.
+/// At multiple locations, wordpress seems to had prefered to insert "&nbsp;" instead of normal spaces.
+/// </summary>
+void filter_useless_nbsp_entities(std::string & content) {
+  static const std::string pattern = "&nbsp;";
+  size_t pos = content.find(pattern);
+  while(pos != std::string::npos) {
+
+    // Check characters before and after.
+    char c_before = '\0';
+    char c_after = '\0';
+    if (pos > 0)
+      c_before = content[pos - 1];
+    if (pos+1 < content.size())
+      c_after = content[pos + 1];
+
+    // If they are alphanumeric, the non-breaking space can be safely replaced by a normal space
+    if (is_text(c_before) && is_text(c_after)) {
+      // Replace the non-breaking space
+      content.replace(content.begin() + pos, content.begin() + pos + pattern.size(), " ");
+
+      // next nbsp entity
+      pos = content.find(pattern, pos);
+      continue;
+    }
+  
+    // next nbsp entity
+    pos = content.find(pattern, pos + 1);
+  }
+}
+
+/// <summary>
+/// Returns the identifier of the table tag which starts at the given offset: <td>, <tr>, </td> or </tr>.
+/// Returns HTML_TAG_ID_UNKNOWN for any other tag.
+/// </summary>
+static HTML_TAG_ID read_table_tag(std::string_view content, size_t offset, bool & closing) {
+  size_t name_start = offset + 1;
+  closing = (name_start < content.size() && content[name_start] == '/');
+  if (closing)
+    name_start++;
+  size_t name_end = name_start;
+  while (name_end < content.size() && is_alphanumeric(content[name_end]))
+    name_end++;
+  if (name_end >= content.size())
+    return HTML_TAG_ID_UNKNOWN;
+
+  // The name must be complete. A closing tag has no attributes.
+  char next = content[name_end];
+  if (closing ? (next != '>') : (next != '>' && next != '/' && next != ' ' && next != '\t' && next != '\n' && next != '\r'))
+    return HTML_TAG_ID_UNKNOWN;
+
+  HTML_TAG_ID tag_id = get_html_tag_id(content.data() + name_start, name_end - name_start);
+  if (tag_id != HTML_TAG_ID_TD && tag_id != HTML_TAG_ID_TR)
+    return HTML_TAG_ID_UNKNOWN;
+  return tag_id;
+}
+
+/// <summary>
+/// This filter normalizes the white space of the tables in a single pass over the document:
+/// - It trims the content of all <td> tags, but only if there is no html inside the tag.
+///   In other words, it removes all white space characters from the beginning and the end of the inner html.
+/// - It removes the empty lines between a </td> and the next <td> or </tr>, and between a </tr> and the next <tr>.
+///   The next tag keeps its indentation, whatever it is.
+/// </summary>
+void filter_table_white_space(std::string & content) {
+  PieceTable document;
+  init_piece_table(document, content);
+  bool trim_cells = true;
+  size_t trim_offset = 0; // the cells are searched after the end of the previous cell, like find_html_tag_boundaries()
+  size_t pos = content.find('<');
+  while (pos != std::string::npos) {
+    bool closing = false;
+    HTML_TAG_ID tag_id = read_table_tag(content, pos, closing);
+
+    if (tag_id == HTML_TAG_ID_TD && !closing && trim_cells && pos >= trim_offset) {
+      HTML_TAG_INFO info;
+      if (find_html_tag_boundaries(content, HTML_TAG_ID_TD, pos, info)) {
+        // A cell without html inside has no table tags: the white space of the table is never inside a trimmed cell.
+        std::string_view inner_text = get_html_inner_view(content, info);
+        if (!has_inner_html_tags(inner_text)) {
+          // trim the cell on a single line
+          inner_text = trim_html_whitespace_view(inner_text);
+
+          // replace the tag's inner text
+          replace_piece(document, info.inner_start, info.inner_end + 1, inner_text);
+        }
+        trim_offset = info.close_end + 1;
+      } else {
+        // There are no more complete cells
+        trim_cells = false;
+      }
+    } else if (tag_id != HTML_TAG_ID_UNKNOWN && closing) {
+      // Search the next tag, separated by white space only
+      size_t gap_start = content.find('>', pos) + 1;
+      size_t next_pos = gap_start;
+      size_t num_newlines = 0;
+      size_t last_newline = std::string::npos;
+      while (next_pos < content.size() && (content[next_pos] == ' ' || content[next_pos] == '\t' || content[next_pos] == '\n')) {
+        if (content[next_pos] == '\n') {
+          num_newlines++;
+          last_newline = next_pos;
+        }
+        next_pos++;
+      }
+
+      if (num_newlines >= 2 && next_pos < content.size() && content[next_pos] == '<') {
+        bool next_closing = false;
+        HTML_TAG_ID next_tag_id = read_table_tag(content, next_pos, next_closing);
+        bool is_cell_separator = (tag_id == HTML_TAG_ID_TD && ((next_tag_id == HTML_TAG_ID_TD && !next_closing) || (next_tag_id == HTML_TAG_ID_TR && next_closing)));
+        bool is_row_separator  = (tag_id == HTML_TAG_ID_TR && next_tag_id == HTML_TAG_ID_TR && !next_closing);
+        if (is_cell_separator || is_row_separator) {
+          // keep the last newline and the indentation of the next tag
+          replace_piece(document, gap_start, last_newline, std::string_view());
+        }
+      }
+      pos = content.find('<', next_pos);
+      continue;
+    }
+
+    // next tag
+    pos = content.find('<', pos + 1);
+  }
+
+  flatten_piece_table(document, content);
+}
+
+/// <summary>
+/// This filter looks for Reference-style links and converts them to inline links.
+/// See https://www.markdownguide.org/basic-syntax/#reference-style-links and https://commonmark.org/help/tutorial/07-links.html for details.
+/// </summary>
+void force_inline_hyperlinks(std::string & content) {
+  typedef std::pmr::unordered_map<std::string_view, std::string_view> LinkReferenceMap;
+  static const std::string_view reference_prefix = "\n [";
+  static const std::string_view reference_separator = "]: ";
+
+  // Collect the url of each reference definition, like `\n [1]: http://www.end2endzone.com`.
+  // The first definition of a label is used and removed, like markdown renderers do.
+  LinkReferenceMap references(get_file_arena());
+  std::pmr::vector<size_t> definitions(get_file_arena()); // start and end offsets of the definitions to remove
+  size_t reference_pos = content.find(reference_prefix);
+  while (reference_pos != std::string::npos) {
+    size_t label_start = reference_pos + reference_prefix.size();
+    size_t label_end = content.find_first_of("]\n", label_start);
+    if (label_end != std::string::npos && label_end > label_start && content.compare(label_end, reference_separator.size(), reference_separator) == 0) {
+      std::string_view label(content.data() + label_start, label_end - label_start);
+      size_t url_start = label_end + reference_separator.size();
+      std::string_view url = read_until_view(content, url_start, link_reference_endding_characters, num_link_reference_endding_characters);
+      if (!url.empty() && references.emplace(label, url).second) {
+        definitions.push_back(reference_pos);
+        definitions.push_back(url_start + url.size());
+      }
+    }
+    reference_pos = content.find(reference_prefix, reference_pos + 1);
+  }
+  if (references.empty())
+    return;
+
+  // Replace all the text links, like `[text][1]`, and remove the definitions, in order.
+  PieceTable document;
+  init_piece_table(document, content);
+  std::string inline_link_content;
+  size_t next_definition = 0;
+  size_t text_pos = content.find("][");
+  while (text_pos != std::string::npos) {
+    // Remove the definitions before the text link
+    while (next_definition < definitions.size() && definitions[next_definition] <= text_pos) {
+      replace_piece(document, definitions[next_definition], definitions[next_definition + 1], std::string_view());
+      next_definition += 2;
+    }
+
+    size_t label_start = text_pos + 2;
+    size_t label_end = content.find_first_of("]\n", label_start);
+    bool in_definition = (next_definition > 0 && text_pos < definitions[next_definition - 1]);
+    LinkReferenceMap::const_iterator reference = references.end();
+    if (!in_definition && label_end != std::string::npos && content[label_end] == ']')
+      reference = references.find(std::string_view(content.data() + label_start, label_end - label_start));
+    if (reference != references.end()) {
+      // replace text link
+      inline_link_content.assign("](");
+      inline_link_content.append(reference->second);
+      inline_link_content.append(")");
+      replace_piece(document, text_pos, label_end + 1, inline_link_content);
+      text_pos = content.find("][", label_end + 1);
+    } else {
+      text_pos = content.find("][", text_pos + 1);
+    }
+  }
+  while (next_definition < definitions.size()) {
+    replace_piece(document, definitions[next_definition], definitions[next_definition + 1], std::string_view());
+    next_definition += 2;
+  }
+
+  flatten_piece_table(document, content);
+}
+
+/// <summary>
+/// This filter adds newline after some tags if text follows immediately after the tag close.
+/// </summary>
+/// <remarks>
+/// For example:
+///   <div id="attachment_1197" style="width: 404px" class="wp-caption alignnone">
+///     <a href="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png"><img aria-describedby="caption-attachment-1197" loading="lazy" class="size-full wp-image-1197" src="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png" alt="VirtualDub Frameserver Mode" width="394" height="205" srcset="http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode.png 394w, http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode-150x78.png 150w, http://www.end2endzone.com/wp-content/uploads/2015/11/VirtualDub-frameserver-mode-300x156.png 300w" sizes="(max-width: 394px) 100vw, 394px" /></a>
+///     <p id="caption-attachment-1197" class="wp-caption-text">
+///       VirtualDub Frameserver Mode
+///     </p>
+///   </div> The frameserver is now ready to provide frames to other applications.
+/// </remarks>
+void filter_missing_newline(std::string & content, const std::string & tag_close_definition) {
+  static const std::string newline = "\n";
+  PieceTable document;
+  init_piece_table(document, content);
+  size_t tag_close_pos = content.find(tag_close_definition);
+  while(tag_close_pos != std::string::npos) {
+    // Check the character following
+    char next = '\0';
+    size_t next_offset = tag_close_pos + tag_close_definition.size();
+    if (next_offset < content.size()) {
+      next = content[next_offset];
+    }
+
+    if (next == '\0')
+      break; // we reached the end of the document.
+
+    // Should a newline must be inserted ?
+    if (next != '\n') {
+
+      // If the next character is a space, replace it.
+      if (next == ' ')
+        replace_piece(document, next_offset, next_offset + 1, newline);
+      else {
+        // Otherwise, insert a newline
+        replace_piece(document, next_offset, next_offset, newline);
+      }
+    }
+
+    // next tag
+    tag_close_pos = content.find(tag_close_definition, tag_close_pos + 1);
+  }
+
+  flatten_piece_table(document, content);
+}
+
+/// <summary>
+/// This filter edits the front matter of a post. The other filters never see the front matter, see get_front_matter_length().
+/// The front matter is written again only if one of its elements has changed.
+/// </summary>
+/// <remarks>
+/// The html entities of the front matter are decoded like in the rest of the post.
+/// The "featured_image:" element is replaced by the new way of defining images. For examples:
+///   featured_image: /wp-content/uploads/2000/01/foobar.png
+/// Into:
+///   images:
+///     - src: /wp-content/uploads/2000/01/foobar.png
+/// The "type: post" element is removed.
+/// Hugo does not seems to like this. Posts with "type: post" don't show up in "recent posts" sections.
+/// </remarks>
+size_t filter_front_matter(std::string & content) {
+  filter_known_html_entities(content);
+  filter_useless_nbsp_entities(content);
+
+  FrontMatter front_matter;
+  if (!parse_front_matter(content, front_matter))
+    return 0;
+
+  // Move the featured images to the list of images
+  size_t count = 0;
+  for(size_t i=0; i<front_matter.entries.size(); ) {
+    FRONT_MATTER_ENTRY & entry = front_matter.entries[i];
+    // An empty featured image is not an image
+    std::string_view featured_image = get_front_matter_value(entry);
+    if (entry.key != "featured_image" || featured_image.empty()) {
+      i++;
+      continue;
+    }
+
+    std::string image = "  - src: " + std::string(featured_image) + "\n";
+    FRONT_MATTER_ENTRY * images = find_front_matter_entry(front_matter, "images");
+    if (images != NULL) {
+      images->text += image;
+      front_matter.entries.erase(front_matter.entries.begin() + i);
+    } else {
+      entry.key = "images";
+      entry.text = "images:\n" + image;
+      i++;
+    }
+    front_matter.modified = true;
+    count++;
+  }
+
+  count += remove_front_matter_entries(front_matter, "type", "post");
+
+  if (front_matter.modified)
+    content.replace(0, get_front_matter_length(content), to_front_matter_content(front_matter));
+  return count;
+}
+
+/// <summary>
+/// After some closing tags, a newline should be inserted if missing.
+/// </summary>
+void filter_missing_newline(std::string & content) {
+  filter_missing_newline(content, "</div>");
+  filter_missing_newline(content, "</table>");
+  filter_missing_newline(content, "</p>");
+}
+
+/// <summary>
+/// This filter adds newline after the end of an header.
+/// </summary>
+/// <remarks>
+/// Headers with a missing newline are identified as the following:
+/// ## <span id="Design">Design</span> The following section illustrate the design
+/// </remarks>
+void filter_missing_newline_after_header(std::string & content) {
+  HTML_TAG_INFO info;
+  size_t offset = 0;
+  while(find_html_tag_boundaries(content, HTML_TAG_ID_SPAN, offset, info)) {
+    bool has_inner_html = has_inner_html_tags(get_html_inner_view(content, info));
+    if (has_inner_html) {
+      // The inner text of the tag has more html inside. Do not proceed with the replacement. Do more passes to replace all the code.
+      // next tag
+      offset = info.close_end + 1;
+    } else {
+
+      // Is this span a markdown header ?
+      std::string_view line = trim_html_whitespace_view(get_line_view_at_offset(content, info.open_start));
+      if (!line.empty() && line[0] == '#') {
+
+        // Check the next character following </span>
+        char next = '\0';
+        size_t next_offset = info.close_end + 1;
+        if (next_offset < content.size()) {
+          next = content[next_offset];
+        }
+
+        if (next == '\0')
+          return; // we reached the end of the document.
+
+        // Should a newline must be inserted ?
+        if (next != '\n') {
+
+          // If the next character is a space, replace it.
+          if (next == ' ')
+            content[next_offset] = '\n';
+          else {
+            // Otherwise, insert a newline
+            content.insert(next_offset, 1, '\n');
+          }
+        }
+      }
+
+      // next tag
+      offset = info.close_end + 1;
+    }
+  }
+}
+
+void filter_comment_separators(std::string & content) {
+  static const std::string pattern = "<!--=================================================-->";
+  static const std::string empty_string;
+
+  search_and_replace(content, std::string() + "\n" + pattern + "\n", empty_string);
+  search_and_replace(content, std::string() + pattern + " ", empty_string);
+  search_and_replace(content, std::string() + pattern, empty_string);
+}
+
+/// <summary>
+/// This filter removes messed up "more" identifiers.
+/// For an unknown reasons, some of my posts have a french-english "more" indentifier.
+/// </summary>
+void filter_more_comment(std::string & content) {
+  static const std::string pattern = "<!--more Lire la suite →-->";
+  static const std::string value = "<!--more-->";
+
+  search_and_replace(content, pattern, value);
+}
+
+typedef bool (*TAG_CONVERTER_FUNCTION)(std::string_view content, const HTML_TAG_INFO & info, std::string & markdown);
+
+struct TAG_CONVERTER {
+  HTML_TAG_ID tag_id;
+  TAG_CONVERTER_FUNCTION function;
+  TREE_CONVERSION conversion;
+};
+
+// Tag converters in the same order as the filters of a pass in `run_all_filters()`.
+static const TAG_CONVERTER tag_converters[] = {
+  { HTML_TAG_ID_SPAN,   convert_span,                       TREE_CONVERSION_SPAN                      },
+  { HTML_TAG_ID_P,      convert_paragraph_with_custom_css,  TREE_CONVERSION_PARAGRAPH_WITH_CUSTOM_CSS },
+  { HTML_TAG_ID_P,      convert_paragraph,                  TREE_CONVERSION_PARAGRAPH                 },
+  { HTML_TAG_ID_STRONG, convert_strong,                     TREE_CONVERSION_STRONG                    },
+  { HTML_TAG_ID_B,      convert_strong,                     TREE_CONVERSION_STRONG                    },
+  { HTML_TAG_ID_I,      convert_italic,                     TREE_CONVERSION_ITALIC                    },
+  { HTML_TAG_ID_A,      convert_anchor,                     TREE_CONVERSION_ANCHORS                   },
+  { HTML_TAG_ID_EM,     convert_emphasized,                 TREE_CONVERSION_EMPHASIZED                },
+  { HTML_TAG_ID_CODE,   convert_code,                       TREE_CONVERSION_CODE                      },
+  { HTML_TAG_ID_LI,     convert_list_item,                  TREE_CONVERSION_LIST_ITEM                 },
+  { HTML_TAG_ID_DIV,    convert_division_gallery,           TREE_CONVERSION_DIVISION_GALLERY          },
+  { HTML_TAG_ID_TABLE,  convert_table,                      TREE_CONVERSION_TABLE                     },
+  { HTML_TAG_ID_DIV,    convert_division,                   TREE_CONVERSION_DIVISION                  },
+  { HTML_TAG_ID_PRE,    convert_preformatted,               TREE_CONVERSION_PREFORMATTED              },
+  { HTML_TAG_ID_SMALL,  convert_small,                      TREE_CONVERSION_SMALL                     },
+};
+static const size_t num_tag_converters = sizeof(tag_converters) / sizeof(tag_converters[0]);
+
+/// <summary>
+/// Returns true if the tree engine converts the element of the given open tag exactly like the passes.
+/// </summary>
+/// <remarks>
+/// The filters of the passes match an open tag with the first close tag of the same name that follows it.
+/// An element nested in an element of the same name, a close tag without an open tag, or an open tag without a close tag
+/// is matched differently by the passes. Only the tags of the converted filters matter: the passes never search the other tags.
+/// </remarks>
+static bool is_tree_element_conversion(const HtmlElementTree & tree, size_t open_index, const bool * converted_tags) {
+  const HTML_TOKEN & open = tree.tokens[open_index];
+  if (open.type != HTML_TOKEN_OPEN)
+    return false;
+
+  size_t open_elements[NUM_HTML_TAG_IDS] = {0};
+  open_elements[open.tag_id] = 1;
+  for(size_t i=open_index+1; i<open.match; i++) {
+    const HTML_TOKEN & token = tree.tokens[i];
+    if (!converted_tags[token.tag_id])
+      continue;
+    if (token.type == HTML_TOKEN_TEXT) {
+      return false;
+    } else if (token.type == HTML_TOKEN_OPEN) {
+      if (open_elements[token.tag_id]++ > 0)
+        return false;
+    } else if (token.type == HTML_TOKEN_CLOSE) {
+      open_elements[token.tag_id]--;
+    }
+  }
+  return true;
+}
+
+/// <summary>
+/// Returns true if the token is a close tag, matched or not.
+/// </summary>
+inline bool is_html_close_token(const std::string & content, const HTML_TOKEN & token) {
+  return (token.type == HTML_TOKEN_CLOSE || (token.type == HTML_TOKEN_TEXT && token.tag_id != HTML_TAG_ID_UNKNOWN && content[token.start + 1] == '/'));
+}
+
+/// <summary>
+/// Returns the index of the last token of the range that the passes convert as a whole, starting at the given token.
+/// The range ends after the close tags that the passes match with the unmatched open tags of the range,
+/// once all the elements opened in the range are closed, and not before the given minimum end.
+/// The unmatched tags are updated with the open tags whose close tag is still searched.
+/// </summary>
+/// <remarks>
+/// An unmatched open tag is matched by the passes with the first close tag of the same name that follows it, if any.
+/// The passes never search past that close tag for this open tag, so the following elements are converted on their own
+/// and the tree engine can convert them. Without a close tag, the passes never match the open tag.
+/// </remarks>
+static size_t get_passes_range_end(const std::string & content, const HtmlElementTree & tree, size_t index, size_t min_end_index, const size_t * last_close_indexes, const bool * converted_tags, bool * unmatched_tags) {
+  size_t num_unmatched_tags = 0;
+  for(size_t i=0; i<NUM_HTML_TAG_IDS; i++) {
+    if (unmatched_tags[i])
+      num_unmatched_tags++;
+  }
+
+  // The depth of the tokens relative to the start of the range
+  ptrdiff_t depth = 0;
+  ptrdiff_t min_depth = 0;
+  for(; index<tree.tokens.size(); index++) {
+    const HTML_TOKEN & token = tree.tokens[index];
+    if (token.type == HTML_TOKEN_OPEN) {
+      depth++;
+    } else if (token.type == HTML_TOKEN_CLOSE) {
+      depth--;
+      if (depth < min_depth)
+        min_depth = depth;
+    }
+
+    if (converted_tags[token.tag_id] && token.type != HTML_TOKEN_VOID) {
+      if (is_html_close_token(content, token)) {
+        if (unmatched_tags[token.tag_id]) {
+          unmatched_tags[token.tag_id] = false;
+          num_unmatched_tags--;
+        }
+      } else if (token.type == HTML_TOKEN_TEXT && !unmatched_tags[token.tag_id] && last_close_indexes[token.tag_id] > index) {
+        unmatched_tags[token.tag_id] = true;
+        num_unmatched_tags++;
+      }
+    }
+
+    if (index >= min_end_index && num_unmatched_tags == 0 && depth == min_depth)
+      return index;
+  }
+  return tree.tokens.size() - 1;
+}
+
+/// <summary>
+/// Finds the converted tags of a document that have an open tag without a close tag of the same name after it.
+/// Only the tags that have a close tag after the given token of the original document are returned.
+/// Returns true if such a tag is found.
+/// </summary>
+static bool find_unmatched_open_tags(const std::string & content, size_t end_index, const size_t * last_close_indexes, const bool * converted_tags, bool * unmatched_tags) {
+  // The tree is only needed for the check
+  FileArenaScope arena_scope;
+  HtmlElementTree tree;
+  build_html_element_tree(content, tree);
+
+  bool found = false;
+  bool has_close[NUM_HTML_TAG_IDS] = {false};
+  for(size_t i=tree.tokens.size(); i>0; i--) {
+    const HTML_TOKEN & token = tree.tokens[i-1];
+    if (!converted_tags[token.tag_id] || token.type == HTML_TOKEN_VOID)
+      continue;
+    if (is_html_close_token(content, token)) {
+      has_close[token.tag_id] = true;
+    } else if (!has_close[token.tag_id] && last_close_indexes[token.tag_id] > end_index) {
+      unmatched_tags[token.tag_id] = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+struct OPEN_ELEMENT {
+  size_t token_index;
+  size_t output_offset;
+};
+
+/// <summary>
+/// Replaces the supported html tags by their markdown equivalent in a single pass.
+/// Only the given conversions are applied: the tags of the other filters are kept, as if their filters were not in the passes.
+/// The elements that the tree cannot convert exactly like the passes are converted by the given passes,
+/// or kept as is if no passes are given. See is_tree_element_conversion() and get_passes_range_end().
+/// </summary>
+/// <remarks>
+/// The document is tokenized once and its elements are converted from the innermost to the outermost
+/// with the same conversion functions as the filters, which gives the same result as running all passes.
+/// Each element is converted at the end of the output buffer, once its content is converted,
+/// so a conversion never moves the rest of the document.
+/// </remarks>
+void run_tree_filters(std::string & content, unsigned int conversions, RUN_PASSES_FUNCTION run_passes) {
+  if (conversions & TREE_CONVERSION_LIST_ITEM_SIMPLIFY)
+    filter_list_item_simplify(content);
+
+  HtmlElementTree tree;
+  build_html_element_tree(content, tree);
+
+  bool converted_tags[NUM_HTML_TAG_IDS] = {false};
+  for(size_t i=0; i<num_tag_converters; i++) {
+    if (conversions & tag_converters[i].conversion)
+      converted_tags[tag_converters[i].tag_id] = true;
+  }
+  if (conversions & TREE_CONVERSION_UNORDERED_LISTS)
+    converted_tags[HTML_TAG_ID_UL] = true;
+
+  std::string output;
+  output.reserve(content.size());
+
+  std::vector<OPEN_ELEMENT> open_elements;
+  size_t num_converted_elements = 0;
+  size_t last_close_indexes[NUM_HTML_TAG_IDS] = {0};
+  bool has_last_close_indexes = false;
+  std::string markdown;
+  for(size_t i=0; i<tree.tokens.size(); i++) {
+    const HTML_TOKEN & token = tree.tokens[i];
+    size_t output_offset = output.size();
+
+    // The passes convert the elements that the tree cannot convert exactly like them, as a whole
+    if (num_converted_elements == 0 && converted_tags[token.tag_id] && content[token.start + 1] != '/' && token.type != HTML_TOKEN_VOID &&
+        !is_tree_element_conversion(tree, i, converted_tags)) {
+      if (!has_last_close_indexes) {
+        for(size_t j=0; j<tree.tokens.size(); j++) {
+          if (is_html_close_token(content, tree.tokens[j]))
+            last_close_indexes[tree.tokens[j].tag_id] = j;
+        }
+        has_last_close_indexes = true;
+      }
+
+      bool unmatched_tags[NUM_HTML_TAG_IDS] = {false};
+      size_t end_index = get_passes_range_end(content, tree, i, (token.type == HTML_TOKEN_OPEN ? token.match : i), last_close_indexes, converted_tags, unmatched_tags);
+      markdown.assign(content, token.start, tree.tokens[end_index].end + 1 - token.start);
+      if (run_passes) {
+        run_passes(markdown);
+
+        // An open tag left by the passes is matched with a close tag that follows the range
+        while (find_unmatched_open_tags(markdown, end_index, last_close_indexes, converted_tags, unmatched_tags)) {
+          end_index = get_passes_range_end(content, tree, end_index + 1, end_index + 1, last_close_indexes, converted_tags, unmatched_tags);
+          markdown.assign(content, token.start, tree.tokens[end_index].end + 1 - token.start);
+          run_passes(markdown);
+        }
+      }
+      output.append(markdown);
+
+      // The range may close elements that were opened before it
+      while (!open_elements.empty() && tree.tokens[open_elements.back().token_index].match <= end_index)
+        open_elements.pop_back();
+      i = end_index;
+      continue;
+    }
+    output.append(content, token.start, token.end - token.start + 1);
+    if (converted_tags[token.tag_id] && token.type == HTML_TOKEN_OPEN)
+      num_converted_elements++;
+    else if (converted_tags[token.tag_id] && token.type == HTML_TOKEN_CLOSE)
+      num_converted_elements--;
+
+    if (token.type == HTML_TOKEN_OPEN) {
+      OPEN_ELEMENT element;
+      element.token_index = i;
+      element.output_offset = output_offset;
+      open_elements.push_back(element);
+    } else if (token.type == HTML_TOKEN_VOID) {
+      if (token.tag_id != HTML_TAG_ID_IMG || (conversions & TREE_CONVERSION_IMAGES) == 0)
+        continue;
+
+      HTML_TAG_INFO info = {};
+      info.open_start = output_offset;
+      info.open_end = output.size() - 1;
+      if (output[info.open_end - 1] == '/')
+        info.open_end--;
+
+      bool has_alt = false;
+      if (convert_image(output, info, markdown, has_alt)) {
+        output.resize(output_offset);
+        output.append(markdown);
+      }
+    } else if (token.type == HTML_TOKEN_CLOSE) {
+      OPEN_ELEMENT element = open_elements.back();
+      open_elements.pop_back();
+      const HTML_TOKEN & open = tree.tokens[element.token_index];
+
+      HTML_TAG_INFO info;
+      info.open_start   = element.output_offset;
+      info.open_end     = element.output_offset + (open.end - open.start);
+      info.inner_start  = info.open_end + 1;
+      info.close_start  = output_offset;
+      info.close_end    = output.size() - 1;
+      info.inner_end    = info.close_start - 1;
+
+      if (open.tag_id == HTML_TAG_ID_UL && (conversions & TREE_CONVERSION_UNORDERED_LISTS)) {
+        // The passes remove <ul> tags before the list items are converted.
+        // Only trim the white space of the original list, not the white space of the converted list items.
+        size_t trim_start = open.end + 1;
+        size_t trim_end = token.start;
+        find_html_whitespace_trim_range(content, trim_start, trim_end);
+        size_t leading_length = trim_start - (open.end + 1);
+        size_t trailing_length = token.start - trim_end;
+        size_t inner_length = info.close_start - info.inner_start;
+        if (leading_length + trailing_length > inner_length)
+          trailing_length = inner_length - leading_length;
+
+        markdown.assign(output, info.inner_start + leading_length, inner_length - leading_length - trailing_length);
+        output.resize(info.open_start);
+        output.append(markdown);
+        continue;
+      }
+
+      for(size_t j=0; j<num_tag_converters; j++) {
+        const TAG_CONVERTER & converter = tag_converters[j];
+        if (open.tag_id != converter.tag_id || (conversions & converter.conversion) == 0)
+          continue;
+        if (converter.function(output, info, markdown)) {
+          // replace
+          output.resize(info.open_start);
+          output.append(markdown);
+          break;
+        }
+      }
+    }
+  }
+
+  content.swap(output);
+}
+
+void run_tree_filters(std::string & content) {
+  run_tree_filters(content, TREE_CONVERSION_ALL, NULL);
+}
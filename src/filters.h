@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <string>
+
+// The conversions of the tree engine. Each conversion replaces a filter of the passes, see run_tree_filters().
+enum TREE_CONVERSION {
+  TREE_CONVERSION_SPAN                      = 1 << 0,
+  TREE_CONVERSION_PARAGRAPH_WITH_CUSTOM_CSS = 1 << 1,
+  TREE_CONVERSION_PARAGRAPH                 = 1 << 2,
+  TREE_CONVERSION_IMAGES                    = 1 << 3,
+  TREE_CONVERSION_STRONG                    = 1 << 4,
+  TREE_CONVERSION_ITALIC                    = 1 << 5,
+  TREE_CONVERSION_ANCHORS                   = 1 << 6,
+  TREE_CONVERSION_EMPHASIZED                = 1 << 7,
+  TREE_CONVERSION_CODE                      = 1 << 8,
+  TREE_CONVERSION_UNORDERED_LISTS           = 1 << 9,
+  TREE_CONVERSION_LIST_ITEM_SIMPLIFY        = 1 << 10,
+  TREE_CONVERSION_LIST_ITEM                 = 1 << 11,
+  TREE_CONVERSION_DIVISION_GALLERY          = 1 << 12,
+  TREE_CONVERSION_TABLE                     = 1 << 13,
+  TREE_CONVERSION_DIVISION                  = 1 << 14,
+  TREE_CONVERSION_PREFORMATTED              = 1 << 15,
+  TREE_CONVERSION_SMALL                     = 1 << 16,
+};
+static const unsigned int TREE_CONVERSION_ALL = (1 << 17) - 1;
+
+// Converts a part of a document with the filters of the passes, for the elements that the tree engine cannot convert exactly like them.
+typedef void (*RUN_PASSES_FUNCTION)(std::string & content);
+
+// declarations
+size_t filter_span(std::string & content);
+size_t filter_paragraph_with_custom_css(std::string & content);
+size_t filter_paragraph(std::string & content);
+size_t filter_images(std::string & content);
+size_t filter_anchors(std::string & content);
+size_t filter_strong(std::string & content);
+size_t filter_italic(std::string & content);
+size_t filter_emphasized(std::string & content);
+size_t filter_code(std::string & content);
+size_t filter_unordered_lists(std::string & content);
+size_t filter_list_item(std::string & content);
+size_t filter_list_item_simplify(std::string & content);
+void filter_preformatted_code_simplify(std::string & content);
+size_t filter_division(std::string & content);
+size_t filter_division_gallery(std::string & content);
+size_t filter_table(std::string & content);
+size_t filter_preformatted(std::string & content);
+size_t filter_small(std::string & content);
+void init_html_entity_mappings();
+void filter_known_html_entities(std::string & content);
+void filter_more_html_entities(std::string & content);
+void filter_useless_nbsp_entities(std::string & content);
+void filter_table_white_space(std::string & content);
+void force_inline_hyperlinks(std::string & content);
+void filter_missing_newline(std::string & content, const std::string & tag_close_definition);
+void filter_missing_newline(std::string & content);
+void filter_missing_newline_after_header(std::string & content);
+size_t filter_front_matter(std::string & content);
+void filter_comment_separators(std::string & content);
+void filter_more_comment(std::string & content);
+void run_tree_filters(std::string & content, unsigned int conversions, RUN_PASSES_FUNCTION run_passes);
+void run_tree_filters(std::string & content);
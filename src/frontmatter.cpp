@@ -0,0 +1,161 @@
+#include "frontmatter.h"
+
+static const char UTF8_BOM[] = "\xEF\xBB\xBF";
+
+/// <summary>
+/// Returns the length of a `---` line which starts at the given position, including its newline.
+/// Spaces and tabs are allowed after the dashes. Returns 0 if the line is not a `---` line.
+/// </summary>
+static size_t get_separator_line_length(std::string_view content, size_t pos) {
+  if (content.compare(pos, 3, "---") != 0)
+    return 0;
+  size_t line_end = pos + 3;
+  while (line_end < content.size() && (content[line_end] == ' ' || content[line_end] == '\t'))
+    line_end++;
+  if (line_end == content.size())
+    return line_end - pos;
+  if (content[line_end] == '\n')
+    return line_end + 1 - pos;
+  return 0;
+}
+
+/// <summary>
+/// Search the yaml front matter at the beginning of the content: a `---` line, the entries and a closing `---` line.
+/// The content may start with a utf-8 byte order mark.
+/// Returns false if the content does not start with a front matter.
+/// </summary>
+static bool find_front_matter(std::string_view content, size_t & opening_length, size_t & closing_start, size_t & length) {
+  size_t start = (content.compare(0, 3, UTF8_BOM) == 0 ? 3 : 0);
+  size_t opening_line_length = get_separator_line_length(content, start);
+  if (opening_line_length == 0 || content[start + opening_line_length - 1] != '\n')
+    return false;
+  opening_length = start + opening_line_length;
+
+  size_t pos = content.find("\n---", opening_length - 1);
+  while (pos != std::string::npos) {
+    size_t closing_line_length = get_separator_line_length(content, pos + 1);
+    if (closing_line_length > 0) {
+      closing_start = pos + 1;
+      length = closing_start + closing_line_length;
+      return true;
+    }
+    pos = content.find("\n---", pos + 1);
+  }
+  return false;
+}
+
+/// <summary>
+/// Returns the length of the yaml front matter at the beginning of the content, including its `---` lines.
+/// Returns 0 if the content does not start with a front matter.
+/// </summary>
+size_t get_front_matter_length(std::string_view content) {
+  size_t opening_length = 0;
+  size_t closing_start = 0;
+  size_t length = 0;
+  if (!find_front_matter(content, opening_length, closing_start, length))
+    return 0;
+  return length;
+}
+
+/// <summary>
+/// Returns the key of a line which starts a top-level entry, like `title` for `title: Hello`.
+/// Returns an empty key for indented lines, list items, comments and empty lines.
+/// </summary>
+static std::string_view get_line_key(std::string_view line) {
+  if (line.empty() || line[0] == ' ' || line[0] == '\t' || line[0] == '-' || line[0] == '#' || line[0] == '\n')
+    return std::string_view();
+  size_t colon_pos = line.find(':');
+  if (colon_pos == std::string::npos || colon_pos + 1 >= line.size())
+    return std::string_view();
+  char next = line[colon_pos + 1];
+  if (next != ' ' && next != '\n')
+    return std::string_view();
+  return line.substr(0, colon_pos);
+}
+
+/// <summary>
+/// Parses the yaml front matter at the beginning of the content into its top-level entries, in order.
+/// Returns false if the content does not start with a front matter.
+/// </summary>
+bool parse_front_matter(std::string_view content, FrontMatter & front_matter) {
+  front_matter.entries.clear();
+  front_matter.opening.clear();
+  front_matter.closing.clear();
+  front_matter.modified = false;
+
+  size_t opening_length = 0;
+  size_t closing_start = 0;
+  size_t length = 0;
+  if (!find_front_matter(content, opening_length, closing_start, length))
+    return false;
+  front_matter.opening = content.substr(0, opening_length);
+  front_matter.closing = content.substr(closing_start, length - closing_start);
+
+  // Each line belongs to the entry of the last key
+  size_t pos = opening_length;
+  while (pos < closing_start) {
+    size_t line_end = content.find('\n', pos);
+    std::string_view line = content.substr(pos, line_end + 1 - pos);
+    std::string_view key = get_line_key(line);
+    if (!key.empty() || front_matter.entries.empty()) {
+      front_matter.entries.emplace_back();
+      front_matter.entries.back().key = key;
+    }
+    front_matter.entries.back().text.append(line);
+    pos = line_end + 1;
+  }
+
+  return true;
+}
+
+std::string to_front_matter_content(const FrontMatter & front_matter) {
+  std::string content = front_matter.opening;
+  for(size_t i=0; i<front_matter.entries.size(); i++)
+    content += front_matter.entries[i].text;
+  content += front_matter.closing;
+  return content;
+}
+
+/// <summary>
+/// Returns the value on the line of the key of an entry, without the surrounding spaces.
+/// The value is empty for the keys of a list or of a nested mapping.
+/// </summary>
+std::string_view get_front_matter_value(const FRONT_MATTER_ENTRY & entry) {
+  std::string_view text = entry.text;
+  size_t value_start = entry.key.size() + 1;
+  size_t value_end = text.find('\n', value_start);
+  if (value_end == std::string::npos)
+    value_end = text.size();
+  while (value_start < value_end && (text[value_start] == ' ' || text[value_start] == '\t'))
+    value_start++;
+  while (value_end > value_start && (text[value_end - 1] == ' ' || text[value_end - 1] == '\t' || text[value_end - 1] == '\r'))
+    value_end--;
+  return text.substr(value_start, value_end - value_start);
+}
+
+FRONT_MATTER_ENTRY * find_front_matter_entry(FrontMatter & front_matter, std::string_view key) {
+  for(size_t i=0; i<front_matter.entries.size(); i++) {
+    if (!key.empty() && front_matter.entries[i].key == key)
+      return &front_matter.entries[i];
+  }
+  return NULL;
+}
+
+/// <summary>
+/// Removes the entries with the given key and value. Returns the number of removed entries.
+/// </summary>
+size_t remove_front_matter_entries(FrontMatter & front_matter, std::string_view key, std::string_view value) {
+  size_t count = 0;
+  for(size_t i=0; i<front_matter.entries.size(); ) {
+    const FRONT_MATTER_ENTRY & entry = front_matter.entries[i];
+    if (!key.empty() && entry.key == key && get_front_matter_value(entry) == value) {
+      front_matter.entries.erase(front_matter.entries.begin() + i);
+      count++;
+    } else {
+      i++;
+    }
+  }
+  if (count > 0)
+    front_matter.modified = true;
+  return count;
+}
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A top-level entry of a yaml front matter: a `key: value` line and the indented lines or list items which follow it.
+// The lines before the first key, like comments, are an entry without a key.
+struct FRONT_MATTER_ENTRY {
+  std::string key;
+  std::string text;     // the lines of the entry, including the key and the newlines
+};
+
+// The yaml header of a post, between two `---` lines, as an ordered list of entries.
+struct FrontMatter {
+  std::string opening;  // the byte order mark, if any, and the opening `---` line, kept as is
+  std::string closing;  // the closing `---` line, kept as is
+  std::vector<FRONT_MATTER_ENTRY> entries;
+  bool modified;        // true if an entry was changed since the front matter was parsed
+};
+
+// declarations
+size_t get_front_matter_length(std::string_view content);
+bool parse_front_matter(std::string_view content, FrontMatter & front_matter);
+std::string to_front_matter_content(const FrontMatter & front_matter);
+std::string_view get_front_matter_value(const FRONT_MATTER_ENTRY & entry);
+FRONT_MATTER_ENTRY * find_front_matter_entry(FrontMatter & front_matter, std::string_view key);
+size_t remove_front_matter_entries(FrontMatter & front_matter, std::string_view key, std::string_view value);
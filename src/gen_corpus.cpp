@@ -0,0 +1,95 @@
+// gen_corpus.cpp : Generates a synthetic wordpress corpus for benchmarking filterhtml and filterimagesizes.
+//
+
+#include <stdio.h>
+#include <string>
+#include <iostream>     // std::cout
+
+#include "utils.h"
+#include "corpus.h"
+
+struct Arguments {
+  std::string output_directory;
+  std::string posts;
+  std::string images;
+  std::string seed;
+};
+
+void show_usage() {
+  std::cout << "gen_corpus\n";
+  std::cout << "Usage:\n";
+  std::cout << "  Generate a synthetic wordpress corpus: posts with hugo front matter and html markup in 'content/posts'\n";
+  std::cout << "  and master images with their sub sizes in 'wp-content/uploads/YYYY/MM'.\n";
+  std::cout << "Arguments:\n";
+  std::cout << "  --output=<dir>\t\tDirectory of the corpus. Existing files are overwritten.\n";
+  std::cout << "  --posts=<n>\t\tNumber of posts. Defaults to 100.\n";
+  std::cout << "  --images=<n>\t\tNumber of master images. Defaults to the number of posts.\n";
+  std::cout << "  --seed=<n>\t\tSeed of the random generator. Defaults to 1.\n";
+  std::cout << "\n";
+}
+
+/// <summary>
+/// Parses a positive number argument. Returns false if the value is invalid.
+/// </summary>
+bool parse_count_argument(const std::string & value, size_t & count) {
+  if (value.empty())
+    return true;
+  if (!is_numeric(value.c_str()))
+    return false;
+  parse_value(value, count);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  Arguments args;
+
+  // Show usage if nothing is specified.
+  if (argc <= 1) {
+    show_usage();
+    return 1;
+  }
+
+  args.output_directory = find_argument("output", argc, argv);
+  args.posts = find_argument("posts", argc, argv);
+  args.images = find_argument("images", argc, argv);
+  args.seed = find_argument("seed", argc, argv);
+
+  if (args.output_directory.empty()) {
+    std::cout << "Error. Please specify --output=<dir> argument.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+
+  size_t seed = 1;
+  CorpusOptions options;
+  options.num_posts = 100;
+  if (!parse_count_argument(args.posts, options.num_posts) || !parse_count_argument(args.seed, seed)) {
+    std::cout << "Error. Invalid number of posts or seed.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  options.num_images = options.num_posts;
+  if (!parse_count_argument(args.images, options.num_images)) {
+    std::cout << "Error. Invalid number of images '" << args.images << "'.\n";
+    std::cout << "\n";
+    show_usage();
+    return 1;
+  }
+  options.seed = (unsigned int)seed;
+
+  std::cout << "Generating " << options.num_posts << " posts and " << options.num_images << " images in directory '" << args.output_directory << "'.\n";
+  CORPUS_INFO info;
+  std::string error;
+  if (!generate_corpus(args.output_directory, options, info, error)) {
+    std::cout << "Error. " << error << "\n";
+    return 4;
+  }
+
+  std::cout << "Generated " << info.num_posts << " posts (" << info.posts_size << " bytes) in '" << info.content_directory << "'.\n";
+  std::cout << "Generated " << info.num_images << " images in '" << info.wp_content_directory << "'.\n";
+
+	return 0;
+}
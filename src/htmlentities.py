@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# htmlentities.py : Generates htmlentities.h from the list of HTML5 named character references.
+#
+# Usage: python3 htmlentities.py > htmlentities.h
+#
+# The entities are stored in a minimal perfect hash table (hash and displace).
+# An entity name is looked up with:
+#   index = hash_entity_name(name, displacements[hash_entity_name(name, 0) % NUM_DISPLACEMENTS]) % NUM_HTML_ENTITIES
+# and the name stored at this index must be compared with the searched name.
+
+import html.entities
+import sys
+
+FNV_OFFSET_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+def hash_entity_name(name, seed):
+  h = (FNV_OFFSET_BASIS ^ seed) & 0xffffffff
+  for c in name.encode("ascii"):
+    h ^= c
+    h = (h * FNV_PRIME) & 0xffffffff
+  return h
+
+def main():
+  # Keep only the names terminated by a semicolon. The legacy names without a semicolon are not supported.
+  entities = {}
+  for name, value in html.entities.html5.items():
+    if name.endswith(";"):
+      entities[name[:-1]] = [ord(c) for c in value]
+  names = sorted(entities.keys())
+
+  num_entities = len(names)
+  num_displacements = (num_entities + 3) // 4
+
+  # Group the names by bucket and place the largest buckets first
+  buckets = [[] for i in range(num_displacements)]
+  for name in names:
+    buckets[hash_entity_name(name, 0) % num_displacements].append(name)
+  order = sorted(range(num_displacements), key=lambda i: (-len(buckets[i]), i))
+
+  displacements = [0] * num_displacements
+  slots = [None] * num_entities
+  for bucket_index in order:
+    bucket = buckets[bucket_index]
+    if not bucket:
+      continue
+    seed = 1
+    while True:
+      positions = [hash_entity_name(name, seed) % num_entities for name in bucket]
+      if len(set(positions)) == len(positions) and all(slots[p] is None for p in positions):
+        break
+      seed += 1
+    displacements[bucket_index] = seed
+    for name, p in zip(bucket, positions):
+      slots[p] = name
+
+  out = sys.stdout
+  out.write("// htmlentities.h : HTML5 named character references.\n")
+  out.write("// This file is generated by htmlentities.py. Do not edit.\n")
+  out.write("//\n")
+  out.write("\n")
+  out.write("#define NUM_HTML_ENTITIES %d\n" % num_entities)
+  out.write("#define NUM_HTML_ENTITY_DISPLACEMENTS %d\n" % num_displacements)
+  out.write("#define HTML_ENTITY_FNV_OFFSET_BASIS %du\n" % FNV_OFFSET_BASIS)
+  out.write("#define HTML_ENTITY_FNV_PRIME %du\n" % FNV_PRIME)
+  out.write("\n")
+  out.write("struct HTML_ENTITY {\n")
+  out.write("  const char * name;           // name of the entity without the leading '&' and the trailing ';'\n")
+  out.write("  unsigned int code_points[2]; // the second code point is 0 for most entities\n")
+  out.write("};\n")
+  out.write("\n")
+  out.write("static const unsigned short html_entity_displacements[NUM_HTML_ENTITY_DISPLACEMENTS] = {\n")
+  for i in range(0, num_displacements, 16):
+    out.write("  " + ", ".join("%d" % d for d in displacements[i:i+16]) + ",\n")
+  out.write("};\n")
+  out.write("\n")
+  out.write("static const HTML_ENTITY html_entities[NUM_HTML_ENTITIES] = {\n")
+  for name in slots:
+    code_points = entities[name] + [0]
+    out.write("  { \"%s\", { 0x%04X, 0x%04X } },\n" % (name, code_points[0], code_points[1]))
+  out.write("};\n")
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,90 @@
+#include "manifest.h"
+#include <fstream>
+#include <sstream>
+
+static const char * MANIFEST_HEADER = "filterhtml manifest 1";
+
+/// <summary>
+/// Returns the 64 bits FNV-1a hash of the given content.
+/// </summary>
+uint64_t hash_content(const char * content, size_t length) {
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i=0; i<length; i++) {
+    hash ^= (unsigned char)content[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/// <summary>
+/// Returns the path of the manifest of a directory. The manifest is stored next to the directory.
+/// For example, the manifest of "content/blog" is "content/blog.filterhtml.manifest".
+/// </summary>
+std::string get_manifest_path(const std::string & directory) {
+  std::string path = directory;
+  while (!path.empty() && (path[path.size()-1] == '\\' || path[path.size()-1] == '/'))
+    path.erase(path.size()-1, 1);
+  path += ".filterhtml.manifest";
+  return path;
+}
+
+/// <summary>
+/// Returns the path of a file relative to the given directory, if the file is in the directory.
+/// </summary>
+std::string get_manifest_key(const std::string & directory, const std::string & path) {
+  if (path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0) {
+    size_t offset = directory.size();
+    while (offset < path.size() && (path[offset] == '\\' || path[offset] == '/'))
+      offset++;
+    return path.substr(offset);
+  }
+  return path;
+}
+
+/// <summary>
+/// Loads a manifest saved with to_manifest_content().
+/// Returns false if the manifest does not exist or is not a valid manifest.
+/// </summary>
+bool load_manifest(const std::string & path, Manifest & manifest) {
+  manifest.settings.clear();
+  manifest.entries.clear();
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  std::string line;
+  if (!std::getline(file, line) || line != MANIFEST_HEADER)
+    return false;
+  if (!std::getline(file, line) || line.compare(0, 9, "settings ") != 0)
+    return false;
+  manifest.settings = line.substr(9);
+
+  // Each entry is written as: <input hash> <output hash> <path>
+  while (std::getline(file, line)) {
+    if (line.empty())
+      continue;
+    std::istringstream input_stream(line);
+    MANIFEST_ENTRY entry;
+    if (!(input_stream >> std::hex >> entry.input_hash >> entry.output_hash))
+      return false;
+    std::string key;
+    std::getline(input_stream >> std::ws, key);
+    if (key.empty())
+      return false;
+    manifest.entries[key] = entry;
+  }
+
+  return true;
+}
+
+std::string to_manifest_content(const Manifest & manifest) {
+  std::ostringstream output;
+  output << MANIFEST_HEADER << "\n";
+  output << "settings " << manifest.settings << "\n";
+  output << std::hex;
+  for(std::map<std::string, MANIFEST_ENTRY>::const_iterator it = manifest.entries.begin(); it != manifest.entries.end(); ++it) {
+    output << it->second.input_hash << " " << it->second.output_hash << " " << it->first << "\n";
+  }
+  return output.str();
+}
@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <map>
+
+// The conversion of a file recorded in a manifest.
+struct MANIFEST_ENTRY {
+  uint64_t input_hash;  // hash of the file before the conversion
+  uint64_t output_hash; // hash of the converted file
+};
+
+// The files converted by a previous run, indexed by their path relative to the converted directory.
+// The settings identify the version of the filters and the options that produced the converted files.
+// Entries are meaningless if the settings have changed.
+struct Manifest {
+  std::string settings;
+  std::map<std::string, MANIFEST_ENTRY> entries;
+};
+
+// declarations
+uint64_t hash_content(const char * content, size_t length);
+std::string get_manifest_path(const std::string & directory);
+std::string get_manifest_key(const std::string & directory, const std::string & path);
+bool load_manifest(const std::string & path, Manifest & manifest);
+std::string to_manifest_content(const Manifest & manifest);
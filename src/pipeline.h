@@ -0,0 +1,82 @@
+#include <stddef.h>
+#include <initializer_list>
+#include <utility>      // std::index_sequence
+#include <type_traits>  // std::is_same
+
+// A list of filter types, in the order in which the filters run.
+// Each filter type provides:
+//   static const char * name();
+//   static size_t run(std::string & content);  // returns the number of replacements
+//   typedef FilterList<...> RunsAfter;         // filters that must run before this filter if they are in the same list
+template <typename... Filters>
+struct FilterList {};
+
+static constexpr size_t FILTER_NOT_FOUND = (size_t)-1;
+
+// The index of a filter in a list of filters, or FILTER_NOT_FOUND.
+template <typename Filter, typename... Filters>
+struct FilterIndex {
+  static constexpr size_t value = FILTER_NOT_FOUND;
+};
+
+template <typename Filter, typename First, typename... Others>
+struct FilterIndex<Filter, First, Others...> {
+  static constexpr size_t next = FilterIndex<Filter, Others...>::value;
+  static constexpr size_t value = (std::is_same<Filter, First>::value ? 0 : (next == FILTER_NOT_FOUND ? FILTER_NOT_FOUND : next + 1));
+};
+
+// The concatenation of lists of filters.
+template <typename... Lists>
+struct ConcatFilterLists {
+  typedef FilterList<> type;
+};
+
+template <typename... Filters>
+struct ConcatFilterLists<FilterList<Filters...> > {
+  typedef FilterList<Filters...> type;
+};
+
+template <typename... Filters1, typename... Filters2, typename... Lists>
+struct ConcatFilterLists<FilterList<Filters1...>, FilterList<Filters2...>, Lists...> {
+  typedef typename ConcatFilterLists<FilterList<Filters1..., Filters2...>, Lists...>::type type;
+};
+
+constexpr bool all_true(std::initializer_list<bool> values) {
+  for(const bool * value = values.begin(); value != values.end(); value++) {
+    if (!*value)
+      return false;
+  }
+  return true;
+}
+
+// True if the dependencies of the filter at the given index of the list are before the filter, or not in the list.
+template <typename List, size_t index, typename Dependencies>
+struct IsFilterOrdered;
+
+template <typename... Filters, size_t index, typename... Dependencies>
+struct IsFilterOrdered<FilterList<Filters...>, index, FilterList<Dependencies...> > {
+  static constexpr bool value = all_true({ true, (FilterIndex<Dependencies, Filters...>::value == FILTER_NOT_FOUND || FilterIndex<Dependencies, Filters...>::value < index)... });
+};
+
+template <typename... Filters, size_t... Indices>
+constexpr bool is_filter_list_ordered(FilterList<Filters...>, std::index_sequence<Indices...>) {
+  return all_true({ true, IsFilterOrdered<FilterList<Filters...>, Indices, typename Filters::RunsAfter>::value... });
+}
+
+/// <summary>
+/// Returns true if all filters of the list run after the filters they depend on.
+/// </summary>
+template <typename... Filters>
+constexpr bool is_filter_list_ordered(FilterList<Filters...> list) {
+  return is_filter_list_ordered(list, std::index_sequence_for<Filters...>());
+}
+
+/// <summary>
+/// Calls function(Filter()) for each filter of the list, in order. Returns the sum of the results.
+/// </summary>
+template <typename... Filters, typename Function>
+inline size_t run_filter_list(FilterList<Filters...>, [[maybe_unused]] Function function) {
+  size_t count = 0;
+  (void)std::initializer_list<int>{ 0, (count += function(Filters()), 0)... };
+  return count;
+}
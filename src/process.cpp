@@ -0,0 +1,104 @@
+#include "process.h"
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Runs a program and waits for its completion. The output of the program is discarded.
+/// Returns false if the program cannot be started.
+/// </summary>
+bool run_process(const std::vector<std::string> & command, PROCESS_STATISTICS & statistics) {
+  statistics.exit_code = -1;
+  statistics.seconds = 0.0;
+  statistics.peak_memory = 0;
+  if (command.empty())
+    return false;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+  std::string command_line;
+  for(size_t i=0; i<command.size(); i++) {
+    if (i > 0)
+      command_line += " ";
+    command_line += "\"" + command[i] + "\"";
+  }
+
+  SECURITY_ATTRIBUTES security_attributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+  HANDLE null_handle = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &security_attributes, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  STARTUPINFOA startup_info;
+  ZeroMemory(&startup_info, sizeof(startup_info));
+  startup_info.cb = sizeof(startup_info);
+  startup_info.dwFlags = STARTF_USESTDHANDLES;
+  startup_info.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+  startup_info.hStdOutput = null_handle;
+  startup_info.hStdError = null_handle;
+
+  PROCESS_INFORMATION process_information;
+  ZeroMemory(&process_information, sizeof(process_information));
+  BOOL created = CreateProcessA(NULL, &command_line[0], NULL, NULL, TRUE, 0, NULL, NULL, &startup_info, &process_information);
+  if (null_handle != INVALID_HANDLE_VALUE)
+    CloseHandle(null_handle);
+  if (!created)
+    return false;
+
+  WaitForSingleObject(process_information.hProcess, INFINITE);
+
+  DWORD exit_code = 0;
+  GetExitCodeProcess(process_information.hProcess, &exit_code);
+  statistics.exit_code = (int)exit_code;
+
+  PROCESS_MEMORY_COUNTERS memory_counters;
+  if (K32GetProcessMemoryInfo(process_information.hProcess, &memory_counters, sizeof(memory_counters)))
+    statistics.peak_memory = memory_counters.PeakWorkingSetSize;
+
+  CloseHandle(process_information.hThread);
+  CloseHandle(process_information.hProcess);
+#else
+  std::vector<char *> arguments;
+  for(size_t i=0; i<command.size(); i++)
+    arguments.push_back(const_cast<char *>(command[i].c_str()));
+  arguments.push_back(NULL);
+
+  pid_t pid = fork();
+  if (pid == -1)
+    return false;
+  if (pid == 0) {
+    int null_descriptor = open("/dev/null", O_WRONLY);
+    if (null_descriptor != -1) {
+      dup2(null_descriptor, STDOUT_FILENO);
+      dup2(null_descriptor, STDERR_FILENO);
+      close(null_descriptor);
+    }
+    execv(arguments[0], &arguments[0]);
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) == -1)
+    return false;
+  statistics.exit_code = (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+  statistics.peak_memory = (size_t)usage.ru_maxrss * 1024; // in kilobytes on linux
+#endif
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  statistics.seconds = std::chrono::duration<double>(end - start).count();
+  return true;
+}
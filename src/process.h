@@ -0,0 +1,13 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// The measurements of a process.
+struct PROCESS_STATISTICS {
+  int exit_code;
+  double seconds;
+  size_t peak_memory;   // peak resident set size, in bytes
+};
+
+// declarations
+bool run_process(const std::vector<std::string> & command, PROCESS_STATISTICS & statistics);
@@ -0,0 +1,163 @@
+#include "profiler.h"
+#include <chrono>
+#include <atomic>
+#include <sstream>
+#include <iomanip>      // std::setw
+#include <algorithm>    // std::max
+
+static const std::chrono::steady_clock::time_point profile_start_time = std::chrono::steady_clock::now();
+static std::atomic<size_t> next_thread_index(0);
+static thread_local size_t thread_index = next_thread_index++;
+
+// The profile of the file processed by the current thread.
+static thread_local Profile * current_profile = NULL;
+
+int64_t get_profile_time() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profile_start_time).count();
+}
+
+size_t get_thread_index() {
+  return thread_index;
+}
+
+Profile * get_profile() {
+  return current_profile;
+}
+
+/// <summary>
+/// Set the profile where the statistics of the current thread are recorded. Use NULL to disable profiling.
+/// </summary>
+void set_profile(Profile * profile) {
+  current_profile = profile;
+}
+
+void init_profile(Profile & profile, bool trace) {
+  profile.filters.clear();
+  profile.events.clear();
+  profile.trace = trace;
+}
+
+void add_filter_sample(Profile & profile, const char * name, size_t pass, int64_t start, int64_t end, size_t replacements) {
+  FILTER_STATISTICS & statistics = profile.filters[FILTER_PASS(name, pass)];
+  statistics.calls++;
+  statistics.replacements += replacements;
+  statistics.duration += end - start;
+
+  add_trace_event(profile, name, "filter", start, end);
+}
+
+void add_trace_event(Profile & profile, const std::string & name, const char * category, int64_t start, int64_t end) {
+  if (!profile.trace)
+    return;
+  TRACE_EVENT event = { name, category, start, end - start, get_thread_index() };
+  profile.events.push_back(event);
+}
+
+void merge_profile(Profile & total, const Profile & profile) {
+  for(std::map<FILTER_PASS, FILTER_STATISTICS>::const_iterator it = profile.filters.begin(); it != profile.filters.end(); ++it) {
+    FILTER_STATISTICS & statistics = total.filters[it->first];
+    statistics.calls += it->second.calls;
+    statistics.replacements += it->second.replacements;
+    statistics.duration += it->second.duration;
+  }
+  total.events.insert(total.events.end(), profile.events.begin(), profile.events.end());
+}
+
+ProfileScope::ProfileScope(const std::string & name, const char * category) : name(name), category(category), start(0) {
+  if (current_profile != NULL)
+    start = get_profile_time();
+}
+
+ProfileScope::~ProfileScope() {
+  if (current_profile != NULL)
+    add_trace_event(*current_profile, name, category, start, get_profile_time());
+}
+
+inline std::string to_milliseconds(int64_t duration) {
+  std::ostringstream output;
+  output << std::fixed << std::setprecision(3) << (double)duration / 1000000.0;
+  return output.str();
+}
+
+/// <summary>
+/// Returns a table of the statistics of each filter, followed by a table of the statistics of each pass.
+/// </summary>
+std::string to_profile_table(const Profile & profile, size_t num_files) {
+  std::map<std::string, FILTER_STATISTICS> filters;
+  std::map<size_t, FILTER_STATISTICS> passes;
+  int64_t total_duration = 0;
+  for(std::map<FILTER_PASS, FILTER_STATISTICS>::const_iterator it = profile.filters.begin(); it != profile.filters.end(); ++it) {
+    const FILTER_STATISTICS & sample = it->second;
+
+    FILTER_STATISTICS & filter = filters[it->first.first];
+    filter.calls += sample.calls;
+    filter.replacements += sample.replacements;
+    filter.duration += sample.duration;
+
+    // The number of calls of a pass is the number of files that reached the pass
+    FILTER_STATISTICS & pass = passes[it->first.second];
+    pass.calls = std::max(pass.calls, sample.calls);
+    pass.replacements += sample.replacements;
+    pass.duration += sample.duration;
+
+    total_duration += sample.duration;
+  }
+
+  std::ostringstream output;
+  output << "Profile of " << num_files << " files:\n";
+  output << std::left << std::setw(40) << "Filter" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Replacements" << std::setw(14) << "Time (ms)" << std::setw(8) << "%" << "\n";
+  for(std::map<std::string, FILTER_STATISTICS>::const_iterator it = filters.begin(); it != filters.end(); ++it) {
+    const FILTER_STATISTICS & filter = it->second;
+    double percent = (total_duration > 0 ? 100.0 * (double)filter.duration / (double)total_duration : 0.0);
+    output << std::left << std::setw(40) << it->first << std::right << std::setw(10) << filter.calls << std::setw(14) << filter.replacements << std::setw(14) << to_milliseconds(filter.duration);
+    output << std::setw(8) << std::fixed << std::setprecision(1) << percent << "\n";
+  }
+  output << std::left << std::setw(40) << "Total" << std::right << std::setw(10) << "" << std::setw(14) << "" << std::setw(14) << to_milliseconds(total_duration) << "\n";
+  output << "\n";
+
+  output << std::left << std::setw(40) << "Pass" << std::right << std::setw(10) << "Files" << std::setw(14) << "Replacements" << std::setw(14) << "Time (ms)" << "\n";
+  for(std::map<size_t, FILTER_STATISTICS>::const_iterator it = passes.begin(); it != passes.end(); ++it) {
+    const FILTER_STATISTICS & pass = it->second;
+    std::string name = (it->first == 0 ? std::string("single run filters") : "pass " + std::to_string(it->first));
+    output << std::left << std::setw(40) << name << std::right << std::setw(10) << pass.calls << std::setw(14) << pass.replacements << std::setw(14) << to_milliseconds(pass.duration) << "\n";
+  }
+
+  return output.str();
+}
+
+inline std::string to_json_string(const std::string & value) {
+  std::ostringstream output;
+  output << '"';
+  for(size_t i=0; i<value.size(); i++) {
+    char c = value[i];
+    if (c == '"' || c == '\\')
+      output << '\\' << c;
+    else if ((unsigned char)c < 0x20)
+      output << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+    else
+      output << c;
+  }
+  output << '"';
+  return output.str();
+}
+
+/// <summary>
+/// Returns the trace events of the profile in the Chrome trace event format.
+/// The file can be opened with chrome://tracing or https://ui.perfetto.dev.
+/// </summary>
+std::string to_trace_json(const Profile & profile) {
+  std::ostringstream output;
+  output << "{\"traceEvents\":[\n";
+  for(size_t i=0; i<profile.events.size(); i++) {
+    const TRACE_EVENT & event = profile.events[i];
+    output << "{\"name\":" << to_json_string(event.name) << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\"";
+    output << std::fixed << std::setprecision(3);
+    output << ",\"ts\":" << (double)event.start / 1000.0 << ",\"dur\":" << (double)event.duration / 1000.0;
+    output << ",\"pid\":1,\"tid\":" << event.thread_index << "}";
+    if (i + 1 < profile.events.size())
+      output << ",";
+    output << "\n";
+  }
+  output << "]}\n";
+  return output.str();
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>      // std::pair
+
+// Statistics of a filter.
+struct FILTER_STATISTICS {
+  size_t calls;
+  size_t replacements;
+  int64_t duration;     // in nanoseconds
+};
+
+// A span of a Chrome trace event file.
+struct TRACE_EVENT {
+  std::string name;
+  const char * category;
+  int64_t start;        // in nanoseconds since the start of the program
+  int64_t duration;     // in nanoseconds
+  size_t thread_index;
+};
+
+// Statistics of filters, indexed by filter name and pass number.
+// Filters that do not run in passes are recorded as pass 0.
+typedef std::pair<std::string, size_t> FILTER_PASS;
+
+struct Profile {
+  std::map<FILTER_PASS, FILTER_STATISTICS> filters;
+  std::vector<TRACE_EVENT> events; // recorded only if trace is true
+  bool trace;
+};
+
+// Records a trace event for the lifetime of the scope, if the current thread has a profile.
+struct ProfileScope {
+  ProfileScope(const std::string & name, const char * category);
+  ~ProfileScope();
+
+  std::string name;
+  const char * category;
+  int64_t start;
+};
+
+// declarations
+int64_t get_profile_time();
+size_t get_thread_index();
+Profile * get_profile();
+void set_profile(Profile * profile);
+void init_profile(Profile & profile, bool trace);
+void add_filter_sample(Profile & profile, const char * name, size_t pass, int64_t start, int64_t end, size_t replacements);
+void add_trace_event(Profile & profile, const std::string & name, const char * category, int64_t start, int64_t end);
+void merge_profile(Profile & total, const Profile & profile);
+std::string to_profile_table(const Profile & profile, size_t num_files);
+std::string to_trace_json(const Profile & profile);
@@ -0,0 +1,415 @@
+#include "scan.h"
+#include <string>
+#include <string.h>
+
+// The SSE2 and AVX2 kernels are only available on x86-64. Other platforms use the scalar kernels.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCAN_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Allows AVX2 functions to be compiled without enabling AVX2 for the whole program.
+#if defined(__GNUC__) || defined(__clang__)
+#define SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCAN_TARGET_AVX2
+#endif
+
+// Maximum number of characters searched with SIMD by scan_for_any(). Longer sets are searched with the scalar kernel.
+static const size_t SCAN_MAX_SIMD_CHARACTERS = 8;
+
+const unsigned char scan_character_classes[256] = {
+  0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x00
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x10
+  0x1C, 0x00, 0x10, 0x20, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04, 0x10,  // 0x20
+  0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,  // 0x30
+  0x00, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26,  // 0x40
+  0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x50
+  0x00, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26,  // 0x60
+  0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x70
+  // 0x80 to 0xFF are not classified
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+/// <summary>
+/// Returns the level of the kernels used by the scan functions. Defaults to the best level supported by the cpu.
+/// </summary>
+static SCAN_LEVEL & get_selected_scan_level() {
+  static SCAN_LEVEL level = get_best_scan_level();
+  return level;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Scalar kernels
+//------------------------------------------------------------------------------------------------------------
+
+static size_t find_any_scalar(const char * data, size_t length, size_t offset, const char * characters, size_t num_characters) {
+  for(size_t pos = offset; pos < length; pos++) {
+    for(size_t i=0; i<num_characters; i++) {
+      if (data[pos] == characters[i])
+        return pos;
+    }
+  }
+  return std::string::npos;
+}
+
+static size_t find_nonwhite_scalar(const char * data, size_t length, size_t offset) {
+  for(size_t pos = offset; pos < length; pos++) {
+    if (!has_character_class(data[pos], SCAN_CLASS_WHITE))
+      return pos;
+  }
+  return std::string::npos;
+}
+
+static size_t count_scalar(const char * data, size_t length, char character) {
+  size_t count = 0;
+  for(size_t i=0; i<length; i++) {
+    if (data[i] == character)
+      count++;
+  }
+  return count;
+}
+
+static size_t find_non_ascii_scalar(const char * data, size_t length, size_t offset) {
+  for(size_t pos = offset; pos < length; pos++) {
+    if ((unsigned char)data[pos] >= 0x80)
+      return pos;
+  }
+  return std::string::npos;
+}
+
+#ifdef SCAN_X86_KERNELS
+
+/// <summary>
+/// Returns the index of the lowest bit set in a non-zero mask.
+/// </summary>
+static inline unsigned int get_first_bit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+static bool is_avx2_supported() {
+#ifdef _MSC_VER
+  int info[4] = {0};
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx)
+    return false;
+  // The operating system must save the ymm registers
+  if ((_xgetbv(0) & 0x6) != 0x6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------
+// SSE2 kernels
+//------------------------------------------------------------------------------------------------------------
+
+static size_t find_any_sse2(const char * data, size_t length, size_t offset, const char * characters, size_t num_characters) {
+  __m128i needles[SCAN_MAX_SIMD_CHARACTERS];
+  for(size_t i=0; i<num_characters; i++)
+    needles[i] = _mm_set1_epi8(characters[i]);
+
+  size_t pos = offset;
+  while (pos + 16 <= length) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + pos));
+    __m128i matches = _mm_cmpeq_epi8(block, needles[0]);
+    for(size_t i=1; i<num_characters; i++)
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, needles[i]));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(matches);
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 16;
+  }
+  return find_any_scalar(data, length, pos, characters, num_characters);
+}
+
+static size_t find_nonwhite_sse2(const char * data, size_t length, size_t offset) {
+  const __m128i spaces = _mm_set1_epi8(' ');
+  const __m128i tabs = _mm_set1_epi8('\t');
+  const __m128i newlines = _mm_set1_epi8('\n');
+
+  size_t pos = offset;
+  while (pos + 16 <= length) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + pos));
+    __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, spaces), _mm_cmpeq_epi8(block, tabs)), _mm_cmpeq_epi8(block, newlines));
+    unsigned int mask = ~(unsigned int)_mm_movemask_epi8(white) & 0xFFFF;
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 16;
+  }
+  return find_nonwhite_scalar(data, length, pos);
+}
+
+static size_t count_sse2(const char * data, size_t length, char character) {
+  const __m128i needle = _mm_set1_epi8(character);
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos + 16 <= length) {
+    // Each byte of the accumulator counts up to 255 matches before it must be summed.
+    __m128i accumulator = zero;
+    for(size_t i=0; i<255 && pos + 16 <= length; i++) {
+      __m128i block = _mm_loadu_si128((const __m128i *)(data + pos));
+      accumulator = _mm_sub_epi8(accumulator, _mm_cmpeq_epi8(block, needle));
+      pos += 16;
+    }
+    __m128i sums = _mm_sad_epu8(accumulator, zero);
+    count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+  }
+  return count + count_scalar(data + pos, length - pos, character);
+}
+
+static size_t find_non_ascii_sse2(const char * data, size_t length, size_t offset) {
+  size_t pos = offset;
+  while (pos + 16 <= length) {
+    // The mask holds the high bit of each byte
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + pos));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(block);
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 16;
+  }
+  return find_non_ascii_scalar(data, length, pos);
+}
+
+//------------------------------------------------------------------------------------------------------------
+// AVX2 kernels
+//------------------------------------------------------------------------------------------------------------
+
+SCAN_TARGET_AVX2 static size_t find_any_avx2(const char * data, size_t length, size_t offset, const char * characters, size_t num_characters) {
+  __m256i needles[SCAN_MAX_SIMD_CHARACTERS];
+  for(size_t i=0; i<num_characters; i++)
+    needles[i] = _mm256_set1_epi8(characters[i]);
+
+  size_t pos = offset;
+  while (pos + 32 <= length) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + pos));
+    __m256i matches = _mm256_cmpeq_epi8(block, needles[0]);
+    for(size_t i=1; i<num_characters; i++)
+      matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, needles[i]));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(matches);
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 32;
+  }
+  return find_any_sse2(data, length, pos, characters, num_characters);
+}
+
+SCAN_TARGET_AVX2 static size_t find_nonwhite_avx2(const char * data, size_t length, size_t offset) {
+  const __m256i spaces = _mm256_set1_epi8(' ');
+  const __m256i tabs = _mm256_set1_epi8('\t');
+  const __m256i newlines = _mm256_set1_epi8('\n');
+
+  size_t pos = offset;
+  while (pos + 32 <= length) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + pos));
+    __m256i white = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, spaces), _mm256_cmpeq_epi8(block, tabs)), _mm256_cmpeq_epi8(block, newlines));
+    unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(white);
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 32;
+  }
+  return find_nonwhite_sse2(data, length, pos);
+}
+
+SCAN_TARGET_AVX2 static size_t count_avx2(const char * data, size_t length, char character) {
+  const __m256i needle = _mm256_set1_epi8(character);
+  const __m256i zero = _mm256_setzero_si256();
+
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos + 32 <= length) {
+    // Each byte of the accumulator counts up to 255 matches before it must be summed.
+    __m256i accumulator = zero;
+    for(size_t i=0; i<255 && pos + 32 <= length; i++) {
+      __m256i block = _mm256_loadu_si256((const __m256i *)(data + pos));
+      accumulator = _mm256_sub_epi8(accumulator, _mm256_cmpeq_epi8(block, needle));
+      pos += 32;
+    }
+    __m256i sums = _mm256_sad_epu8(accumulator, zero);
+    count += (size_t)_mm256_extract_epi64(sums, 0) + (size_t)_mm256_extract_epi64(sums, 1);
+    count += (size_t)_mm256_extract_epi64(sums, 2) + (size_t)_mm256_extract_epi64(sums, 3);
+  }
+  return count + count_sse2(data + pos, length - pos, character);
+}
+
+SCAN_TARGET_AVX2 static size_t find_non_ascii_avx2(const char * data, size_t length, size_t offset) {
+  size_t pos = offset;
+  while (pos + 32 <= length) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + pos));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(block);
+    if (mask != 0)
+      return pos + get_first_bit(mask);
+    pos += 32;
+  }
+  return find_non_ascii_sse2(data, length, pos);
+}
+
+#endif // SCAN_X86_KERNELS
+
+SCAN_LEVEL get_best_scan_level() {
+#ifdef SCAN_X86_KERNELS
+  if (is_avx2_supported())
+    return SCAN_LEVEL_AVX2;
+  return SCAN_LEVEL_SSE2;
+#else
+  return SCAN_LEVEL_SCALAR;
+#endif
+}
+
+SCAN_LEVEL get_scan_level() {
+  return get_selected_scan_level();
+}
+
+/// <summary>
+/// Select the kernels used by the scan functions. Must be called before any thread is started.
+/// Returns false if the level is not supported by the cpu.
+/// </summary>
+bool set_scan_level(SCAN_LEVEL level) {
+  if (level > get_best_scan_level())
+    return false;
+  get_selected_scan_level() = level;
+  return true;
+}
+
+const char * get_scan_level_name(SCAN_LEVEL level) {
+  switch(level) {
+  case SCAN_LEVEL_SCALAR:
+    return "scalar";
+  case SCAN_LEVEL_SSE2:
+    return "sse2";
+  case SCAN_LEVEL_AVX2:
+    return "avx2";
+  };
+  return "unknown";
+}
+
+/// <summary>
+/// Parses the name of a scan level. The name 'auto' selects the best level supported by the cpu.
+/// </summary>
+bool parse_scan_level(const char * name, SCAN_LEVEL & level) {
+  if (strcmp(name, "auto") == 0)
+    level = get_best_scan_level();
+  else if (strcmp(name, "scalar") == 0)
+    level = SCAN_LEVEL_SCALAR;
+  else if (strcmp(name, "sse2") == 0)
+    level = SCAN_LEVEL_SSE2;
+  else if (strcmp(name, "avx2") == 0)
+    level = SCAN_LEVEL_AVX2;
+  else
+    return false;
+  return true;
+}
+
+/// <summary>
+/// Search for a character in a buffer. The C library already vectorizes this search.
+/// </summary>
+size_t scan_for_character(const char * data, size_t length, size_t offset, char character) {
+  if (offset >= length)
+    return std::string::npos;
+  const char * found = (const char *)memchr(data + offset, character, length - offset);
+  if (found == NULL)
+    return std::string::npos;
+  return (size_t)(found - data);
+}
+
+/// <summary>
+/// Search for the first occurrence of any of the given characters in a buffer.
+/// </summary>
+size_t scan_for_any(const char * data, size_t length, size_t offset, const char * characters, size_t num_characters) {
+  if (offset >= length || num_characters == 0)
+    return std::string::npos;
+  if (num_characters == 1)
+    return scan_for_character(data, length, offset, characters[0]);
+#ifdef SCAN_X86_KERNELS
+  if (num_characters <= SCAN_MAX_SIMD_CHARACTERS) {
+    switch(get_selected_scan_level()) {
+    case SCAN_LEVEL_AVX2:
+      return find_any_avx2(data, length, offset, characters, num_characters);
+    case SCAN_LEVEL_SSE2:
+      return find_any_sse2(data, length, offset, characters, num_characters);
+    default:
+      break;
+    };
+  }
+#endif
+  return find_any_scalar(data, length, offset, characters, num_characters);
+}
+
+/// <summary>
+/// Search for the first character which is not a space, a tab or a line feed.
+/// </summary>
+size_t scan_for_nonwhite(const char * data, size_t length, size_t offset) {
+  if (offset >= length)
+    return std::string::npos;
+#ifdef SCAN_X86_KERNELS
+  switch(get_selected_scan_level()) {
+  case SCAN_LEVEL_AVX2:
+    return find_nonwhite_avx2(data, length, offset);
+  case SCAN_LEVEL_SSE2:
+    return find_nonwhite_sse2(data, length, offset);
+  default:
+    break;
+  };
+#endif
+  return find_nonwhite_scalar(data, length, offset);
+}
+
+/// <summary>
+/// Count the occurrences of a character in a buffer.
+/// </summary>
+size_t scan_count_character(const char * data, size_t length, char character) {
+#ifdef SCAN_X86_KERNELS
+  switch(get_selected_scan_level()) {
+  case SCAN_LEVEL_AVX2:
+    return count_avx2(data, length, character);
+  case SCAN_LEVEL_SSE2:
+    return count_sse2(data, length, character);
+  default:
+    break;
+  };
+#endif
+  return count_scalar(data, length, character);
+}
+
+/// <summary>
+/// Search for the first byte which is not an ASCII character, that is the first byte of a multi-byte utf-8 sequence.
+/// </summary>
+size_t scan_for_non_ascii(const char * data, size_t length, size_t offset) {
+  if (offset >= length)
+    return std::string::npos;
+#ifdef SCAN_X86_KERNELS
+  switch(get_selected_scan_level()) {
+  case SCAN_LEVEL_AVX2:
+    return find_non_ascii_avx2(data, length, offset);
+  case SCAN_LEVEL_SSE2:
+    return find_non_ascii_sse2(data, length, offset);
+  default:
+    break;
+  };
+#endif
+  return find_non_ascii_scalar(data, length, offset);
+}
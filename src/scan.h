@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stddef.h>
+
+// Instruction sets of the scanning kernels.
+enum SCAN_LEVEL {
+  SCAN_LEVEL_SCALAR,
+  SCAN_LEVEL_SSE2,
+  SCAN_LEVEL_AVX2
+};
+
+// Classes of characters, see has_character_class().
+#define SCAN_CLASS_DIGIT          0x01  // 0-9
+#define SCAN_CLASS_LETTER         0x02  // a-z, A-Z
+#define SCAN_CLASS_TEXT           0x04  // letters, digits, space, dot and comma
+#define SCAN_CLASS_WHITE          0x08  // space, tab and line feed
+#define SCAN_CLASS_TAG_NAME_END   0x10  // characters which end the name of an html tag
+#define SCAN_CLASS_ENTITY_NAME    0x20  // letters, digits and '#'
+
+extern const unsigned char scan_character_classes[256];
+
+// Returns true if the character belongs to one of the given classes.
+inline bool has_character_class(char c, unsigned char classes) {
+  return (scan_character_classes[(unsigned char)c] & classes) != 0;
+}
+
+// declarations
+SCAN_LEVEL get_best_scan_level();
+SCAN_LEVEL get_scan_level();
+bool set_scan_level(SCAN_LEVEL level);
+const char * get_scan_level_name(SCAN_LEVEL level);
+bool parse_scan_level(const char * name, SCAN_LEVEL & level);
+size_t scan_for_character(const char * data, size_t length, size_t offset, char character);
+size_t scan_for_any(const char * data, size_t length, size_t offset, const char * characters, size_t num_characters);
+size_t scan_for_nonwhite(const char * data, size_t length, size_t offset);
+size_t scan_count_character(const char * data, size_t length, char character);
+size_t scan_for_non_ascii(const char * data, size_t length, size_t offset);
@@ -0,0 +1,181 @@
+#include "site.h"
+#include "utils.h"
+#include <vector>
+#include <algorithm>    // std::sort
+
+/// <summary>
+/// Remove the spaces, tabs and carriage returns at the beginning and the end of a text.
+/// </summary>
+static void trim_blanks(std::string & text) {
+  size_t start = text.find_first_not_of(" \t\r");
+  if (start == std::string::npos) {
+    text.clear();
+    return;
+  }
+  size_t end = text.find_last_not_of(" \t\r");
+  text = text.substr(start, end - start + 1);
+}
+
+/// <summary>
+/// Returns the profile of www.end2endzone.com.
+/// </summary>
+static SiteProfile get_default_site_profile() {
+  SiteProfile profile;
+  init_default_site_profile(profile);
+  return profile;
+}
+
+/// <summary>
+/// Returns the profile selected with set_site_profile(). Defaults to the profile of www.end2endzone.com.
+/// The default profile is initialized once, even if the first call comes from several worker threads at the same time.
+/// </summary>
+static SiteProfile & get_selected_site_profile() {
+  static SiteProfile profile = get_default_site_profile();
+  return profile;
+}
+
+/// <summary>
+/// Initialize the profile of www.end2endzone.com, the site for which the filters were written.
+/// </summary>
+void init_default_site_profile(SiteProfile & profile) {
+  profile.hostname = "http://www.end2endzone.com";
+  profile.custom_css_classes.clear();
+  profile.custom_css_classes.insert("pleasenote");
+  profile.custom_css_classes.insert("postedit");
+  profile.custom_css_classes.insert("renamep");
+  profile.languages.clear();
+  profile.languages["default"] = "";
+  profile.languages["c++"] = "cpp";
+  profile.utf8 = true;
+}
+
+/// <summary>
+/// Load a site profile file. Each line is a 'key=value' pair. Empty lines and lines starting with '#' are ignored.
+/// Keys are:
+///   hostname=<url>                 Hostname removed from the urls of the code files.
+///   encoding=<utf-8|cp1252>        Encoding of the posts. Defaults to utf-8.
+///   custom-css-class=<name>        A custom css class. Repeat the key for each class.
+///   language=<crayon>:<hugo>       Rename a Crayon language for hugo. Repeat the key for each language.
+/// Returns false and describes the error if the file cannot be loaded or if a line is invalid.
+/// </summary>
+bool load_site_profile(const std::string & path, SiteProfile & profile, std::string & error) {
+  std::string content;
+  if (!load_file(path, content, error))
+    return false;
+
+  profile.hostname.clear();
+  profile.custom_css_classes.clear();
+  profile.languages.clear();
+  profile.utf8 = true;
+
+  std::vector<std::string> lines = split(content, '\n');
+  for(size_t i=0; i<lines.size(); i++) {
+    std::string line = lines[i];
+    trim_blanks(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    size_t separator = line.find('=');
+    if (separator == std::string::npos) {
+      error = "Invalid line " + to_string(i + 1) + " in site profile '" + path + "'. Expected 'key=value'.";
+      return false;
+    }
+    std::string key = line.substr(0, separator);
+    std::string value = line.substr(separator + 1);
+    trim_blanks(key);
+    trim_blanks(value);
+
+    if (key == "hostname") {
+      profile.hostname = value;
+    } else if (key == "encoding") {
+      if (value == "utf-8")
+        profile.utf8 = true;
+      else if (value == "cp1252")
+        profile.utf8 = false;
+      else {
+        error = "Unknown encoding '" + value + "' at line " + to_string(i + 1) + " in site profile '" + path + "'.";
+        return false;
+      }
+    } else if (key == "custom-css-class") {
+      if (!value.empty())
+        profile.custom_css_classes.insert(value);
+    } else if (key == "language") {
+      size_t colon = value.find(':');
+      if (colon == std::string::npos || colon == 0) {
+        error = "Invalid language '" + value + "' at line " + to_string(i + 1) + " in site profile '" + path + "'. Expected '<crayon>:<hugo>'.";
+        return false;
+      }
+      profile.languages[value.substr(0, colon)] = value.substr(colon + 1);
+    } else {
+      error = "Unknown key '" + key + "' at line " + to_string(i + 1) + " in site profile '" + path + "'.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/// <summary>
+/// Returns the values of the profile in a stable order, to detect changes of the profile between runs.
+/// </summary>
+std::string get_site_profile_settings(const SiteProfile & profile) {
+  std::vector<std::string> classes(profile.custom_css_classes.begin(), profile.custom_css_classes.end());
+  std::sort(classes.begin(), classes.end());
+  std::vector<std::string> languages;
+  for(std::unordered_map<std::string, std::string>::const_iterator it = profile.languages.begin(); it != profile.languages.end(); ++it)
+    languages.push_back(it->first + ":" + it->second);
+  std::sort(languages.begin(), languages.end());
+
+  std::string settings;
+  settings += profile.hostname;
+  settings += (profile.utf8 ? ";utf-8;" : ";cp1252;");
+  settings += join(classes, ',');
+  settings += ";";
+  settings += join(languages, ',');
+  return settings;
+}
+
+const SiteProfile & get_site_profile() {
+  return get_selected_site_profile();
+}
+
+/// <summary>
+/// Select the profile used by the filters. Must be called before any thread is started.
+/// </summary>
+void set_site_profile(const SiteProfile & profile) {
+  get_selected_site_profile() = profile;
+  set_utf8_source(profile.utf8);
+}
+
+/// <summary>
+/// Returns true if one of the space-separated classes of a class attribute is a custom css class of the site.
+/// </summary>
+bool has_custom_css_class(const SiteProfile & profile, std::string_view class_value) {
+  if (profile.custom_css_classes.empty())
+    return false;
+
+  std::string class_name;
+  size_t start = 0;
+  while (start < class_value.size()) {
+    size_t end = class_value.find_first_of(" \t\n", start);
+    if (end == std::string::npos)
+      end = class_value.size();
+    if (end > start) {
+      class_name.assign(class_value, start, end - start);
+      if (profile.custom_css_classes.find(class_name) != profile.custom_css_classes.end())
+        return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+/// <summary>
+/// Returns the hugo name of a Crayon language. Languages that are not renamed by the profile are returned unchanged.
+/// </summary>
+std::string get_site_language(const SiteProfile & profile, const std::string & language) {
+  std::unordered_map<std::string, std::string>::const_iterator it = profile.languages.find(language);
+  if (it == profile.languages.end())
+    return language;
+  return it->second;
+}
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+
+// The values of the filters which depend on the migrated wordpress site.
+struct SiteProfile {
+  std::string hostname;                                   // removed from the urls of the code files of Crayon blocks
+  std::unordered_set<std::string> custom_css_classes;     // paragraphs with one of these classes are wrapped in a shortcode
+  std::unordered_map<std::string, std::string> languages; // Crayon language names which are renamed for hugo
+  bool utf8;                                              // false if the posts are encoded in Windows-1252 or ISO-8859-1
+};
+
+// declarations
+void init_default_site_profile(SiteProfile & profile);
+bool load_site_profile(const std::string & path, SiteProfile & profile, std::string & error);
+std::string get_site_profile_settings(const SiteProfile & profile);
+const SiteProfile & get_site_profile();
+void set_site_profile(const SiteProfile & profile);
+bool has_custom_css_class(const SiteProfile & profile, std::string_view class_value);
+std::string get_site_language(const SiteProfile & profile, const std::string & language);
@@ -0,0 +1,84 @@
+#include "threadpool.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// The tasks assigned to a worker thread.
+// The worker takes its tasks from the front of the queue. Idle workers steal tasks from the back of the queues of other workers.
+struct WORK_QUEUE {
+  std::mutex mutex;
+  std::deque<size_t> tasks;
+};
+
+size_t get_processor_count() {
+  size_t count = std::thread::hardware_concurrency();
+  if (count == 0)
+    return 1;
+  return count;
+}
+
+bool pop_front_task(WORK_QUEUE & queue, size_t & task) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty())
+    return false;
+  task = queue.tasks.front();
+  queue.tasks.pop_front();
+  return true;
+}
+
+bool pop_back_task(WORK_QUEUE & queue, size_t & task) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty())
+    return false;
+  task = queue.tasks.back();
+  queue.tasks.pop_back();
+  return true;
+}
+
+void run_worker(std::vector<WORK_QUEUE> & queues, size_t worker_index, const TASK_FUNCTION & function) {
+  size_t task = 0;
+  while (true) {
+    bool found = pop_front_task(queues[worker_index], task);
+
+    // Steal a task from another worker
+    for(size_t i=1; !found && i<queues.size(); i++) {
+      found = pop_back_task(queues[(worker_index + i) % queues.size()], task);
+    }
+
+    // No task is ever added to the queues. All the tasks are started.
+    if (!found)
+      return;
+
+    function(task);
+  }
+}
+
+/// <summary>
+/// Runs the given tasks on a pool of worker threads and returns once all tasks are completed.
+/// Tasks are started approximately in the given order: the first tasks are dealt first to each worker.
+/// If num_threads is 1, the tasks are run sequentially on the calling thread.
+/// </summary>
+void run_tasks(const std::vector<size_t> & tasks, size_t num_threads, const TASK_FUNCTION & function) {
+  if (num_threads > tasks.size())
+    num_threads = tasks.size();
+  if (num_threads <= 1) {
+    for(size_t i=0; i<tasks.size(); i++) {
+      function(tasks[i]);
+    }
+    return;
+  }
+
+  // Deal the tasks to the workers
+  std::vector<WORK_QUEUE> queues(num_threads);
+  for(size_t i=0; i<tasks.size(); i++) {
+    queues[i % num_threads].tasks.push_back(tasks[i]);
+  }
+
+  std::vector<std::thread> threads;
+  for(size_t i=0; i<num_threads; i++) {
+    threads.push_back(std::thread(run_worker, std::ref(queues), i, std::cref(function)));
+  }
+  for(size_t i=0; i<threads.size(); i++) {
+    threads[i].join();
+  }
+}
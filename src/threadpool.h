@@ -0,0 +1,10 @@
+#include <stdio.h>
+#include <vector>
+#include <functional>   // std::function
+
+// A function which processes the task identified by the given index.
+typedef std::function<void(size_t task_index)> TASK_FUNCTION;
+
+// declarations
+size_t get_processor_count();
+void run_tasks(const std::vector<size_t> & tasks, size_t num_threads, const TASK_FUNCTION & function);
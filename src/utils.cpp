@@ -1,31 +1,117 @@
 #include "utils.h"
+#include "htmlentities.h"
+#include "scan.h"
+#include <atomic>
+
+#ifdef _WIN32
 #include <direct.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#endif
 
 #ifdef _WIN32
 // warning C4996: 'chdir': The POSIX name for this item is deprecated. Instead, use the ISO C++ conformant name: _chdir. See online help for details.
 #pragma warning(disable : 4996)
 #endif
 
-static bool is_utf8_source = true; //change this to false if you are parsing from Windows code page 1252 (Cp1252) or from ISO8859-1 character encoding
+// Stream where the messages about the processing of a file are written. Each thread can redirect its own messages.
+static thread_local std::ostream * log_stream = NULL;
+
+// The upstream of the pool of file arenas. Counts the memory which is allocated from the heap.
+class FileArenaUpstream : public std::pmr::memory_resource {
+public:
+  size_t allocated = 0;
+
+private:
+  void * do_allocate(size_t bytes, size_t alignment) override {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void * p, size_t bytes, size_t alignment) override {
+    allocated -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// The file arenas of a thread. The first block of the arena of a scope is reused by the next scopes,
+// so that the files of a directory are converted with few heap allocations for the temporaries of the filters.
+// The larger blocks of a scope are given back to the heap when the scope ends.
+struct FileArena {
+  FileArenaUpstream upstream;
+  std::optional<std::pmr::unsynchronized_pool_resource> pool; // created by the first scope of the thread
+  std::pmr::memory_resource * resource = NULL; // arena of the innermost FileArenaScope
+};
+
+static const size_t FILE_ARENA_BLOCK_SIZE = 1024*1024;  // first block of the arena of a scope. The next blocks are not kept by the pool.
+static const size_t FILE_ARENA_MAX_SIZE = 8*1024*1024;  // memory kept by the pool of a thread between two files
+
+static thread_local FileArena file_arena;
+
+static std::pmr::memory_resource * get_file_arena_pool() {
+  if (!file_arena.pool) {
+    std::pmr::pool_options options;
+    options.max_blocks_per_chunk = 1;
+    options.largest_required_pool_block = FILE_ARENA_BLOCK_SIZE;
+    file_arena.pool.emplace(options, &file_arena.upstream);
+  }
+  return &file_arena.pool.value();
+}
+
+static bool is_utf8_source = true; // false if parsing from Windows code page 1252 (Cp1252) or from ISO8859-1 character encoding. See set_utf8_source().
 
 static const char html_tag_endding_characters[] = { ' ', '/', '\"', '\'', '>', '\0' };
 static const size_t num_html_tag_endding_characters = sizeof(html_tag_endding_characters) / sizeof(html_tag_endding_characters[0]);
 
+FileArenaScope::FileArenaScope() : block(get_file_arena_pool()->allocate(FILE_ARENA_BLOCK_SIZE)), resource(block, FILE_ARENA_BLOCK_SIZE, get_file_arena_pool()) {
+  parent = file_arena.resource;
+  file_arena.resource = &resource;
+}
+
+FileArenaScope::~FileArenaScope() {
+  resource.release();
+  file_arena.pool->deallocate(block, FILE_ARENA_BLOCK_SIZE);
+  file_arena.resource = parent;
+
+  // Do not keep the blocks of deeply nested scopes for the next files
+  if (parent == NULL && file_arena.upstream.allocated > FILE_ARENA_MAX_SIZE)
+    file_arena.pool->release();
+}
+
+std::pmr::memory_resource * get_file_arena() {
+  if (file_arena.resource)
+    return file_arena.resource;
+  return std::pmr::new_delete_resource();
+}
+
 bool is_digit(const char c) {
-  return (c >= '0' && c <= '9');
+  return has_character_class(c, SCAN_CLASS_DIGIT);
 }
 
 bool is_letter(const char c) {
-  return (  (c >= 'a' && c <= 'z') ||
-            (c >= 'A' && c <= 'Z')  );
+  return has_character_class(c, SCAN_CLASS_LETTER);
 }
 
 bool is_alphanumeric(const char c) {
-  return (is_digit(c) || is_letter(c));
+  return has_character_class(c, SCAN_CLASS_DIGIT|SCAN_CLASS_LETTER);
 }
 
 bool is_text(const char c) {
-  return (is_alphanumeric(c) || c == ' ' || c == '.' || c == ',' );
+  return has_character_class(c, SCAN_CLASS_TEXT);
 }
 
 bool is_numeric(const char * value) {
@@ -57,13 +143,7 @@ bool is_numeric(const char * value) {
 }
 
 size_t count_character(const char * text, char character) {
-  size_t count = 0;
-  while(text[0] != '\0') {
-    if (text[0] == character)
-      count++;
-    text++;
-  }
-  return count;
+  return scan_count_character(text, strlen(text), character);
 }
 
 size_t get_line_indentation(const char * content, size_t offset) {
@@ -79,97 +159,211 @@ size_t get_line_indentation(const char * content, size_t offset) {
   return indent;
 }
 
-size_t string_length_utf8(const char * text) {
+/// <summary>
+/// Decodes the utf-8 sequence at the start of the text.
+/// Returns the size in bytes of the sequence, or 0 if the sequence is not well-formed.
+/// </summary>
+static size_t decode_utf8(const unsigned char * text, size_t length, unsigned int & code_point) {
   // from https://raw.githubusercontent.com/end2endzone/RapidAssist/master/src/rapidassist/unicode.cpp
 
-  size_t code_points = 0;
-
-  const unsigned char * unsigned_str = (const unsigned char *)text;
-  int offset = 0;
-  while (text[offset] != '\0')
-  {
-    const unsigned char & c1 = unsigned_str[offset + 0];
-    unsigned char c2 = unsigned_str[offset + 1];
-    unsigned char c3 = unsigned_str[offset + 2];
-    unsigned char c4 = unsigned_str[offset + 3];
-    
-    //prevent going outside of the string
-    if (c1 == '\0')
-      c2 = c3 = c4 = '\0';
-    else if (c2 == '\0')
-      c3 = c4 = '\0';
-    else if (c3 == '\0')
-      c4 = '\0';
-
-    //size in bytes of the code point
-    int n = 1;
-
-    //See http://www.unicode.org/versions/Unicode6.0.0/ch03.pdf, Table 3-7. Well-Formed UTF-8 Byte Sequences
-    // ## | Code Points         | First Byte | Second Byte | Third Byte | Fourth Byte
-    // #1 | U+0000   - U+007F   | 00 - 7F    |             |            | 
-    // #2 | U+0080   - U+07FF   | C2 - DF    | 80 - BF     |            | 
-    // #3 | U+0800   - U+0FFF   | E0         | A0 - BF     | 80 - BF    | 
-    // #4 | U+1000   - U+CFFF   | E1 - EC    | 80 - BF     | 80 - BF    | 
-    // #5 | U+D000   - U+D7FF   | ED         | 80 - 9F     | 80 - BF    | 
-    // #6 | U+E000   - U+FFFF   | EE - EF    | 80 - BF     | 80 - BF    | 
-    // #7 | U+10000  - U+3FFFF  | F0         | 90 - BF     | 80 - BF    | 80 - BF
-    // #8 | U+40000  - U+FFFFF  | F1 - F3    | 80 - BF     | 80 - BF    | 80 - BF
-    // #9 | U+100000 - U+10FFFF | F4         | 80 - 8F     | 80 - BF    | 80 - BF
-
-    if (c1 <= 0x7F) // #1 | U+0000   - U+007F, (ASCII)
-      n = 1;
-    else if ( 0xC2 <= c1 && c1 <= 0xDF &&
-              0x80 <= c2 && c2 <= 0xBF)  // #2 | U+0080   - U+07FF
-      n = 2;
-    else if ( 0xE0 == c1 &&
+  //prevent going outside of the string
+  unsigned char c1 = text[0];
+  unsigned char c2 = (length > 1 ? text[1] : 0);
+  unsigned char c3 = (length > 2 ? text[2] : 0);
+  unsigned char c4 = (length > 3 ? text[3] : 0);
+
+  //See http://www.unicode.org/versions/Unicode6.0.0/ch03.pdf, Table 3-7. Well-Formed UTF-8 Byte Sequences
+  // ## | Code Points         | First Byte | Second Byte | Third Byte | Fourth Byte
+  // #1 | U+0000   - U+007F   | 00 - 7F    |             |            | 
+  // #2 | U+0080   - U+07FF   | C2 - DF    | 80 - BF     |            | 
+  // #3 | U+0800   - U+0FFF   | E0         | A0 - BF     | 80 - BF    | 
+  // #4 | U+1000   - U+CFFF   | E1 - EC    | 80 - BF     | 80 - BF    | 
+  // #5 | U+D000   - U+D7FF   | ED         | 80 - 9F     | 80 - BF    | 
+  // #6 | U+E000   - U+FFFF   | EE - EF    | 80 - BF     | 80 - BF    | 
+  // #7 | U+10000  - U+3FFFF  | F0         | 90 - BF     | 80 - BF    | 80 - BF
+  // #8 | U+40000  - U+FFFFF  | F1 - F3    | 80 - BF     | 80 - BF    | 80 - BF
+  // #9 | U+100000 - U+10FFFF | F4         | 80 - 8F     | 80 - BF    | 80 - BF
+
+  if (c1 <= 0x7F) { // #1 | U+0000   - U+007F, (ASCII)
+    code_point = c1;
+    return 1;
+  } else if ( 0xC2 <= c1 && c1 <= 0xDF &&
+              0x80 <= c2 && c2 <= 0xBF) { // #2 | U+0080   - U+07FF
+    code_point = ((c1 & 0x1F) << 6) | (c2 & 0x3F);
+    return 2;
+  } else if ((0xE0 == c1 &&
               0xA0 <= c2 && c2 <= 0xBF &&
-              0x80 <= c3 && c3 <= 0xBF)  // #3 | U+0800   - U+0FFF
-      n = 3;
-    else if ( 0xE1 <= c1 && c1 <= 0xEC &&
+              0x80 <= c3 && c3 <= 0xBF) || // #3 | U+0800   - U+0FFF
+             (0xE1 <= c1 && c1 <= 0xEC &&
               0x80 <= c2 && c2 <= 0xBF &&
-              0x80 <= c3 && c3 <= 0xBF)  // #4 | U+1000   - U+CFFF
-      n = 3;
-    else if ( 0xED == c1 &&
+              0x80 <= c3 && c3 <= 0xBF) || // #4 | U+1000   - U+CFFF
+             (0xED == c1 &&
               0x80 <= c2 && c2 <= 0x9F &&
-              0x80 <= c3 && c3 <= 0xBF)  // #5 | U+D000   - U+D7FF
-      n = 3;
-    else if ( 0xEE <= c1 && c1 <= 0xEF &&
+              0x80 <= c3 && c3 <= 0xBF) || // #5 | U+D000   - U+D7FF
+             (0xEE <= c1 && c1 <= 0xEF &&
               0x80 <= c2 && c2 <= 0xBF &&
-              0x80 <= c3 && c3 <= 0xBF)  // #6 | U+E000   - U+FFFF
-      n = 3;
-    else if ( 0xF0 == c1 &&
+              0x80 <= c3 && c3 <= 0xBF)) { // #6 | U+E000   - U+FFFF
+    code_point = ((c1 & 0x0F) << 12) | ((c2 & 0x3F) << 6) | (c3 & 0x3F);
+    return 3;
+  } else if ((0xF0 == c1 &&
               0x90 <= c2 && c2 <= 0xBF &&
               0x80 <= c3 && c3 <= 0xBF &&
-              0x80 <= c4 && c4 <= 0xBF)  // #7 | U+10000  - U+3FFFF
-      n = 4;
-    else if ( 0xF1 <= c1 && c1 <= 0xF3 &&
+              0x80 <= c4 && c4 <= 0xBF) || // #7 | U+10000  - U+3FFFF
+             (0xF1 <= c1 && c1 <= 0xF3 &&
               0x80 <= c2 && c2 <= 0xBF &&
               0x80 <= c3 && c3 <= 0xBF &&
-              0x80 <= c4 && c4 <= 0xBF)  // #8 | U+40000  - U+FFFFF
-      n = 4;
-    else if ( 0xF4 == c1 &&
-              0x80 <= c2 && c2 <= 0xBF &&
+              0x80 <= c4 && c4 <= 0xBF) || // #8 | U+40000  - U+FFFFF
+             (0xF4 == c1 &&
+              0x80 <= c2 && c2 <= 0x8F &&
               0x80 <= c3 && c3 <= 0xBF &&
-              0x80 <= c4 && c4 <= 0xBF)  // #7 | U+10000  - U+3FFFF
-      n = 4;
-    else
-      return 0; // invalid UTF-8 sequence
+              0x80 <= c4 && c4 <= 0xBF)) { // #9 | U+100000 - U+10FFFF
+    code_point = ((c1 & 0x07) << 18) | ((c2 & 0x3F) << 12) | ((c3 & 0x3F) << 6) | (c4 & 0x3F);
+    return 4;
+  }
 
-    code_points++;
+  return 0; // invalid UTF-8 sequence
+}
 
-    //next code point
-    offset += n;
+/// <summary>
+/// Returns the number of code points of an utf-8 string.
+/// Each byte of an invalid sequence counts as one code point, like a Cp1252 character.
+/// </summary>
+size_t string_length_utf8(const char * text, size_t length) {
+  const unsigned char * unsigned_str = (const unsigned char *)text;
+  size_t code_points = 0;
+  size_t offset = 0;
+  while (offset < length) {
+    // count the ascii characters at once
+    size_t next = scan_for_non_ascii(text, length, offset);
+    if (next == std::string::npos)
+      return code_points + (length - offset);
+    code_points += next - offset;
+
+    unsigned int code_point = 0;
+    size_t n = decode_utf8(unsigned_str + next, length - next, code_point);
+    code_points++;
+    offset = next + (n == 0 ? 1 : n);
   }
   return code_points;
 }
+
+size_t string_length_utf8(const char * text) {
+  return string_length_utf8(text, strlen(text));
+}
+
 size_t string_length_utf8(const std::string & text) {
-  return string_length_utf8(text.c_str());
+  return string_length_utf8(text.c_str(), text.size());
+}
+
+// A range of unicode code points.
+struct CODE_POINT_RANGE {
+  unsigned int first;
+  unsigned int last;
+};
+
+// Combining marks, zero width spaces and joiners, direction marks and variation selectors.
+static const CODE_POINT_RANGE zero_width_code_points[] = {
+  { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF }, { 0x05C1, 0x05C2 },
+  { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A }, { 0x064B, 0x065F }, { 0x0670, 0x0670 },
+  { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 }, { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0902 },
+  { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 },
+  { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF },
+  { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0x302A, 0x302D },
+  { 0x3099, 0x309A }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0xE0100, 0xE01EF },
+};
+static const size_t num_zero_width_code_points = sizeof(zero_width_code_points) / sizeof(zero_width_code_points[0]);
+
+// East asian wide and fullwidth characters, and emoji, which use two columns of a terminal.
+static const CODE_POINT_RANGE wide_code_points[] = {
+  { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC }, { 0x23F0, 0x23F0 },
+  { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 }, { 0x2648, 0x2653 }, { 0x267F, 0x267F },
+  { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 }, { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 },
+  { 0x26CE, 0x26CE }, { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+  { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B }, { 0x2728, 0x2728 },
+  { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 }, { 0x2757, 0x2757 }, { 0x2795, 0x2797 },
+  { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF }, { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 },
+  { 0x2E80, 0x3029 }, { 0x302E, 0x303E }, { 0x3041, 0x3098 }, { 0x309B, 0x33FF }, { 0x3400, 0x4DBF },
+  { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF }, { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF },
+  { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x1F004, 0x1F004 },
+  { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F64F },
+  { 0x1F680, 0x1F6FF }, { 0x1F900, 0x1F9FF }, { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD },
+};
+static const size_t num_wide_code_points = sizeof(wide_code_points) / sizeof(wide_code_points[0]);
+
+/// <summary>
+/// Returns true if the code point is in one of the sorted ranges.
+/// </summary>
+static bool is_code_point_in_ranges(unsigned int code_point, const CODE_POINT_RANGE * ranges, size_t num_ranges) {
+  if (code_point < ranges[0].first || code_point > ranges[num_ranges - 1].last)
+    return false;
+  size_t low = 0;
+  size_t high = num_ranges;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (code_point < ranges[middle].first)
+      high = middle;
+    else if (code_point > ranges[middle].last)
+      low = middle + 1;
+    else
+      return true;
+  }
+  return false;
+}
+
+/// <summary>
+/// Returns the number of terminal columns used by a code point: 0, 1 or 2.
+/// </summary>
+static size_t get_code_point_width(unsigned int code_point) {
+  if (is_code_point_in_ranges(code_point, zero_width_code_points, num_zero_width_code_points))
+    return 0;
+  if (is_code_point_in_ranges(code_point, wide_code_points, num_wide_code_points))
+    return 2;
+  return 1;
+}
+
+/// <summary>
+/// Returns the number of terminal columns used by an utf-8 string.
+/// Wide east asian characters use two columns and combining marks use none.
+/// Each byte of an invalid sequence uses one column, like a Cp1252 character.
+/// </summary>
+size_t string_display_width_utf8(const char * text, size_t length) {
+  const unsigned char * unsigned_str = (const unsigned char *)text;
+  size_t width = 0;
+  size_t offset = 0;
+  while (offset < length) {
+    // ascii characters use one column each
+    size_t next = scan_for_non_ascii(text, length, offset);
+    if (next == std::string::npos)
+      return width + (length - offset);
+    width += next - offset;
+
+    unsigned int code_point = 0;
+    size_t n = decode_utf8(unsigned_str + next, length - next, code_point);
+    if (n == 0) {
+      width++;
+      offset = next + 1;
+    } else {
+      width += get_code_point_width(code_point);
+      offset = next + n;
+    }
+  }
+  return width;
 }
 
-size_t string_length(const std::string & text) {
+/// <summary>
+/// Set the encoding of the posts. Use false for Windows code page 1252 (Cp1252) or ISO8859-1.
+/// </summary>
+void set_utf8_source(bool utf8) {
+  is_utf8_source = utf8;
+}
+
+/// <summary>
+/// Returns the number of columns used by the text when the markdown is displayed with a fixed-width font.
+/// </summary>
+size_t string_length(std::string_view text) {
   size_t length = 0;
   if (is_utf8_source)
-    length = string_length_utf8(text);
+    length = string_display_width_utf8(text.data(), text.size());
   else
     length = text.size();
   return length;
@@ -182,10 +376,12 @@ std::string string_center(const std::string & text, size_t length) {
   if (length % 2 == 1)
     length++;
 
-  while(string_length(output) < length) {
-    // insert a space on the left and right of the text
-    output.insert(0, 1, ' ');
-    output.append(1, ' ');
+  // insert the same number of spaces on the left and right of the text
+  size_t text_length = string_length(text);
+  if (text_length < length) {
+    size_t num_spaces = (length - text_length + 1) / 2;
+    output.insert(0, num_spaces, ' ');
+    output.append(num_spaces, ' ');
   }
 
   return output;
@@ -202,6 +398,15 @@ std::string string_lengthen(const std::string & text, size_t length) {
   return output;
 }
 
+/// <summary>
+/// Appends the text followed by spaces up to the given length. Same as appending string_lengthen().
+/// </summary>
+inline void append_lengthened(std::string & output, std::string_view text, size_t text_length, size_t length) {
+  output.append(text);
+  if (text_length < length)
+    output.append(length - text_length, ' ');
+}
+
 size_t get_table_column_count(const HtmlTable & table) {
   size_t columns = 0;
   for(size_t i=0; i<table.rows.size(); i++) {
@@ -212,13 +417,31 @@ size_t get_table_column_count(const HtmlTable & table) {
   return columns;
 }
 
+/// <summary>
+/// Returns the display width of a cell, without its surrounding html whitespace.
+/// The widths of all the cells are computed once and cached on the table.
+/// </summary>
+size_t get_table_cell_width(const HtmlTable & table, size_t row_index, size_t column_index) {
+  if (table.widths.size() != table.rows.size()) {
+    table.widths.clear();
+    table.widths.reserve(table.rows.size());
+    for(size_t i=0; i<table.rows.size(); i++) {
+      const HtmlTableRow & row = table.rows[i];
+      table.widths.emplace_back(row.size(), 0);
+      HtmlTableRowWidths & row_widths = table.widths.back();
+      for(size_t j=0; j<row.size(); j++)
+        row_widths[j] = string_length(trim_html_whitespace_view(row[j]));
+    }
+  }
+  return table.widths[row_index][column_index];
+}
+
 size_t get_table_column_width(const HtmlTable & table, size_t column_index) {
   size_t width = std::string::npos;
   for(size_t i=0; i<table.rows.size(); i++) {
     const HtmlTableRow & row = table.rows[i];
     if (column_index < row.size()) {
-      const HtmlTableCell & cell = row[column_index];
-      size_t cell_width = string_length(cell);
+      size_t cell_width = get_table_cell_width(table, i, column_index);
       if (width == std::string::npos || width < cell_width) {
         width = cell_width;
       }
@@ -258,32 +481,16 @@ std::string to_markdown(const HtmlTable & table) {
     }
   }
 
-  // create a first dummy header, may not be always required
-  HtmlTableRow dummy;
-  for(size_t i=0; i<num_columns; i++) {
-    dummy.push_back(empty_header_cell_content);
-  }
-
-  // select header row for the header
-  const HtmlTableRow * header = NULL;
-  size_t first_data_row_index = std::string::npos;
-  if (!table.first_row_is_header) {
-    header = &dummy;
-    first_data_row_index = 0;
-  } else {
-    header = &(table.rows[0]);
-    first_data_row_index = 1;
-  }
-
-  // print header
+  // print header, either the first row or a dummy header with empty cells
   for(size_t i=0; i<num_columns; i++) {
     const size_t & width = columns_width[i];
     markdown.append("| ");
-    HtmlTableCell cell;
-    if (i < header->size())
-      cell = (*header)[i];
-    trim_html_whitespace(cell);
-    markdown.append(string_lengthen(cell, width));
+    if (!table.first_row_is_header)
+      append_lengthened(markdown, empty_header_cell_content, empty_header_cell_content_length, width);
+    else if (i < table.rows[0].size())
+      append_lengthened(markdown, trim_html_whitespace_view(table.rows[0][i]), get_table_cell_width(table, 0, i), width);
+    else
+      append_lengthened(markdown, std::string_view(), 0, width);
     markdown.append(" ");
   }
   markdown.append("|\n");
@@ -292,23 +499,22 @@ std::string to_markdown(const HtmlTable & table) {
   for(size_t i=0; i<num_columns; i++) {
     const size_t & width = columns_width[i];
     markdown.append("|-");
-    std::string dashes(width, '-');
-    markdown.append(dashes);
+    markdown.append(width, '-');
     markdown.append("-");
   }
   markdown.append("|\n");
 
   // print data rows
+  size_t first_data_row_index = (table.first_row_is_header ? 1 : 0);
   for(size_t i=first_data_row_index; i<table.rows.size(); i++) {
     const HtmlTableRow & row = table.rows[i];
     for(size_t j=0; j<num_columns; j++) {
       const size_t & width = columns_width[j];
-      HtmlTableCell cell;
-      if (j < row.size())
-        cell = row[j];
-      trim_html_whitespace(cell);
       markdown.append("| ");
-      markdown.append(string_lengthen(cell, width));
+      if (j < row.size())
+        append_lengthened(markdown, trim_html_whitespace_view(row[j]), get_table_cell_width(table, i, j), width);
+      else
+        append_lengthened(markdown, std::string_view(), 0, width);
       markdown.append(" ");
     }
     markdown.append("|\n");
@@ -317,86 +523,525 @@ std::string to_markdown(const HtmlTable & table) {
   return markdown;
 }
 
-EOL_TYPE normalize_newlines(std::string & content) {
-  size_t lf_count = count_character(content.c_str(), '\n');
-  size_t cr_count = count_character(content.c_str(), '\r');
-
-  // compute how many os specific newline there are.
-  size_t unix_newline     = lf_count-cr_count;
-  size_t windows_newline  = cr_count;
-
+/// <summary>
+/// Returns the most used newline of a document and logs it.
+/// </summary>
+static EOL_TYPE get_eol_type(size_t unix_newline, size_t windows_newline) {
   EOL_TYPE eol_type = EOL_TYPE_UNIX;
 
   if (unix_newline > 0 && windows_newline == 0) {
-    printf("The document uses unix EOL.\n");
+    get_log_stream() << "The document uses unix EOL.\n";
     eol_type = EOL_TYPE_UNIX;
   }
   else if (windows_newline > 0 && unix_newline == 0) {
-    printf("The document uses windows EOL.\n");
+    get_log_stream() << "The document uses windows EOL.\n";
     eol_type = EOL_TYPE_WINDOWS;
   }
   else if (unix_newline >= windows_newline) {
-    printf("The document uses unix EOL (mostly).\n");
+    get_log_stream() << "The document uses unix EOL (mostly).\n";
     eol_type = EOL_TYPE_UNIX;
   }
   else if (windows_newline >= unix_newline) {
-    printf("The document uses windows EOL (mostly).\n");
+    get_log_stream() << "The document uses windows EOL (mostly).\n";
     eol_type = EOL_TYPE_WINDOWS;
   }
 
+  return eol_type;
+}
+
+/// <summary>
+/// Copies a document to content with unix newlines, in a single pass. Returns the newline used by the document.
+/// The text between carriage returns is copied at once. Carriage returns which are not followed by a line feed are kept.
+/// </summary>
+EOL_TYPE normalize_newlines(const char * data, size_t size, std::string & content) {
+  content.clear();
+  content.reserve(size);
+
+  size_t windows_newline = 0;
+  size_t offset = 0;
+  size_t cr_pos = scan_for_character(data, size, 0, '\r');
+  while (cr_pos != std::string::npos) {
+    if (cr_pos + 1 < size && data[cr_pos + 1] == '\n') {
+      content.append(data + offset, cr_pos - offset);
+      offset = cr_pos + 1;
+      windows_newline++;
+    }
+    cr_pos = scan_for_character(data, size, cr_pos + 1, '\r');
+  }
+  content.append(data + offset, size - offset);
+
   // Force unix newlines while processing.
+  size_t unix_newline = scan_count_character(data, size, '\n') - windows_newline;
+  return get_eol_type(unix_newline, windows_newline);
+}
 
-  // Remove window newlines in the document
-  search_and_replace(content, "\r\n", "\n");
+/// <summary>
+/// Replaces the windows newlines of the content by unix newlines, in a single pass.
+/// Returns the number of newlines replaced.
+/// </summary>
+static size_t remove_windows_newlines(std::string & content) {
+  char * data = &content[0];
+  size_t size = content.size();
+  size_t count = 0;
+  size_t write_pos = std::string::npos;
+  size_t cr_pos = scan_for_character(data, size, 0, '\r');
+  while (cr_pos != std::string::npos) {
+    size_t next_cr_pos = scan_for_character(data, size, cr_pos + 1, '\r');
+    if (cr_pos + 1 < size && data[cr_pos + 1] == '\n') {
+      // move the text up to the next carriage return over the carriage return
+      size_t chunk_end = (next_cr_pos == std::string::npos ? size : next_cr_pos);
+      if (write_pos == std::string::npos)
+        write_pos = cr_pos;
+      memmove(data + write_pos, data + cr_pos + 1, chunk_end - cr_pos - 1);
+      write_pos += chunk_end - cr_pos - 1;
+      count++;
+    } else if (write_pos != std::string::npos) {
+      // keep the lone carriage return and the text up to the next one
+      size_t chunk_end = (next_cr_pos == std::string::npos ? size : next_cr_pos);
+      memmove(data + write_pos, data + cr_pos, chunk_end - cr_pos);
+      write_pos += chunk_end - cr_pos;
+    }
+    cr_pos = next_cr_pos;
+  }
+  if (write_pos != std::string::npos)
+    content.resize(write_pos);
+  return count;
+}
 
-  return eol_type;
+EOL_TYPE normalize_newlines(std::string & content) {
+  size_t lf_count = count_character(content.c_str(), '\n');
+  size_t windows_newline = remove_windows_newlines(content);
+  return get_eol_type(lf_count - windows_newline, windows_newline);
 }
 
+/// <summary>
+/// Converts the newlines of a document processed with unix newlines back to the given type, in a single pass.
+/// </summary>
 void restore_newlines(std::string & content, EOL_TYPE eol_type) {
   switch (eol_type) {
   case EOL_TYPE_UNIX:
     // keep unix newlines
     // remove window newlines in the document.
-    search_and_replace(content, "\r\n", "\n");
+    remove_windows_newlines(content);
     break;
   case EOL_TYPE_WINDOWS:
-    // keep window newlines
-    // remove unix newline in the document.
-    search_and_replace(content, "\n", "\r\n");
-    search_and_replace(content, "\r\r\n", "\r\n");
+    {
+      // keep window newlines
+      // insert a carriage return before the line feeds that do not have one.
+      const char * data = content.data();
+      size_t size = content.size();
+      std::string output;
+      output.reserve(size + scan_count_character(data, size, '\n'));
+      size_t offset = 0;
+      size_t lf_pos = scan_for_character(data, size, 0, '\n');
+      while (lf_pos != std::string::npos) {
+        output.append(data + offset, lf_pos - offset);
+        if (lf_pos == 0 || data[lf_pos - 1] != '\r')
+          output.append(1, '\r');
+        offset = lf_pos;
+        lf_pos = scan_for_character(data, size, lf_pos + 1, '\n');
+      }
+      output.append(data + offset, size - offset);
+      content.swap(output);
+    }
     break;
   default:
-    printf("Warning: unknown EOL type: %d\n", eol_type);
+    get_log_stream() << "Warning: unknown EOL type: " << eol_type << "\n";
   };
 }
 
-void search_and_replace(std::string & content, const std::string & token, const std::string & value) {
+size_t find_in_buffer(const char * content, size_t length, char character, size_t offset) {
+  if (offset >= length)
+    return std::string::npos;
+  const char * found = (const char *)memchr(content + offset, character, length - offset);
+  if (found == NULL)
+    return std::string::npos;
+  return (size_t)(found - content);
+}
+
+size_t find_in_buffer(const char * content, size_t length, std::string_view pattern, size_t offset) {
+  if (pattern.empty() || pattern.size() > length)
+    return std::string::npos;
+
+  size_t last = length - pattern.size();
+  size_t pos = find_in_buffer(content, length, pattern[0], offset);
+  while (pos != std::string::npos && pos <= last) {
+    if (memcmp(content + pos, pattern.data(), pattern.size()) == 0)
+      return pos;
+    pos = find_in_buffer(content, length, pattern[0], pos + 1);
+  }
+  return std::string::npos;
+}
+
+/// <summary>
+/// Search for a pattern in a buffer, ignoring the case of ascii letters.
+/// </summary>
+size_t find_in_buffer_no_case(const char * content, size_t length, std::string_view pattern, size_t offset) {
+  if (pattern.empty() || pattern.size() > length)
+    return std::string::npos;
+
+  // Candidates start with the lower or upper case of the first character of the pattern
+  char first_characters[] = { (char)tolower((unsigned char)pattern[0]), (char)toupper((unsigned char)pattern[0]) };
+  size_t num_first_characters = (first_characters[0] == first_characters[1] ? 1 : 2);
+
+  size_t last = length - pattern.size();
+  size_t pos = scan_for_any(content, last + 1, offset, first_characters, num_first_characters);
+  while (pos != std::string::npos) {
+    size_t i = 1;
+    while (i < pattern.size() && toupper((unsigned char)content[pos + i]) == toupper((unsigned char)pattern[i]))
+      i++;
+    if (i == pattern.size())
+      return pos;
+    pos = scan_for_any(content, last + 1, pos + 1, first_characters, num_first_characters);
+  }
+  return std::string::npos;
+}
+
+void search_and_replace(std::string & content, std::string_view token, std::string_view value) {
   if (token.empty())
     return;
 
+  PieceTable document;
+  init_piece_table(document, content);
+
   size_t pos = content.find(token, 0);
   while (pos != std::string::npos) {
-    content.replace(content.begin() + pos, content.begin() + pos + token.size(), value);
+    replace_piece(document, pos, pos + token.size(), value);
 
     // next tag
-    pos = content.find(token, pos + value.size());
+    pos = content.find(token, pos + token.size());
   }
+
+  flatten_piece_table(document, content);
 }
 
-std::string load_file(const std::string & path) {
-  std::ifstream file(path, std::ios::binary | std::ios::ate);
-  size_t size = (size_t)file.tellg();
-  file.seekg(0, std::ios::beg);
+void append_utf8(std::string & output, unsigned int code_point) {
+  if (code_point < 0x80) {
+    output += (char)code_point;
+  } else if (code_point < 0x800) {
+    output += (char)(0xC0 | (code_point >> 6));
+    output += (char)(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    output += (char)(0xE0 | (code_point >> 12));
+    output += (char)(0x80 | ((code_point >> 6) & 0x3F));
+    output += (char)(0x80 | (code_point & 0x3F));
+  } else {
+    output += (char)(0xF0 | (code_point >> 18));
+    output += (char)(0x80 | ((code_point >> 12) & 0x3F));
+    output += (char)(0x80 | ((code_point >> 6) & 0x3F));
+    output += (char)(0x80 | (code_point & 0x3F));
+  }
+}
 
-  std::string buffer;
-  buffer.resize(size);
-  if (buffer.capacity() < size)
-    return std::string();
+inline unsigned int hash_html_entity_name(const char * name, size_t length, unsigned int seed) {
+  unsigned int hash = HTML_ENTITY_FNV_OFFSET_BASIS ^ seed;
+  for(size_t i=0; i<length; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= HTML_ENTITY_FNV_PRIME;
+  }
+  return hash;
+}
+
+/// <summary>
+/// Search for a named html entity (without the leading '&' and the trailing ';') in the table of html5 entities.
+/// Returns false if the name is not a known entity.
+/// </summary>
+bool find_html_entity(const char * name, size_t length, unsigned int & code_point1, unsigned int & code_point2) {
+  unsigned int seed = html_entity_displacements[hash_html_entity_name(name, length, 0) % NUM_HTML_ENTITY_DISPLACEMENTS];
+  const HTML_ENTITY & entity = html_entities[hash_html_entity_name(name, length, seed) % NUM_HTML_ENTITIES];
+  if (strncmp(entity.name, name, length) != 0 || entity.name[length] != '\0')
+    return false;
+
+  code_point1 = entity.code_points[0];
+  code_point2 = entity.code_points[1];
+  return true;
+}
+
+// Numeric character references in the range 0x80 to 0x9F are interpreted as Windows-1252 characters.
+// See https://html.spec.whatwg.org/multipage/parsing.html#numeric-character-reference-end-state
+static const unsigned int windows1252_code_points[32] = {
+  0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+  0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+/// <summary>
+/// Parse a numeric html entity, for example "#8211" or "#x2013", without the leading '&' and the trailing ';'.
+/// </summary>
+bool parse_numeric_html_entity(const char * name, size_t length, unsigned int & code_point) {
+  if (length < 2 || name[0] != '#')
+    return false;
+
+  bool hexadecimal = (name[1] == 'x' || name[1] == 'X');
+  size_t first = (hexadecimal ? 2 : 1);
+  if (first >= length || length - first > 8)
+    return false;
+
+  code_point = 0;
+  for(size_t i=first; i<length; i++) {
+    char c = name[i];
+    unsigned int digit = 0;
+    if (is_digit(c))
+      digit = c - '0';
+    else if (hexadecimal && c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (hexadecimal && c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return false;
+    code_point = code_point * (hexadecimal ? 16 : 10) + digit;
+  }
+
+  // Reject null characters, surrogates and values outside of the unicode range.
+  if (code_point == 0 || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+    return false;
+
+  if (code_point >= 0x80 && code_point <= 0x9F)
+    code_point = windows1252_code_points[code_point - 0x80];
+  return true;
+}
+
+/// <summary>
+/// Decodes all named and numeric html entities of the given content in a single pass.
+/// The mapping defines the replacement of some code points. For example, U+2019 (right single quotation mark) can be replaced by a plain quote.
+/// Unknown entities are left unchanged.
+/// Returns the number of decoded entities.
+/// </summary>
+size_t decode_html_entities(std::string & content, const HtmlEntityMapping & mapping) {
+  static const size_t max_entity_length = 32;
+
+  size_t pos = content.find('&');
+  if (pos == std::string::npos)
+    return 0;
+
+  std::string output;
+  output.reserve(content.size());
+  size_t count = 0;
+  size_t copied = 0; // offset of the first character of content not yet copied to output
+  while (pos != std::string::npos) {
+    // Search the end of the entity
+    size_t end = pos + 1;
+    while (end < content.size() && end - pos <= max_entity_length && has_character_class(content[end], SCAN_CLASS_ENTITY_NAME))
+      end++;
+    if (end >= content.size() || content[end] != ';') {
+      pos = content.find('&', pos + 1);
+      continue;
+    }
+
+    const char * name = content.c_str() + pos + 1;
+    size_t length = end - pos - 1;
+    unsigned int code_point1 = 0;
+    unsigned int code_point2 = 0;
+    bool found = false;
+    if (name[0] == '#')
+      found = parse_numeric_html_entity(name, length, code_point1);
+    else
+      found = find_html_entity(name, length, code_point1, code_point2);
+    if (!found) {
+      pos = content.find('&', pos + 1);
+      continue;
+    }
+
+    output.append(content, copied, pos - copied);
+    HtmlEntityMapping::const_iterator it = mapping.find(code_point1);
+    if (code_point2 == 0 && it != mapping.end()) {
+      output.append(it->second);
+    } else {
+      append_utf8(output, code_point1);
+      if (code_point2 != 0)
+        append_utf8(output, code_point2);
+    }
+    count++;
+
+    // next entity
+    copied = end + 1;
+    pos = content.find('&', copied);
+  }
+
+  if (count == 0)
+    return 0;
+  output.append(content, copied, std::string::npos);
+  content.swap(output);
+  return count;
+}
+
+void init_piece_table(PieceTable & table, const std::string & content) {
+  table.original = &content;
+  table.added.clear();
+  table.pieces.clear();
+  table.original_offset = 0;
+  table.length = content.size();
+}
+
+/// <summary>
+/// Replaces the range [start, end[ of the original document by the given value.
+/// Returns false if the range overlaps or precedes a previous replacement.
+/// </summary>
+bool replace_piece(PieceTable & table, size_t start, size_t end, std::string_view value) {
+  if (start < table.original_offset || end < start || end > table.original->size())
+    return false;
+
+  // Keep the unmodified text preceding the replacement
+  if (start > table.original_offset) {
+    TEXT_PIECE piece = { true, table.original_offset, start - table.original_offset };
+    table.pieces.push_back(piece);
+  }
+
+  if (!value.empty()) {
+    TEXT_PIECE piece = { false, table.added.size(), value.size() };
+    table.pieces.push_back(piece);
+    table.added.append(value);
+  }
+
+  table.original_offset = end;
+  table.length = table.length - (end - start) + value.size();
+  return true;
+}
 
-  if (file.read((char*)buffer.data(), size)) {
-    return buffer;
+bool has_piece_table_changes(const PieceTable & table) {
+  return !table.pieces.empty() || table.original_offset > 0;
+}
+
+/// <summary>
+/// Builds the modified document in a single copy. The content may be the original document of the table.
+/// </summary>
+void flatten_piece_table(const PieceTable & table, std::string & content) {
+  if (!has_piece_table_changes(table))
+    return;
+
+  const std::string & original = *table.original;
+  std::string output;
+  output.reserve(table.length);
+  for(size_t i=0; i<table.pieces.size(); i++) {
+    const TEXT_PIECE & piece = table.pieces[i];
+    const char * source = (piece.original ? original.c_str() : table.added.c_str());
+    output.append(source + piece.offset, piece.length);
+  }
+  output.append(original, table.original_offset, std::string::npos);
+
+  content.swap(output);
+}
+
+/// <summary>
+/// Maps the content of a file in memory, in read-only mode.
+/// The file must be unmapped with unmap_file() before it can be modified.
+/// </summary>
+bool map_file(const std::string & path, MappedFile & file, std::string & error) {
+  static const char * EMPTY = "";
+  file.data = NULL;
+  file.size = 0;
+
+#ifdef _WIN32
+  file.file_handle = NULL;
+  file.mapping_handle = NULL;
+
+  HANDLE file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    error = "Unable to open file '" + path + "'.";
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file_handle, &file_size)) {
+    CloseHandle(file_handle);
+    error = "Unable to get the size of file '" + path + "'.";
+    return false;
+  }
+
+  // Empty files cannot be mapped
+  if (file_size.QuadPart == 0) {
+    CloseHandle(file_handle);
+    file.data = EMPTY;
+    return true;
+  }
+
+  HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping_handle == NULL) {
+    CloseHandle(file_handle);
+    error = "Unable to map file '" + path + "'.";
+    return false;
+  }
+
+  const char * data = (const char *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+  if (data == NULL) {
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+    error = "Unable to map file '" + path + "'.";
+    return false;
+  }
+
+  file.file_handle = file_handle;
+  file.mapping_handle = mapping_handle;
+  file.data = data;
+  file.size = (size_t)file_size.QuadPart;
+#else
+  int file_descriptor = open(path.c_str(), O_RDONLY);
+  if (file_descriptor == -1) {
+    error = "Unable to open file '" + path + "'.";
+    return false;
+  }
+
+  struct stat file_status;
+  if (fstat(file_descriptor, &file_status) != 0) {
+    close(file_descriptor);
+    error = "Unable to get the size of file '" + path + "'.";
+    return false;
+  }
+
+  // Empty files cannot be mapped
+  if (file_status.st_size == 0) {
+    close(file_descriptor);
+    file.data = EMPTY;
+    return true;
+  }
+
+  void * data = mmap(NULL, (size_t)file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  close(file_descriptor); // the mapping keeps a reference to the file
+  if (data == MAP_FAILED) {
+    error = "Unable to map file '" + path + "'.";
+    return false;
+  }
+
+  file.data = (const char *)data;
+  file.size = (size_t)file_status.st_size;
+#endif
+
+  return true;
+}
+
+void unmap_file(MappedFile & file) {
+  if (file.size > 0) {
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE)file.mapping_handle);
+    CloseHandle((HANDLE)file.file_handle);
+    file.file_handle = NULL;
+    file.mapping_handle = NULL;
+#else
+    munmap((void *)file.data, file.size);
+#endif
   }
-  return std::string();
+  file.data = NULL;
+  file.size = 0;
+}
+
+/// <summary>
+/// Loads the content of a file. Returns false and the reason of the failure if the file cannot be read.
+/// </summary>
+bool load_file(const std::string & path, std::string & content, std::string & error) {
+  MappedFile file;
+  if (!map_file(path, file, error))
+    return false;
+
+  content.assign(file.data, file.size);
+  unmap_file(file);
+  return true;
+}
+
+size_t get_file_size(const std::string & path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return 0;
+  return (size_t)file.tellg();
 }
 
 bool save_file(const std::string & path, const std::string & content) {
@@ -407,6 +1052,178 @@ bool save_file(const std::string & path, const std::string & content) {
   return false;
 }
 
+/// <summary>
+/// Returns true if the file exists and its content is identical to the given content.
+/// </summary>
+bool is_file_content_equal(const std::string & path, const std::string & content) {
+  MappedFile file;
+  std::string error;
+  if (!map_file(path, file, error))
+    return false;
+
+  bool equal = (file.size == content.size() && memcmp(file.data, content.c_str(), content.size()) == 0);
+  unmap_file(file);
+  return equal;
+}
+
+// Suffix of the temporary files of replace_file().
+static const std::string REPLACE_FILE_TEMP_SUFFIX = ".tmp";
+
+/// <summary>
+/// Returns true if the file is a temporary file of replace_file(), such as a file left by an interrupted run.
+/// </summary>
+bool is_temp_file(const std::string & path) {
+  return (path.size() > REPLACE_FILE_TEMP_SUFFIX.size() && path.compare(path.size() - REPLACE_FILE_TEMP_SUFFIX.size(), REPLACE_FILE_TEMP_SUFFIX.size(), REPLACE_FILE_TEMP_SUFFIX) == 0);
+}
+
+/// <summary>
+/// Creates a new temporary file with a unique name in the directory of the given file.
+/// The temporary file has the permissions of the given file or, if the file does not exist, the default permissions of a new file.
+/// </summary>
+static bool create_temp_file(const std::string & path, std::string & temp_path, std::string & error) {
+  static std::atomic<unsigned int> counter(0);
+#ifdef _WIN32
+  unsigned long process_id = GetCurrentProcessId();
+#else
+  unsigned long process_id = (unsigned long)getpid();
+  struct stat file_status;
+  bool has_file = (stat(path.c_str(), &file_status) == 0);
+#endif
+
+  // A file of another thread, process or interrupted run can have the same name
+  for(size_t attempt=0; attempt<100; attempt++) {
+    temp_path = path + "." + to_string(process_id) + "-" + to_string(counter++) + REPLACE_FILE_TEMP_SUFFIX;
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(temp_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_handle);
+      return true;
+    }
+    if (GetLastError() != ERROR_FILE_EXISTS)
+      break;
+#else
+    int file_descriptor = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (file_descriptor != -1) {
+      bool created = (!has_file || fchmod(file_descriptor, file_status.st_mode & 07777) == 0);
+      close(file_descriptor);
+      if (!created) {
+        delete_file(temp_path);
+        error = "Unable to set the permissions of file '" + temp_path + "'.";
+      }
+      return created;
+    }
+    if (errno != EEXIST)
+      break;
+#endif
+  }
+  error = "Unable to create file '" + temp_path + "'.";
+  return false;
+}
+
+/// <summary>
+/// Replaces the content of a file by writing a temporary file and renaming it over the original file.
+/// If the process is interrupted, the file contains either the previous or the new content, never a partial content.
+/// The file keeps its permissions. If the file is a symbolic link, the file it points to is replaced and the link is kept.
+/// The new content is not flushed to disk. See sync_files().
+/// </summary>
+bool replace_file(const std::string & path, const std::string & content, std::string & error) {
+  std::string target = path;
+#ifndef _WIN32
+  struct stat link_status;
+  if (lstat(path.c_str(), &link_status) == 0 && S_ISLNK(link_status.st_mode)) {
+    char * resolved_path = realpath(path.c_str(), NULL);
+    if (resolved_path != NULL) {
+      target = resolved_path;
+      free(resolved_path);
+    }
+  }
+#endif
+
+  std::string temp_path;
+  if (!create_temp_file(target, temp_path, error))
+    return false;
+
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    error = "Unable to create file '" + temp_path + "'.";
+    return false;
+  }
+  file.write(content.c_str(), content.size());
+  file.close();
+  if (!file) {
+    delete_file(temp_path);
+    error = "Unable to write file '" + temp_path + "'.";
+    return false;
+  }
+
+#ifdef _WIN32
+  bool renamed = (MoveFileExA(temp_path.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+  bool renamed = (rename(temp_path.c_str(), target.c_str()) == 0);
+#endif
+  if (!renamed) {
+    delete_file(temp_path);
+    error = "Unable to rename file '" + temp_path + "' to '" + target + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+/// <summary>
+/// Flushes the content of the given files and the entries of their directories to disk.
+/// This allows a single synchronization after writing multiple files with replace_file().
+/// </summary>
+bool sync_files(const std::vector<std::string> & paths, std::string & error) {
+  std::vector<std::string> directories;
+  bool success = true;
+  for(size_t i=0; i<paths.size(); i++) {
+    const std::string & path = paths[i];
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool synced = (file_handle != INVALID_HANDLE_VALUE && FlushFileBuffers(file_handle) != 0);
+    if (file_handle != INVALID_HANDLE_VALUE)
+      CloseHandle(file_handle);
+#else
+    int file_descriptor = open(path.c_str(), O_RDONLY);
+    bool synced = (file_descriptor != -1 && fsync(file_descriptor) == 0);
+    if (file_descriptor != -1)
+      close(file_descriptor);
+
+    // The rename of the file is durable once its directory is synchronized.
+    // For a symbolic link, replace_file() renamed the file it points to.
+    std::string directory;
+    char * resolved_path = realpath(path.c_str(), NULL);
+    if (resolved_path != NULL) {
+      directory = get_parent_directory(resolved_path);
+      free(resolved_path);
+    }
+    else
+      directory = get_parent_directory(path.c_str());
+    if (directory.empty())
+      directory = ".";
+    if (std::find(directories.begin(), directories.end(), directory) == directories.end())
+      directories.push_back(directory);
+#endif
+    if (!synced && success) {
+      error = "Unable to flush file '" + path + "' to disk.";
+      success = false;
+    }
+  }
+
+#ifndef _WIN32
+  for(size_t i=0; i<directories.size(); i++) {
+    int directory_descriptor = open(directories[i].c_str(), O_RDONLY);
+    if (directory_descriptor != -1) {
+      fsync(directory_descriptor);
+      close(directory_descriptor);
+    }
+  }
+#endif
+
+  return success;
+}
+
 bool file_exists(const std::string & name) {
   if (FILE *file = fopen(name.c_str(), "rb")) {
     fclose(file);
@@ -416,27 +1233,117 @@ bool file_exists(const std::string & name) {
   }
 }
 
-bool find_html_tag_boundaries(const std::string & content, const std::string & tag_name, size_t offset, HTML_TAG_INFO & info) {
-  const std::string pattern_open  = "<" + tag_name;
-  const std::string pattern_close = "</" + tag_name + ">";
+// Names of the html tags, indexed by HTML_TAG_ID.
+static constexpr const char * html_tag_names[NUM_HTML_TAG_IDS] = {
+  "", "a", "abbr", "area", "article", "audio", "b", "base", "blockquote", "body", "br", "button", "caption",
+  "center", "code", "col", "dd", "div", "dl", "dt", "em", "embed", "figcaption", "figure", "font", "footer",
+  "form", "h1", "h2", "h3", "h4", "h5", "h6", "head", "header", "hr", "html", "i", "iframe", "img", "input",
+  "label", "li", "link", "meta", "nav", "object", "ol", "p", "param", "pre", "s", "script", "section", "small",
+  "source", "span", "strong", "style", "sub", "sup", "table", "tbody", "td", "th", "thead", "tr", "track", "u",
+  "ul", "video", "wbr",
+};
+
+static const size_t HTML_TAG_HASH_SIZE = 256;
+
+/// <summary>
+/// Hash of a tag name computed from its first character, its last character and its length.
+/// The coefficients are chosen so that each known tag name has its own slot.
+/// </summary>
+constexpr size_t hash_html_tag_name(const char * name, size_t length) {
+  return ((unsigned char)name[0] * 13 + (unsigned char)name[length - 1] * 31 + length * 15) % HTML_TAG_HASH_SIZE;
+}
+
+constexpr size_t get_html_tag_name_length(const char * name) {
+  size_t length = 0;
+  while (name[length] != '\0')
+    length++;
+  return length;
+}
+
+struct HTML_TAG_HASH_TABLE {
+  unsigned char slots[HTML_TAG_HASH_SIZE]; // HTML_TAG_ID of each slot
+  bool perfect; // true if no two tag names share a slot
+};
+
+constexpr HTML_TAG_HASH_TABLE build_html_tag_hash_table() {
+  HTML_TAG_HASH_TABLE table = {};
+  table.perfect = true;
+  for(size_t i=1; i<NUM_HTML_TAG_IDS; i++) {
+    size_t slot = hash_html_tag_name(html_tag_names[i], get_html_tag_name_length(html_tag_names[i]));
+    if (table.slots[slot] != HTML_TAG_ID_UNKNOWN)
+      table.perfect = false;
+    table.slots[slot] = (unsigned char)i;
+  }
+  return table;
+}
+
+static constexpr HTML_TAG_HASH_TABLE html_tag_hash_table = build_html_tag_hash_table();
+static_assert(html_tag_hash_table.perfect, "Two html tag names have the same hash. Change the coefficients of hash_html_tag_name().");
+
+inline bool is_html_tag_name(const char * name, size_t length, const char * expected) {
+  return (strlen(expected) == length && strncmp(name, expected, length) == 0);
+}
+
+/// <summary>
+/// Returns the identifier of a complete tag name. The name is case sensitive.
+/// Returns HTML_TAG_ID_UNKNOWN if the name is not a known tag name.
+/// </summary>
+HTML_TAG_ID get_html_tag_id(const char * name, size_t length) {
+  if (length == 0)
+    return HTML_TAG_ID_UNKNOWN;
+  HTML_TAG_ID tag_id = (HTML_TAG_ID)html_tag_hash_table.slots[hash_html_tag_name(name, length)];
+  if (tag_id == HTML_TAG_ID_UNKNOWN || !is_html_tag_name(name, length, html_tag_names[tag_id]))
+    return HTML_TAG_ID_UNKNOWN;
+  return tag_id;
+}
+
+const char * get_html_tag_name(HTML_TAG_ID tag_id) {
+  if (tag_id >= NUM_HTML_TAG_IDS)
+    return "";
+  return html_tag_names[tag_id];
+}
+
+/// <summary>
+/// Returns true if the character ends the name of an open tag. The tokenizer uses the same characters.
+/// </summary>
+inline bool is_html_open_tag_name_end(char c) {
+  return (c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
 
+/// <summary>
+/// Search the first element with the given tag name.
+/// The tag name must be complete: "p" does not match "<pre>" and "a" does not match "<abbr>".
+/// </summary>
+bool find_html_tag_boundaries(std::string_view content, const char * tag_name, size_t tag_name_length, size_t offset, HTML_TAG_INFO & info) {
   memset(&info, 0xff, sizeof(info));
+  if (tag_name_length == 0)
+    return false;
 
   // Search the offsets of the <open ...> tag.
-  size_t open_start = content.find(pattern_open, offset);
+  size_t open_start = content.find('<', offset);
+  while (open_start != std::string::npos) {
+    size_t name_end = open_start + 1 + tag_name_length;
+    if (name_end < content.size() && content.compare(open_start + 1, tag_name_length, tag_name, tag_name_length) == 0 && is_html_open_tag_name_end(content[name_end]))
+      break;
+    open_start = content.find('<', open_start + 1);
+  }
   if (open_start == std::string::npos)
     return false;
-  size_t open_end = content.find(">", open_start);
+  size_t open_end = content.find('>', open_start);
   if (open_end == std::string::npos)
     return false;
 
   // Search the offsets of the </closing> tag.
-  size_t close_start = content.find(pattern_close, open_end + 1);
+  size_t close_start = content.find("</", open_end + 1, 2);
+  while (close_start != std::string::npos) {
+    size_t name_end = close_start + 2 + tag_name_length;
+    if (name_end < content.size() && content.compare(close_start + 2, tag_name_length, tag_name, tag_name_length) == 0 && content[name_end] == '>')
+      break;
+    close_start = content.find("</", close_start + 1, 2);
+  }
   if (close_start == std::string::npos)
     return false;
-  size_t close_end = close_start + pattern_close.size() - 1;
-  if (close_end == std::string::npos)
-    return false;
+  size_t close_end = close_start + tag_name_length + 2;
 
   info.open_start = open_start;
   info.open_end = open_end;
@@ -445,82 +1352,229 @@ bool find_html_tag_boundaries(const std::string & content, const std::string & t
 
   info.inner_start = info.open_end    + 1;
   info.inner_end   = info.close_start - 1;
-  //std::string::size_type inner_length = info.close_start - inner_start;
-  //std::string inner_text = content.substr(inner_start, inner_length);
 
-  return true;
+  return true;
+}
+
+bool find_html_tag_boundaries(std::string_view content, const std::string & tag_name, size_t offset, HTML_TAG_INFO & info) {
+  return find_html_tag_boundaries(content, tag_name.c_str(), tag_name.size(), offset, info);
+}
+
+bool find_html_tag_boundaries(std::string_view content, HTML_TAG_ID tag_id, size_t offset, HTML_TAG_INFO & info) {
+  const char * tag_name = get_html_tag_name(tag_id);
+  return find_html_tag_boundaries(content, tag_name, strlen(tag_name), offset, info);
+}
+
+/// <summary>
+/// Returns the inner html of an element found with find_html_tag_boundaries(), without copying it.
+/// </summary>
+std::string_view get_html_inner_view(std::string_view content, const HTML_TAG_INFO & tag_info) {
+  size_t inner_length = tag_info.close_start - tag_info.inner_start;
+  return content.substr(tag_info.inner_start, inner_length);
+}
+
+/// <summary>
+/// Returns true if the character separates the attributes of an open tag.
+/// </summary>
+inline bool is_html_attribute_space(char c) {
+  return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f');
+}
+
+// The name and the value of an attribute read by read_html_attribute().
+struct HTML_ATTRIBUTE_RANGE {
+  size_t name_start;
+  size_t name_length;
+  size_t value_start;
+  size_t value_length;
+};
+
+/// <summary>
+/// Returns the offset following the name of the tag that starts at the given offset.
+/// The offset is returned unchanged if it is not the start of a tag.
+/// </summary>
+static size_t skip_html_tag_name(std::string_view content, size_t offset, size_t end) {
+  if (offset >= end || content[offset] != '<')
+    return offset;
+  offset++;
+  while (offset < end && !is_html_open_tag_name_end(content[offset]))
+    offset++;
+  return offset;
+}
+
+/// <summary>
+/// Reads the next attribute of an open tag, between offset and end, and moves offset past the attribute.
+/// The value may be enclosed in double quotes, in single quotes or unquoted, with whitespace around the '=' sign.
+/// An attribute without a '=' sign has an empty value.
+/// Returns false if there are no more attributes or if the value of the attribute has no closing quote before end.
+/// </summary>
+static bool read_html_attribute(std::string_view content, size_t & offset, size_t end, HTML_ATTRIBUTE_RANGE & range) {
+  // skip the separators before the name
+  while (offset < end && (is_html_attribute_space(content[offset]) || content[offset] == '/'))
+    offset++;
+  if (offset >= end)
+    return false;
+
+  // read the name, its first character may be anything
+  range.name_start = offset;
+  offset++;
+  while (offset < end && !is_html_attribute_space(content[offset]) && content[offset] != '=' && content[offset] != '/')
+    offset++;
+  range.name_length = offset - range.name_start;
+  range.value_start = offset;
+  range.value_length = 0;
+
+  // search the '=' sign
+  size_t equal_pos = offset;
+  while (equal_pos < end && is_html_attribute_space(content[equal_pos]))
+    equal_pos++;
+  if (equal_pos >= end || content[equal_pos] != '=')
+    return true; // attribute without a value
+  offset = equal_pos + 1;
+  while (offset < end && is_html_attribute_space(content[offset]))
+    offset++;
+  range.value_start = offset;
+  if (offset >= end)
+    return true;
+
+  char quote = content[offset];
+  if (quote == '\"' || quote == '\'') {
+    size_t quote_end = content.find(quote, offset + 1);
+    if (quote_end == std::string::npos || quote_end >= end)
+      return false; // failed finding the attribute endding.
+    range.value_start = offset + 1;
+    range.value_length = quote_end - range.value_start;
+    offset = quote_end + 1;
+  } else {
+    while (offset < end && !is_html_attribute_space(content[offset]))
+      offset++;
+    range.value_length = offset - range.value_start;
+  }
+  return true;
+}
+
+/// <summary>
+/// Search an attribute by its complete name in the open tag that starts at offset_start and ends at offset_end.
+/// </summary>
+bool find_html_attribute_boundaries(std::string_view content, std::string_view attr_name, size_t offset_start, size_t offset_end, HTML_ATTRIBUTE_INFO & info) {
+  if (content.empty() || attr_name.empty() || offset_start >= offset_end)
+    return false;
+
+  memset(&info, 0xff, sizeof(info));
+
+  size_t end = std::min(offset_end, content.size());
+  size_t offset = skip_html_tag_name(content, offset_start, end);
+  HTML_ATTRIBUTE_RANGE range;
+  while (read_html_attribute(content, offset, end, range)) {
+    if (content.compare(range.name_start, range.name_length, attr_name) == 0) {
+      info.attr_value_start = range.value_start;
+      info.attr_value_end = range.value_start + range.value_length - 1;
+      return true;
+    }
+  }
+
+  return false; // not found
 }
 
-bool find_html_attribute_boundaries(const std::string & content, const std::string & attr_name, size_t offset_start, size_t offset_end, HTML_ATTRIBUTE_INFO & info) {
-  if (content.empty() || attr_name.empty() || offset_start >= offset_end)
-    return false;
-
-  memset(&info, 0xff, sizeof(info));
+/// <summary>
+/// Returns the value of an attribute of the open tag of an element, without copying it.
+/// The view is empty if the tag has no such attribute.
+/// </summary>
+std::string_view get_html_attribute_view(std::string_view content, std::string_view attr_name, const HTML_TAG_INFO & tag_info) {
+  HTML_ATTRIBUTE_INFO attr_info;
+  bool has_attr_value = find_html_attribute_boundaries(content, attr_name, tag_info.open_start, tag_info.open_end, attr_info);
+  if (!has_attr_value)
+    return std::string_view();
+  size_t attr_value_length = attr_info.attr_value_end - attr_info.attr_value_start + 1;
+  return content.substr(attr_info.attr_value_start, attr_value_length);
+}
 
-  // search for the pattern "id="
-  std::string pattern_start = attr_name + "=";
-  size_t pattern_pos = content.find(pattern_start, offset_start);
-  if (pattern_pos == std::string::npos || pattern_pos >= offset_end)
-    return false; // not found
-
-  // look at the next character
-  size_t next_pos = pattern_pos + pattern_start.size();
-  if (next_pos == std::string::npos || next_pos >= offset_end)
-    return false; // not found
-  char next = content[next_pos];
-
-  if (next == '\'' || next == '\"') {
-    // this is a string enclosed argument
-    // search for the string endding
-    size_t end_pos = content.find(next, next_pos+1);
-    if (end_pos == std::string::npos || end_pos >= offset_end)
-      return false; // failed finding the attribute endding.
+std::string get_html_attribute_value(std::string_view content, std::string_view attr_name, const HTML_TAG_INFO & tag_info) {
+  return std::string(get_html_attribute_view(content, attr_name, tag_info));
+}
 
-    info.attr_value_start = next_pos + 1;
-    info.attr_value_end = end_pos - 1;
-    return true;
-  } else {
-    // this is a word or numeric argument without quotes
-    // search for the argument end
+// Names of the html attributes, indexed by HTML_ATTRIBUTE_ID.
+static const char * html_attribute_names[NUM_HTML_ATTRIBUTE_IDS] = {
+  "", "alt", "class", "colspan", "data-url", "height", "href", "id", "rowspan", "src", "style", "title", "width",
+};
+
+/// <summary>
+/// Returns the identifier of a complete attribute name. The name is case sensitive.
+/// Returns HTML_ATTRIBUTE_ID_UNKNOWN if the name is not used by the filters.
+/// </summary>
+HTML_ATTRIBUTE_ID get_html_attribute_id(const char * name, size_t length) {
+  for(size_t i=1; i<NUM_HTML_ATTRIBUTE_IDS; i++) {
+    if (is_html_tag_name(name, length, html_attribute_names[i]))
+      return (HTML_ATTRIBUTE_ID)i;
+  }
+  return HTML_ATTRIBUTE_ID_UNKNOWN;
+}
 
-    size_t end_pos = content.find_first_of(html_tag_endding_characters, next);
-    if (end_pos == std::string::npos || end_pos >= offset_end)
-      return false; // failed finding the attribute endding.
+/// <summary>
+/// Parses the attributes of the open tag of an element in a single pass.
+/// The table holds the offsets of the values in content: it is valid as long as content is not modified.
+/// </summary>
+void parse_html_attributes(std::string_view content, const HTML_TAG_INFO & tag_info, HtmlAttributeTable & table) {
+  table.count = 0;
+  if (tag_info.open_start >= tag_info.open_end || tag_info.open_start >= content.size())
+    return;
 
-    info.attr_value_start = next_pos;
-    info.attr_value_end = end_pos - 1;
-    return true;
+  size_t end = std::min(tag_info.open_end, content.size());
+  size_t offset = skip_html_tag_name(content, tag_info.open_start, end);
+  HTML_ATTRIBUTE_RANGE range;
+  while (read_html_attribute(content, offset, end, range)) {
+    HTML_ATTRIBUTE_ID attr_id = get_html_attribute_id(content.data() + range.name_start, range.name_length);
+    if (attr_id == HTML_ATTRIBUTE_ID_UNKNOWN || has_html_attribute(table, attr_id))
+      continue;
+    HTML_ATTRIBUTE & attribute = table.attributes[table.count];
+    attribute.attr_id = attr_id;
+    attribute.value_start = range.value_start;
+    attribute.value_length = range.value_length;
+    table.count++;
   }
+}
 
+bool has_html_attribute(const HtmlAttributeTable & table, HTML_ATTRIBUTE_ID attr_id) {
+  for(size_t i=0; i<table.count; i++) {
+    if (table.attributes[i].attr_id == attr_id)
+      return true;
+  }
   return false;
 }
 
-std::string get_html_attribute_value(const std::string & content, const std::string & attr_name, const HTML_TAG_INFO & tag_info) {
-  HTML_ATTRIBUTE_INFO attr_info;
-  bool has_attr_value = find_html_attribute_boundaries(content, attr_name, tag_info.open_start, tag_info.open_end, attr_info);
-  std::string attr_value;
-  if (has_attr_value) {
-    size_t attr_value_length = attr_info.attr_value_end - attr_info.attr_value_start + 1;
-    attr_value = content.substr(attr_info.attr_value_start, attr_value_length);
+/// <summary>
+/// Returns the value of an attribute parsed with parse_html_attributes(), without copying it.
+/// The view is empty if the tag has no such attribute.
+/// </summary>
+std::string_view get_html_attribute_view(std::string_view content, const HtmlAttributeTable & table, HTML_ATTRIBUTE_ID attr_id) {
+  for(size_t i=0; i<table.count; i++) {
+    const HTML_ATTRIBUTE & attribute = table.attributes[i];
+    if (attribute.attr_id == attr_id)
+      return content.substr(attribute.value_start, attribute.value_length);
   }
-  return attr_value;
+  return std::string_view();
 }
 
-std::string find_class_property(const std::string & class_value, const std::string & property_name) {
-  std::string pattern = property_name + ":";
-
-  size_t pos = class_value.find(pattern);
+std::string_view find_class_property_view(std::string_view class_value, std::string_view property_name) {
+  // search for the pattern "lang:"
+  size_t pos = class_value.find(property_name);
+  while (pos != std::string::npos && (pos + property_name.size() >= class_value.size() || class_value[pos + property_name.size()] != ':'))
+    pos = class_value.find(property_name, pos + 1);
   if (pos == std::string::npos)
-    return std::string();
+    return std::string_view();
 
-  std::string property_value;
-  for(size_t i=pos+pattern.size(); i<class_value.size(); i++) {
-    char c = class_value[i];
+  size_t start = pos + property_name.size() + 1;
+  size_t end = start;
+  while (end < class_value.size()) {
+    char c = class_value[end];
     if (c == ' ' || c == ';' || c == '\"' || c == '\0')
       break;
-    property_value.append(1, c);
+    end++;
   }
-  return property_value;
+  return class_value.substr(start, end - start);
+}
+
+std::string find_class_property(std::string_view class_value, std::string_view property_name) {
+  return std::string(find_class_property_view(class_value, property_name));
 }
 
 size_t get_html_tag_indentation(const char * content, const HTML_TAG_INFO & tag_info) {
@@ -557,69 +1611,85 @@ std::string read_until(const std::string & content, size_t offset, const std::ve
   return output;
 }
 
+std::string_view read_until_view(const std::string & content, size_t offset, const char * characters, size_t num_characters) {
+  if (offset >= content.size())
+    return std::string_view();
+
+  // The output also ends at the first null character
+  size_t end = content.find('\0', offset);
+  if (end == std::string::npos)
+    end = content.size();
+  size_t pos = scan_for_any(content.c_str(), end, offset, characters, num_characters);
+  if (pos == std::string::npos)
+    pos = end;
+  return std::string_view(content).substr(offset, pos - offset);
+}
+
 std::string read_until(const std::string & content, size_t offset, const char * characters, size_t num_characters) {
-  std::string output;
-  while (content[offset] != '\0') {
-    char c = content[offset];
-    if (!is_any(c, characters, num_characters)) {
-      output.append(1, c);
-      offset++;
-    }
-    else
-      break;
-  }
-  return output;
+  return std::string(read_until_view(content, offset, characters, num_characters));
+}
+
+std::string_view read_html_tag_view(const std::string & content, size_t offset) {
+  return read_until_view(content, offset, html_tag_endding_characters, num_html_tag_endding_characters);
 }
 
 std::string read_html_tag(const std::string & content, size_t offset) {
-  std::string output;
-  output = read_until(content, offset, html_tag_endding_characters, num_html_tag_endding_characters);
-  return output;
+  return std::string(read_html_tag_view(content, offset));
 }
 
-bool has_inner_html_tags(const std::string & content, int ignore_html_tag_flags) {
-  size_t pos = content.find('<', 0);
+bool has_inner_html_tags(std::string_view content, int ignore_html_tag_flags) {
+  return has_inner_html_tags(content.data(), content.size(), ignore_html_tag_flags);
+}
+
+bool has_inner_html_tags(const char * content, size_t length, int ignore_html_tag_flags) {
+  static const char html_comment_open[] = "<!--";
+  static const size_t html_comment_open_length = sizeof(html_comment_open) - 1;
+
+  size_t pos = find_in_buffer(content, length, '<', 0);
   while (pos != std::string::npos) {
 
     // ignore html comments if required
     if ((ignore_html_tag_flags & HTML_TAG_COMMENT) == HTML_TAG_COMMENT) {
-      static const std::string html_comment_open = "<!--";
-      if (content.find(html_comment_open.c_str(), pos, html_comment_open.size()) == pos) {
+      if (length - pos >= html_comment_open_length && strncmp(content + pos, html_comment_open, html_comment_open_length) == 0) {
         // that's an html comment
-        pos = content.find('<', pos + html_comment_open.size());
+        pos = find_in_buffer(content, length, '<', pos + html_comment_open_length);
         continue;
       }
     }
 
     // read the tag name
-    std::string tag_name = read_html_tag(content, pos + 1);
+    const char * tag_name = content + pos + 1;
+    size_t tag_name_length = 0;
+    while (pos + 1 + tag_name_length < length && !has_character_class(tag_name[tag_name_length], SCAN_CLASS_TAG_NAME_END))
+      tag_name_length++;
 
-    if (tag_name.empty()) {
+    if (tag_name_length == 0) {
       // we might have got a closing tag. ie </a>
       // next tag
-      pos = content.find('<', pos + 1);
+      pos = find_in_buffer(content, length, '<', pos + 1);
       continue;
     }
+    HTML_TAG_ID tag_id = get_html_tag_id(tag_name, tag_name_length);
 
     if ((ignore_html_tag_flags & HTML_TAG_BR) == HTML_TAG_BR) {
       // br should not be considered as inner html tag and should be left alone.
-      if (tag_name == "br") {
+      if (tag_id == HTML_TAG_ID_BR) {
         // next tag
-        pos = content.find('<', pos + tag_name.size());
+        pos = find_in_buffer(content, length, '<', pos + tag_name_length);
         continue;
       }
     }
     if ((ignore_html_tag_flags & HTML_TAG_SUB) == HTML_TAG_SUB) {
-      if (tag_name == "sub") {
+      if (tag_id == HTML_TAG_ID_SUB) {
         // next tag
-        pos = content.find('<', pos + tag_name.size());
+        pos = find_in_buffer(content, length, '<', pos + tag_name_length);
         continue;
       }
     }
     if ((ignore_html_tag_flags & HTML_TAG_SUP) == HTML_TAG_SUP) {
-      if (tag_name == "sup") {
+      if (tag_id == HTML_TAG_ID_SUP) {
         // next tag
-        pos = content.find('<', pos + tag_name.size());
+        pos = find_in_buffer(content, length, '<', pos + tag_name_length);
         continue;
       }
     }
@@ -634,7 +1704,7 @@ bool has_inner_html_tags(const std::string & content, int ignore_html_tag_flags)
 bool has_inner_html_tags(const HtmlTableRow & row, int ignore_html_tag_flags) {
   for(size_t i=0; i<row.size(); i++) {
     const HtmlTableCell & cell = row[i];
-    if (has_inner_html_tags(cell, ignore_html_tag_flags))
+    if (has_inner_html_tags(cell.c_str(), cell.size(), ignore_html_tag_flags))
       return true;
   }
   return false;
@@ -649,7 +1719,7 @@ bool has_inner_html_tags(const HtmlTable & table, int ignore_html_tag_flags) {
   return false;
 }
 
-bool has_cell_spanning(const std::string & content) {
+bool has_cell_spanning(std::string_view content) {
   if (content.find("rowspan") != std::string::npos) {
     return true;
   } else if (content.find("colspan") != std::string::npos) {
@@ -658,16 +1728,212 @@ bool has_cell_spanning(const std::string & content) {
   return false;
 }
 
-std::vector<std::string> split(const std::string & content, char split_character) {
-  std::stringstream input(content);
-  std::string tmp;
-  std::vector<std::string> elements;
+bool is_html_void_element(HTML_TAG_ID tag_id) {
+  switch(tag_id) {
+  case HTML_TAG_ID_AREA:
+  case HTML_TAG_ID_BASE:
+  case HTML_TAG_ID_BR:
+  case HTML_TAG_ID_COL:
+  case HTML_TAG_ID_EMBED:
+  case HTML_TAG_ID_HR:
+  case HTML_TAG_ID_IMG:
+  case HTML_TAG_ID_INPUT:
+  case HTML_TAG_ID_LINK:
+  case HTML_TAG_ID_META:
+  case HTML_TAG_ID_PARAM:
+  case HTML_TAG_ID_SOURCE:
+  case HTML_TAG_ID_TRACK:
+  case HTML_TAG_ID_WBR:
+    return true;
+  default:
+    return false;
+  };
+}
+
+inline void append_html_text_token(std::pmr::vector<HTML_TOKEN> & tokens, size_t start, size_t end) {
+  // Merge with the previous text token, if any
+  if (!tokens.empty() && tokens.back().type == HTML_TOKEN_TEXT && tokens.back().end + 1 == start) {
+    tokens.back().end = end;
+    return;
+  }
+  HTML_TOKEN token;
+  token.type = HTML_TOKEN_TEXT;
+  token.start = start;
+  token.end = end;
+  token.name_start = std::string::npos;
+  token.name_length = 0;
+  token.tag_id = HTML_TAG_ID_UNKNOWN;
+  token.name_length = 0;
+  token.match = std::string::npos;
+  tokens.push_back(token);
+}
+
+void tokenize_html(const std::string & content, std::pmr::vector<HTML_TOKEN> & tokens) {
+  static const std::string html_comment_open = "<!--";
+  static const std::string html_comment_close = "-->";
+
+  // Each '<' character adds at most a text token and a tag token. The vector does not grow on the arena.
+  tokens.clear();
+  tokens.reserve(2 * std::count(content.begin(), content.end(), '<') + 1);
+
+  size_t offset = 0;
+  while(offset < content.size()) {
+    size_t pos = content.find('<', offset);
+    if (pos == std::string::npos) {
+      append_html_text_token(tokens, offset, content.size() - 1);
+      break;
+    }
+    if (pos > offset)
+      append_html_text_token(tokens, offset, pos - 1);
+
+    // Html comments are kept as text
+    if (content.compare(pos, html_comment_open.size(), html_comment_open) == 0) {
+      size_t comment_end = content.find(html_comment_close, pos + html_comment_open.size());
+      if (comment_end == std::string::npos) {
+        append_html_text_token(tokens, pos, content.size() - 1);
+        break;
+      }
+      append_html_text_token(tokens, pos, comment_end + html_comment_close.size() - 1);
+      offset = comment_end + html_comment_close.size();
+      continue;
+    }
+
+    // Read the tag name
+    bool is_close = (pos + 1 < content.size() && content[pos + 1] == '/');
+    size_t name_start = pos + (is_close ? 2 : 1);
+    size_t name_end = name_start;
+    while(name_end < content.size() && is_alphanumeric(content[name_end]))
+      name_end++;
+    size_t name_length = name_end - name_start;
+    char next = (name_end < content.size() ? content[name_end] : '\0');
+
+    // Find the end of the tag
+    size_t tag_end = std::string::npos;
+    if (name_length > 0 && is_letter(content[name_start])) {
+      if (is_close && next == '>')
+        tag_end = name_end;
+      else if (!is_close && (next == '>' || next == '/' || next == ' ' || next == '\t' || next == '\n' || next == '\r'))
+        tag_end = content.find('>', name_end);
+    }
+    if (tag_end == std::string::npos) {
+      // not a tag, that's a single '<' character
+      append_html_text_token(tokens, pos, pos);
+      offset = pos + 1;
+      continue;
+    }
+
+    HTML_TOKEN token;
+    token.start = pos;
+    token.end = tag_end;
+    token.name_start = name_start;
+    token.name_length = name_length;
+    token.tag_id = get_html_tag_id(&content[name_start], name_length);
+    token.match = std::string::npos;
+    if (is_close)
+      token.type = HTML_TOKEN_CLOSE;
+    else if (content[tag_end - 1] == '/' || is_html_void_element(token.tag_id))
+      token.type = HTML_TOKEN_VOID;
+    else
+      token.type = HTML_TOKEN_OPEN;
+    tokens.push_back(token);
+
+    offset = tag_end + 1;
+  }
+}
+
+void build_html_element_tree(const std::string & content, HtmlElementTree & tree) {
+  tokenize_html(content, tree.tokens);
+  std::pmr::vector<HTML_TOKEN> & tokens = tree.tokens;
+
+  // Match each close tag with the nearest open tag of the same name
+  std::vector<size_t> open_elements;
+  for(size_t i=0; i<tokens.size(); i++) {
+    HTML_TOKEN & token = tokens[i];
+    if (token.type == HTML_TOKEN_OPEN) {
+      open_elements.push_back(i);
+    } else if (token.type == HTML_TOKEN_CLOSE) {
+      size_t depth = open_elements.size();
+      while(depth > 0) {
+        const HTML_TOKEN & open = tokens[open_elements[depth - 1]];
+        if (open.tag_id != HTML_TAG_ID_UNKNOWN || token.tag_id != HTML_TAG_ID_UNKNOWN) {
+          if (open.tag_id == token.tag_id)
+            break;
+        } else if (open.name_length == token.name_length && content.compare(open.name_start, open.name_length, content, token.name_start, token.name_length) == 0)
+          break;
+        depth--;
+      }
+      if (depth == 0) {
+        // close tag without an open tag
+        token.type = HTML_TOKEN_TEXT;
+        continue;
+      }
+
+      // Elements that are opened inside this element but never closed are not elements
+      while(open_elements.size() > depth) {
+        tokens[open_elements.back()].type = HTML_TOKEN_TEXT;
+        open_elements.pop_back();
+      }
+
+      size_t open_index = open_elements.back();
+      open_elements.pop_back();
+      tokens[open_index].match = i;
+      token.match = open_index;
+    }
+  }
+
+  // Elements that are never closed are not elements
+  for(size_t i=0; i<open_elements.size(); i++) {
+    tokens[open_elements[i]].type = HTML_TOKEN_TEXT;
+  }
+}
+
+size_t get_html_max_depth(const HtmlElementTree & tree) {
+  size_t depth = 0;
+  size_t max_depth = 0;
+  for(size_t i=0; i<tree.tokens.size(); i++) {
+    const HTML_TOKEN & token = tree.tokens[i];
+    if (token.type == HTML_TOKEN_OPEN) {
+      depth++;
+      if (max_depth < depth)
+        max_depth = depth;
+    } else if (token.type == HTML_TOKEN_CLOSE) {
+      depth--;
+    }
+  }
+  return max_depth;
+}
+
+size_t get_html_max_depth(const std::string & content) {
+  // The tree is only needed to measure the depth
+  FileArenaScope arena_scope;
+  HtmlElementTree tree;
+  build_html_element_tree(content, tree);
+  return get_html_max_depth(tree);
+}
 
-  while(std::getline(input, tmp, split_character))
-  {
-     elements.push_back(tmp);
+/// <summary>
+/// Splits the content without copying it. A trailing split character does not start an empty element.
+/// </summary>
+std::vector<std::string_view> split_view(std::string_view content, char split_character) {
+  std::vector<std::string_view> elements;
+  size_t start = 0;
+  while (start < content.size()) {
+    size_t end = content.find(split_character, start);
+    if (end == std::string::npos)
+      end = content.size();
+    elements.push_back(content.substr(start, end - start));
+    start = end + 1;
   }
+  return elements;
+}
 
+std::vector<std::string> split(const std::string & content, char split_character) {
+  std::vector<std::string_view> views = split_view(content, split_character);
+  std::vector<std::string> elements;
+  elements.reserve(views.size());
+  for(size_t i=0; i<views.size(); i++) {
+    elements.push_back(std::string(views[i]));
+  }
   return elements;
 }
 
@@ -682,62 +1948,83 @@ std::string join(const std::vector<std::string> & lines, char join_character) {
   return output;
 }
 
-size_t trim(std::string & text, char trim_character) {
-  size_t size_old = text.size();
+std::string_view trim_view(std::string_view text, char trim_character) {
+  size_t start = 0;
+  size_t end = text.size();
+  while(start < end && text[start] == trim_character)
+    start++;
+  while(end > start && text[end-1] == trim_character)
+    end--;
+  return text.substr(start, end - start);
+}
 
-  while(!text.empty() && text[0] == trim_character) {
-    text.erase(0, 1);
-  }
+/// <summary>
+/// Removes all the leading occurrences of a string, and its last trailing occurrence.
+/// </summary>
+std::string_view trim_view(std::string_view text, const char * trim_str) {
+  if (trim_str == NULL)
+    return text;
+  size_t trim_str_size = strlen(trim_str);
+  if (trim_str_size == 0)
+    return text;
 
-  while(!text.empty() && text[text.size()-1] == trim_character) {
-    text.erase(text.size()-1, 1);
-  }
+  while(text.size() >= trim_str_size && text.compare(0, trim_str_size, trim_str, trim_str_size) == 0)
+    text.remove_prefix(trim_str_size);
 
-  size_t size_new = text.size();
-  size_t size_diff = size_old-size_new;
-  return size_diff;
-}
+  if (text.size() > trim_str_size && text.compare(text.size() - trim_str_size, trim_str_size, trim_str, trim_str_size) == 0)
+    text.remove_suffix(trim_str_size);
 
-size_t trim(std::string & text, const char * trim_str) {
-  if (trim_str == NULL)
-    return 0;
+  return text;
+}
 
-  size_t size_old = text.size();
+/// <summary>
+/// Keeps the given range of a text, in place. The range must be a view of the text.
+/// Returns the number of removed characters.
+/// </summary>
+template <typename String>
+inline size_t assign_trimmed(String & text, std::string_view range) {
+  size_t start = (size_t)(range.data() - text.data());
+  size_t removed = text.size() - range.size();
+  text.erase(start + range.size());
+  text.erase(0, start);
+  return removed;
+}
 
-  size_t trim_str_size = strlen(trim_str);
-  while(!text.empty() && text.find(trim_str, 0, trim_str_size) == 0) {
-    text.erase(0, trim_str_size);
-  }
+size_t trim(std::string & text, char trim_character) {
+  return assign_trimmed(text, trim_view(text, trim_character));
+}
 
-  if (text.size() > trim_str_size) {
-    size_t end_offset = text.size()-trim_str_size;
-    while(!text.empty() && text.find(trim_str, end_offset) == end_offset) {
-      text.erase(end_offset, trim_str_size);
-    }
-  }
+size_t trim(std::string & text, const char * trim_str) {
+  return assign_trimmed(text, trim_view(text, trim_str));
+}
 
-  size_t size_new = text.size();
-  size_t size_diff = size_old-size_new;
-  return size_diff;
+/// <summary>
+/// Removes the html white space from the beginning and the end of a text, without copying it.
+/// </summary>
+std::string_view trim_html_whitespace_view(std::string_view text) {
+  size_t size = 0;
+  do {
+    size = text.size();
+    text = trim_view(text, "\xc2\xa0");
+    text = trim_view(text, "&nbsp;");
+    text = trim_view(text, ' ');
+    text = trim_view(text, '\t');
+    text = trim_view(text, "\r\n");
+    text = trim_view(text, '\n');
+  } while(text.size() != size);
+  return text;
 }
 
 size_t trim_html_whitespace(std::string & text) {
-  size_t count = 0;
-  size_t diff = 0;
-  do {
-    diff = 0;  
-    diff += trim(text, "\xc2\xa0");
-    diff += trim(text, "&nbsp;");
-    diff += trim(text, ' ');
-    diff += trim(text, '\t');
-    diff += trim(text, "\r\n");
-    diff += trim(text, '\n');
-    count += diff;
-  } while(diff != 0);
-  return count;
+  return assign_trimmed(text, trim_html_whitespace_view(text));
+}
+
+size_t trim_html_whitespace(std::pmr::string & text) {
+  return assign_trimmed(text, trim_html_whitespace_view(text));
 }
 
 size_t trim_html_whitespace(HtmlTable & table) {
+  table.widths.clear();
   size_t count = 0;
   for(size_t i=0; i<table.rows.size(); i++) {
     HtmlTableRow & row = table.rows[i];
@@ -749,33 +2036,76 @@ size_t trim_html_whitespace(HtmlTable & table) {
   return count;
 }
 
+void find_html_whitespace_trim_range(const std::string & content, size_t & start, size_t & end) {
+  // Same white characters as `trim_html_whitespace()`
+  static const char * white_characters[] = { "\xc2\xa0", "&nbsp;", " ", "\t", "\r\n", "\n" };
+  static const size_t num_white_characters = sizeof(white_characters) / sizeof(white_characters[0]);
+
+  bool found = true;
+  while(start < end && found) {
+    found = false;
+    for(size_t i=0; i<num_white_characters && !found; i++) {
+      size_t length = strlen(white_characters[i]);
+      if (end - start >= length && content.compare(start, length, white_characters[i]) == 0) {
+        start += length;
+        found = true;
+      }
+    }
+  }
+
+  found = true;
+  while(start < end && found) {
+    found = false;
+    for(size_t i=0; i<num_white_characters && !found; i++) {
+      size_t length = strlen(white_characters[i]);
+      if (end - start >= length && content.compare(end - length, length, white_characters[i]) == 0) {
+        end -= length;
+        found = true;
+      }
+    }
+  }
+}
+
 bool is_html_white_character(const std::string & content, size_t offset) {
-  static const std::string nbsp = "&nbsp;";
-  if (offset < content.size()) {
+  return is_html_white_character(content.c_str(), content.size(), offset);
+}
+
+bool is_html_white_character(const char * content, size_t length, size_t offset) {
+  static const char nbsp[] = "&nbsp;";
+  static const size_t nbsp_length = sizeof(nbsp) - 1;
+  if (offset < length) {
     char c0 = content[offset + 0];
-    char c1 = content[offset + 1];
+    char c1 = (offset + 1 < length ? content[offset + 1] : '\0');
     if (c0 == ' ' || c0 == '\t' || c0 == '\n')
       return true;
     else if (c0 == '\xc2' && c1 == '\xa0')
       return true;
     else if (c0 == '\r' && c1 == '\n')
       return true;
-    else if (content.find(nbsp.c_str(), offset, nbsp.size()) == offset)
+    else if (length - offset >= nbsp_length && memcmp(content + offset, nbsp, nbsp_length) == 0)
       return true;
   }
   return false;
 }
 
 size_t get_first_nonwhite_html_character(const char * content, size_t offset) {
-  bool is_white = true;
-  while(content[offset] != '\0' && is_white) {
-    // check at this location
-    is_white = is_html_white_character(content, offset);
-    if (is_white)
-      offset++;
+  return get_first_nonwhite_html_character(content, strlen(content), offset);
+}
+
+/// <summary>
+/// Search for the first character which is not an html white character. Stops at the first null character.
+/// Multi-byte white characters such as '&nbsp;' only skip their first byte.
+/// </summary>
+size_t get_first_nonwhite_html_character(const char * content, size_t length, size_t offset) {
+  while (offset < length) {
+    // skip spaces, tabs and line feeds
+    offset = scan_for_nonwhite(content, length, offset);
+    if (offset == std::string::npos || content[offset] == '\0')
+      return std::string::npos;
+    if (!is_html_white_character(content, length, offset))
+      return offset;
+    offset++;
   }
-  if (!is_white)
-    return offset;
   return std::string::npos;
 }
 
@@ -796,7 +2126,45 @@ void decrease_indent(std::vector<std::string> & lines, size_t num_spaces) {
   }
 }
 
-std::string get_line_at_offset(std::string & content, size_t offset) {
+/// <summary>
+/// Decreases the indentation of all the lines of a text, in place. The text is left unchanged if a line is not indented.
+/// The trailing newline of the text is removed, as with split() followed by join().
+/// </summary>
+void decrease_indent(std::string & text, size_t num_spaces) {
+  if (!text.empty() && text[text.size()-1] == '\n')
+    text.erase(text.size()-1, 1);
+
+  // Check that all given lines are indented
+  size_t line_start = 0;
+  while(line_start <= text.size()) {
+    for(size_t i=0; i<num_spaces; i++) {
+      if (line_start + i >= text.size() || text[line_start + i] != ' ')
+        return; // all lines must be indented to decrease indentation
+    }
+    size_t line_end = text.find('\n', line_start);
+    if (line_end == std::string::npos)
+      break;
+    line_start = line_end + 1;
+  }
+
+  // Move the lines over their indentation
+  size_t output = 0;
+  line_start = 0;
+  while(line_start < text.size()) {
+    size_t line_end = text.find('\n', line_start);
+    if (line_end == std::string::npos)
+      line_end = text.size();
+    else
+      line_end++; // keep the newline
+    size_t length = line_end - line_start - num_spaces;
+    memmove(&text[output], &text[line_start + num_spaces], length);
+    output += length;
+    line_start = line_end;
+  }
+  text.resize(output);
+}
+
+std::string_view get_line_view_at_offset(const std::string & content, size_t offset) {
   // Find the beginning of the line
   size_t offset_begin = offset;
   while(offset_begin > 0 && content[offset_begin - 1] != '\n')
@@ -808,11 +2176,14 @@ std::string get_line_at_offset(std::string & content, size_t offset) {
     offset_end++;
 
   if (offset_begin > offset_end)
-    return std::string(); // Failed
+    return std::string_view(); // Failed
 
   size_t count = offset_end - offset_begin + 1;
-  std::string line = content.substr(offset_begin, count);
-  return line;
+  return std::string_view(content).substr(offset_begin, count);
+}
+
+std::string get_line_at_offset(std::string & content, size_t offset) {
+  return std::string(get_line_view_at_offset(content, offset));
 }
 
 bool file_exists(const char * path) {
@@ -856,7 +2227,10 @@ std::string get_temp_directory() {
   std::string temp = get_env_variable("TEMP");
   return temp;
 #else
-#error Please define how to get TEMP directory.
+  std::string temp = get_env_variable("TMPDIR");
+  if (temp.empty())
+    temp = "/tmp";
+  return temp;
 #endif
 }
 
@@ -864,7 +2238,7 @@ std::string get_file_separator() {
 #ifdef _WIN32
   return "\\";
 #else
-  return "//";
+  return "/";
 #endif
 }
 
@@ -893,21 +2267,69 @@ std::string find_argument(const char * name, int argc, char* argv[])
   return EMPTY;
 }
 
+/// <summary>
+/// Returns true if the flag argument --<name> is specified.
+/// </summary>
+bool has_argument(const char * name, int argc, char* argv[])
+{
+  if (name == NULL)
+    return false;
+
+  std::string pattern;
+  pattern += "--";
+  pattern += name;
+
+  for(int i=0; i<argc; i++) {
+    if (pattern == argv[i])
+      return true;
+  }
+
+  return false;
+}
+
+#ifndef _WIN32
+/// <summary>
+/// Appends the regular files of a directory and of its sub directories to the given list.
+/// </summary>
+void find_files_in_directory(const std::string & directory, std::vector<std::string> & files) {
+  DIR * dir = opendir(directory.c_str());
+  if (dir == NULL)
+    return;
+
+  while (struct dirent * entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name == "." || name == "..")
+      continue;
+
+    std::string path = directory + get_file_separator() + name;
+    struct stat file_status;
+    if (stat(path.c_str(), &file_status) != 0)
+      continue;
+    if (S_ISDIR(file_status.st_mode))
+      find_files_in_directory(path, files);
+    else if (S_ISREG(file_status.st_mode))
+      files.push_back(path);
+  }
+
+  closedir(dir);
+}
+#endif
+
 std::vector<std::string> get_files_in_directory(const char * directory) {
   static const std::vector<std::string> EMPTY;  
   if (directory == NULL || !dir_exists(directory))
     return EMPTY;
 
+#ifdef _WIN32
   // Get the system's TEMP directory
   std::string temp_dir = get_temp_directory();
   std::string temp_file = temp_dir + get_file_separator() + "get_files_in_directory.tmp";
 
-  bool deleted = delete_file(temp_file);
-  if (!deleted)
+  // Delete the list of the previous call, if any
+  if (file_exists(temp_file.c_str()) && !delete_file(temp_file))
     return EMPTY;
 
   // Build a command to list all files of a directory and dump the list into a file
-#ifdef _WIN32
   std::string command;
   command += "cd /d \"";
   command += directory;
@@ -929,7 +2351,12 @@ std::vector<std::string> get_files_in_directory(const char * directory) {
 
   std::vector<std::string> files = read_file_lines(temp_file.c_str());
 #else
-#error Please define a method for getting files in a directory
+  std::string path = directory;
+  while (path.size() > 1 && path[path.size() - 1] == '/')
+    path.erase(path.size() - 1);
+  std::vector<std::string> files;
+  find_files_in_directory(path, files);
+  std::sort(files.begin(), files.end());
 #endif
 
   return files;
@@ -971,157 +2398,117 @@ std::vector<std::string> read_file_lines(const char * path) {
   return lines;
 }
 
-std::string get_parent_directory(const char * path) {
-  static const std::string EMPTY;
-  if (path == NULL)
-    return EMPTY;
+/// <summary>
+/// Returns the position where the file name of a path starts, after the last file separator.
+/// </summary>
+inline size_t get_file_name_start(std::string_view path) {
+  size_t last_separator_pos = path.find_last_of(get_file_separator()[0]);
+  if (last_separator_pos == std::string::npos)
+    return 0;
+  return last_separator_pos + 1; // filename starts after the last separator
+}
 
-  std::string path_str = path;
-  std::string file_separator = get_file_separator();
-  
+std::string_view get_parent_directory_view(std::string_view path) {
   // Find the position of the last file separator character
-  size_t last_separator_pos;
-  last_separator_pos = path_str.find_last_of(file_separator[0]);
+  size_t last_separator_pos = path.find_last_of(get_file_separator()[0]);
   if (last_separator_pos == std::string::npos)
-    return EMPTY;
-  last_separator_pos--; // parent directory ends before the last separator
+    return std::string_view();
 
-  // Extract the parent directory
-  size_t count = last_separator_pos + 1;
-  std::string parent_directory = path_str.substr(0, count);
-
-  return parent_directory;
+  // The parent directory ends before the last separator
+  return path.substr(0, last_separator_pos);
 }
 
-std::string get_file_name(const char * path) {
-  static const std::string EMPTY;
-  if (path == NULL)
-    return EMPTY;
-
-  std::string path_str = path;
-  std::string file_separator = get_file_separator();
-  
-  // Find the position of the last file separator character
-  size_t last_separator_pos;
-  last_separator_pos = path_str.find_last_of(file_separator[0]);
-  if (last_separator_pos == std::string::npos)
-    last_separator_pos = 0;
-  else
-    last_separator_pos++; // filename starts after the last separator
+std::string_view get_file_name_view(std::string_view path) {
+  size_t name_start = get_file_name_start(path);
 
-  // Find the position of the last dot from last_separator_pos
-  size_t last_dot_pos;
-  last_dot_pos = path_str.find_last_of('.');
+  // Find the position of the last dot from name_start
+  size_t last_dot_pos = path.find_last_of('.');
   if (last_dot_pos == std::string::npos)
-    last_dot_pos = path_str.size();
-  else if (last_separator_pos >= last_dot_pos)
-    return EMPTY; // the last dot is before the last separator
-  else
-    last_dot_pos--; // filename ends 1 character before the last dot.
-
-  // Extract the filename
-  size_t count = last_dot_pos - last_separator_pos + 1;
-  std::string filename = path_str.substr(last_separator_pos, count);
+    last_dot_pos = path.size();
+  else if (name_start >= last_dot_pos)
+    return std::string_view(); // the last dot is before the last separator
 
-  return filename;
+  // The filename ends before the last dot
+  return path.substr(name_start, last_dot_pos - name_start);
 }
 
-std::string get_file_extension(const char * path) {
-  static const std::string EMPTY;
-  if (path == NULL)
-    return EMPTY;
-
-  std::string path_str = path;
-  std::string file_separator = get_file_separator();
-  
-  // Find the position of the last file separator character
-  size_t last_separator_pos;
-  last_separator_pos = path_str.find_last_of(file_separator[0]);
-  if (last_separator_pos == std::string::npos)
-    last_separator_pos = 0;
-  else
-    last_separator_pos++; // filename starts after the last separator
+std::string_view get_file_extension_view(std::string_view path) {
+  size_t name_start = get_file_name_start(path);
 
-  // Find the position of the last dot from last_separator_pos
-  size_t last_dot_pos;
-  last_dot_pos = path_str.find_last_of('.');
-  if (last_dot_pos == std::string::npos)
-    last_dot_pos = path_str.size();
-  else if (last_separator_pos >= last_dot_pos)
-    return EMPTY; // the last dot is before the last separator
-  else
-    last_dot_pos--; // filename ends 1 character before the last dot.
+  // Find the position of the last dot from name_start
+  size_t last_dot_pos = path.find_last_of('.');
+  if (last_dot_pos == std::string::npos || name_start >= last_dot_pos)
+    return std::string_view(); // no extension, or the last dot is before the last separator
 
-  // Extract the extension
-  last_dot_pos += 2; // extension starts after the last dot
-  if (last_dot_pos == path_str.size())
-    return EMPTY;
-  size_t count = path_str.size()-1 - last_dot_pos + 1;
-  std::string extension = path_str.substr(last_dot_pos, count);
+  // The extension starts after the last dot
+  return path.substr(last_dot_pos + 1);
+}
 
-  return extension;
+std::string_view get_file_name_with_extension_view(std::string_view path) {
+  return path.substr(get_file_name_start(path));
 }
 
-std::string get_file_name_with_extension(const char * path) {
-  static const std::string EMPTY;
+std::string get_parent_directory(const char * path) {
   if (path == NULL)
-    return EMPTY;
+    return std::string();
+  return std::string(get_parent_directory_view(path));
+}
 
-  std::string path_str = path;
-  std::string file_separator = get_file_separator();
-  
-  // Find the position of the last file separator character
-  size_t last_separator_pos;
-  last_separator_pos = path_str.find_last_of(file_separator[0]);
-  if (last_separator_pos == std::string::npos)
-    last_separator_pos = 0;
-  else
-    last_separator_pos++; // filename starts after the last separator
+std::string get_file_name(const char * path) {
+  if (path == NULL)
+    return std::string();
+  return std::string(get_file_name_view(path));
+}
 
-  // Extract the filename
-  size_t count = (path_str.size()-1) - last_separator_pos + 1;
-  std::string filenameextension = path_str.substr(last_separator_pos, count);
+std::string get_file_extension(const char * path) {
+  if (path == NULL)
+    return std::string();
+  return std::string(get_file_extension_view(path));
+}
 
-  return filenameextension;
+std::string get_file_name_with_extension(const char * path) {
+  if (path == NULL)
+    return std::string();
+  return std::string(get_file_name_with_extension_view(path));
 }
 
 bool is_sub_image_size(const char * master_path, const char * test_path) {
   if (master_path == NULL || test_path == NULL)
     return false;
 
-  std::string master_path_str = master_path;
-  std::string test_path_str = test_path;
-  std::string master_extension = get_file_extension(master_path);
+  std::string_view master_path_view = master_path;
+  std::string_view test_path_view = test_path;
+  std::string_view master_extension = get_file_extension_view(master_path_view);
   
-  // Build the file mandatory prefix
-  std::string prefix;
-  if (master_extension.empty())
-    prefix = master_path_str + "-";
-  else
-    prefix = master_path_str.substr(0, master_path_str.size() - 1 - master_extension.size());
-
-  if (test_path_str.compare(0, prefix.size(), prefix.c_str()) != 0)
-    return false; // invalid
+  // Check the file mandatory prefix
+  if (master_extension.empty()) {
+    if (test_path_view.size() <= master_path_view.size() || test_path_view.compare(0, master_path_view.size(), master_path_view) != 0 || test_path_view[master_path_view.size()] != '-')
+      return false; // invalid
+  } else {
+    std::string_view prefix = master_path_view.substr(0, master_path_view.size() - 1 - master_extension.size());
+    if (test_path_view.compare(0, prefix.size(), prefix) != 0)
+      return false; // invalid
+  }
 
   // Validate the file's postfix
-  std::string master_filename = get_file_name(master_path);
-  std::string test_filename   = get_file_name(test_path);
+  std::string_view master_filename = get_file_name_view(master_path_view);
+  std::string_view test_filename   = get_file_name_view(test_path_view);
   if (master_filename.size() > test_filename.size())
     return false; // something's wrong
-  if (test_filename.compare(0, master_filename.size(), master_filename.c_str()) != 0)
+  if (test_filename.compare(0, master_filename.size(), master_filename) != 0)
     return false; // invalid
 
   // Truncate the file from the test filename
-  test_filename.erase(0, master_filename.size());
+  test_filename.remove_prefix(master_filename.size());
   if (!test_filename.empty() && test_filename[0] == '-')
-    test_filename.erase(0, 1);
+    test_filename.remove_prefix(1);
 
   // Check that format is "000x000".
   while(!test_filename.empty() && is_digit(test_filename[0])) {
-    test_filename.erase(0, 1);
+    test_filename.remove_prefix(1);
   }
   while(!test_filename.empty() && is_digit(test_filename[test_filename.size()-1])) {
-    test_filename.erase(test_filename.size()-1, 1);
+    test_filename.remove_suffix(1);
   }
 
   if (test_filename == "x")
@@ -1137,3 +2524,38 @@ bool delete_file(const std::string & path) {
   int result = remove(path.c_str());
   return (result == 0);
 }
+
+/// <summary>
+/// Creates a directory and its missing parent directories.
+/// </summary>
+bool create_directories(const std::string & path) {
+  if (path.empty() || dir_exists(path.c_str()))
+    return true;
+
+  std::string parent = get_parent_directory(path.c_str());
+  if (!create_directories(parent))
+    return false;
+
+#ifdef _WIN32
+  int result = _mkdir(path.c_str());
+#else
+  int result = mkdir(path.c_str(), 0755);
+#endif
+  return (result == 0 || dir_exists(path.c_str()));
+}
+
+/// <summary>
+/// Returns the stream where the messages of the current thread are written. Defaults to std::cout.
+/// </summary>
+std::ostream & get_log_stream() {
+  if (log_stream == NULL)
+    return std::cout;
+  return *log_stream;
+}
+
+/// <summary>
+/// Redirects the messages of the current thread to the given stream. Use NULL to restore std::cout.
+/// </summary>
+void set_log_stream(std::ostream * stream) {
+  log_stream = stream;
+}
@@ -1,22 +1,110 @@
 #include <stdio.h>
+#include <string.h>     // memcmp, strncmp
 #include <string>
+#include <string_view>
 #include <iostream>     // std::cout
 #include <fstream>      // std::ifstream
 #include <vector>
 #include <sstream>
 #include <algorithm>    // std::min
+#include <map>
+#include <memory_resource>
+#include <optional>
 
 enum EOL_TYPE {
   EOL_TYPE_UNIX,
   EOL_TYPE_WINDOWS
 };
 
+// Temporary memory of the filters, released when the innermost scope completes. See FileArenaScope.
+std::pmr::memory_resource * get_file_arena();
+
 // Type definitions and structures
-typedef std::string HtmlTableCell;
-typedef std::vector<HtmlTableCell> HtmlTableRow;
+typedef std::pmr::string HtmlTableCell;
+typedef std::pmr::vector<HtmlTableCell> HtmlTableRow;
+typedef std::pmr::vector<size_t> HtmlTableRowWidths;
 struct HtmlTable {
   bool first_row_is_header;
-  std::vector<HtmlTableRow> rows;
+  std::pmr::vector<HtmlTableRow> rows{get_file_arena()};
+  // Display width of each cell, computed once by get_table_cell_width(). Clear it after modifying the cells.
+  mutable std::pmr::vector<HtmlTableRowWidths> widths{get_file_arena()};
+};
+
+// Identifiers of the known html tag names. See get_html_tag_id().
+enum HTML_TAG_ID {
+  HTML_TAG_ID_UNKNOWN,
+  HTML_TAG_ID_A,
+  HTML_TAG_ID_ABBR,
+  HTML_TAG_ID_AREA,
+  HTML_TAG_ID_ARTICLE,
+  HTML_TAG_ID_AUDIO,
+  HTML_TAG_ID_B,
+  HTML_TAG_ID_BASE,
+  HTML_TAG_ID_BLOCKQUOTE,
+  HTML_TAG_ID_BODY,
+  HTML_TAG_ID_BR,
+  HTML_TAG_ID_BUTTON,
+  HTML_TAG_ID_CAPTION,
+  HTML_TAG_ID_CENTER,
+  HTML_TAG_ID_CODE,
+  HTML_TAG_ID_COL,
+  HTML_TAG_ID_DD,
+  HTML_TAG_ID_DIV,
+  HTML_TAG_ID_DL,
+  HTML_TAG_ID_DT,
+  HTML_TAG_ID_EM,
+  HTML_TAG_ID_EMBED,
+  HTML_TAG_ID_FIGCAPTION,
+  HTML_TAG_ID_FIGURE,
+  HTML_TAG_ID_FONT,
+  HTML_TAG_ID_FOOTER,
+  HTML_TAG_ID_FORM,
+  HTML_TAG_ID_H1,
+  HTML_TAG_ID_H2,
+  HTML_TAG_ID_H3,
+  HTML_TAG_ID_H4,
+  HTML_TAG_ID_H5,
+  HTML_TAG_ID_H6,
+  HTML_TAG_ID_HEAD,
+  HTML_TAG_ID_HEADER,
+  HTML_TAG_ID_HR,
+  HTML_TAG_ID_HTML,
+  HTML_TAG_ID_I,
+  HTML_TAG_ID_IFRAME,
+  HTML_TAG_ID_IMG,
+  HTML_TAG_ID_INPUT,
+  HTML_TAG_ID_LABEL,
+  HTML_TAG_ID_LI,
+  HTML_TAG_ID_LINK,
+  HTML_TAG_ID_META,
+  HTML_TAG_ID_NAV,
+  HTML_TAG_ID_OBJECT,
+  HTML_TAG_ID_OL,
+  HTML_TAG_ID_P,
+  HTML_TAG_ID_PARAM,
+  HTML_TAG_ID_PRE,
+  HTML_TAG_ID_S,
+  HTML_TAG_ID_SCRIPT,
+  HTML_TAG_ID_SECTION,
+  HTML_TAG_ID_SMALL,
+  HTML_TAG_ID_SOURCE,
+  HTML_TAG_ID_SPAN,
+  HTML_TAG_ID_STRONG,
+  HTML_TAG_ID_STYLE,
+  HTML_TAG_ID_SUB,
+  HTML_TAG_ID_SUP,
+  HTML_TAG_ID_TABLE,
+  HTML_TAG_ID_TBODY,
+  HTML_TAG_ID_TD,
+  HTML_TAG_ID_TH,
+  HTML_TAG_ID_THEAD,
+  HTML_TAG_ID_TR,
+  HTML_TAG_ID_TRACK,
+  HTML_TAG_ID_U,
+  HTML_TAG_ID_UL,
+  HTML_TAG_ID_VIDEO,
+  HTML_TAG_ID_WBR,
+  NUM_HTML_TAG_IDS
 };
 
 struct HTML_TAG_INFO {
@@ -33,6 +121,105 @@ struct HTML_ATTRIBUTE_INFO {
   size_t attr_value_end;
 };
 
+// Identifiers of the html attribute names used by the filters. See get_html_attribute_id().
+enum HTML_ATTRIBUTE_ID {
+  HTML_ATTRIBUTE_ID_UNKNOWN,
+  HTML_ATTRIBUTE_ID_ALT,
+  HTML_ATTRIBUTE_ID_CLASS,
+  HTML_ATTRIBUTE_ID_COLSPAN,
+  HTML_ATTRIBUTE_ID_DATA_URL,
+  HTML_ATTRIBUTE_ID_HEIGHT,
+  HTML_ATTRIBUTE_ID_HREF,
+  HTML_ATTRIBUTE_ID_ID,
+  HTML_ATTRIBUTE_ID_ROWSPAN,
+  HTML_ATTRIBUTE_ID_SRC,
+  HTML_ATTRIBUTE_ID_STYLE,
+  HTML_ATTRIBUTE_ID_TITLE,
+  HTML_ATTRIBUTE_ID_WIDTH,
+  NUM_HTML_ATTRIBUTE_IDS
+};
+
+struct HTML_ATTRIBUTE {
+  HTML_ATTRIBUTE_ID attr_id;
+  size_t value_start;   // offset of the value, without the quotes
+  size_t value_length;
+};
+
+// The known attributes of an open tag, parsed in a single pass by parse_html_attributes().
+// Each attribute is listed once: like browsers, the first occurrence of a repeated attribute wins.
+struct HtmlAttributeTable {
+  HTML_ATTRIBUTE attributes[NUM_HTML_ATTRIBUTE_IDS];
+  size_t count;
+};
+
+enum HTML_TOKEN_TYPE {
+  HTML_TOKEN_TEXT,
+  HTML_TOKEN_OPEN,
+  HTML_TOKEN_CLOSE,
+  HTML_TOKEN_VOID
+};
+
+struct HTML_TOKEN {
+  HTML_TOKEN_TYPE type;
+  size_t start;       // offset of the first character of the token
+  size_t end;         // offset of the last character of the token
+  size_t name_start;  // offset of the tag name, for tag tokens
+  size_t name_length;
+  HTML_TAG_ID tag_id; // HTML_TAG_ID_UNKNOWN for text tokens and unknown tags
+  size_t match;       // index of the matching open or close tag token
+};
+
+// The elements of a document, identified by their matching open and close tags.
+// Tags that are not properly nested are demoted to text tokens.
+struct HtmlElementTree {
+  std::pmr::vector<HTML_TOKEN> tokens{get_file_arena()};
+};
+
+// A read-only view of a file mapped in memory.
+struct MappedFile {
+  const char * data;
+  size_t size;
+#ifdef _WIN32
+  void * file_handle;
+  void * mapping_handle;
+#endif
+};
+
+struct TEXT_PIECE {
+  bool original;      // true if the piece is a range of the original document, false if it is a range of the added text
+  size_t offset;
+  size_t length;
+};
+
+// A document buffer which records replacements without moving the rest of the document.
+// Replacements are expressed in offsets of the original document and must be recorded in increasing order.
+// The original document is left untouched until the table is flattened.
+struct PieceTable {
+  const std::string * original;
+  std::pmr::string added{get_file_arena()};
+  std::pmr::vector<TEXT_PIECE> pieces{get_file_arena()};
+  size_t original_offset; // offset of the original document following the last replacement
+  size_t length;          // length of the document, including the replacements
+};
+
+// A monotonic arena for the temporary strings and vectors of the filters. Scopes are nested: one for each file and one for each filter.
+// While a scope is alive, get_file_arena() of the thread returns the arena of the innermost scope. The memory of the arena is released
+// at once when the scope ends, which must happen after all the objects allocated from the arena are destroyed.
+// The first block of the arena is kept in a pool of the thread and reused by the next scopes.
+// Outside of a scope, get_file_arena() returns the default heap.
+struct FileArenaScope {
+  FileArenaScope();
+  ~FileArenaScope();
+
+  void * block; // first block of the arena, from the pool of the thread
+  std::pmr::monotonic_buffer_resource resource;
+  std::pmr::memory_resource * parent; // arena of the enclosing scope, if any
+};
+
+// Replacement text of decoded html entities, indexed by unicode code point.
+// Code points that are not in the mapping are written as utf-8.
+typedef std::map<unsigned int, std::string> HtmlEntityMapping;
+
 #define HTML_TAG_A          0x00000001
 #define HTML_TAG_BR         0x00000002
 #define HTML_TAG_SUB        0x00000004
@@ -47,56 +234,113 @@ bool is_text(const char c);
 bool is_numeric(const char * value);
 size_t count_character(const char * text, char character);
 size_t get_line_indentation(const char * content, size_t offset);
+size_t string_length_utf8(const char * text, size_t length);
 size_t string_length_utf8(const char * text);
 size_t string_length_utf8(const std::string & text);
-size_t string_length(const std::string & text);
+size_t string_display_width_utf8(const char * text, size_t length);
+void set_utf8_source(bool utf8);
+size_t string_length(std::string_view text);
 std::string string_center(const std::string & text, size_t length);
 std::string string_lengthen(const std::string & text, size_t length);
 size_t get_table_column_count(const HtmlTable & table);
+size_t get_table_cell_width(const HtmlTable & table, size_t row_index, size_t column_index);
 size_t get_table_column_width(const HtmlTable & table, size_t column_index);
 std::string to_markdown(const HtmlTable & table);
+EOL_TYPE normalize_newlines(const char * data, size_t size, std::string & content);
 EOL_TYPE normalize_newlines(std::string & content);
 void restore_newlines(std::string & content, EOL_TYPE eol_type);
-void search_and_replace(std::string & content, const std::string & token, const std::string & value);
-std::string load_file(const std::string & path);
+size_t find_in_buffer(const char * content, size_t length, char character, size_t offset);
+size_t find_in_buffer(const char * content, size_t length, std::string_view pattern, size_t offset);
+size_t find_in_buffer_no_case(const char * content, size_t length, std::string_view pattern, size_t offset);
+void search_and_replace(std::string & content, std::string_view token, std::string_view value);
+void append_utf8(std::string & output, unsigned int code_point);
+bool find_html_entity(const char * name, size_t length, unsigned int & code_point1, unsigned int & code_point2);
+bool parse_numeric_html_entity(const char * name, size_t length, unsigned int & code_point);
+size_t decode_html_entities(std::string & content, const HtmlEntityMapping & mapping);
+void init_piece_table(PieceTable & table, const std::string & content);
+bool replace_piece(PieceTable & table, size_t start, size_t end, std::string_view value);
+bool has_piece_table_changes(const PieceTable & table);
+void flatten_piece_table(const PieceTable & table, std::string & content);
+bool map_file(const std::string & path, MappedFile & file, std::string & error);
+void unmap_file(MappedFile & file);
+bool load_file(const std::string & path, std::string & content, std::string & error);
+size_t get_file_size(const std::string & path);
 bool save_file(const std::string & path, const std::string & content);
+bool is_file_content_equal(const std::string & path, const std::string & content);
+bool is_temp_file(const std::string & path);
+bool replace_file(const std::string & path, const std::string & content, std::string & error);
+bool sync_files(const std::vector<std::string> & paths, std::string & error);
 bool file_exists(const std::string & name);
-bool find_html_tag_boundaries(const std::string & content, const std::string & tag_name, size_t offset, HTML_TAG_INFO & info);
-bool find_html_attribute_boundaries(const std::string & content, const std::string & attr_name, size_t offset_start, size_t offset_end, HTML_ATTRIBUTE_INFO & info);
-std::string get_html_attribute_value(const std::string & content, const std::string & attr_name, const HTML_TAG_INFO & tag_info);
-std::string find_class_property(const std::string & class_value, const std::string & property_name);
+HTML_TAG_ID get_html_tag_id(const char * name, size_t length);
+const char * get_html_tag_name(HTML_TAG_ID tag_id);
+bool find_html_tag_boundaries(std::string_view content, const char * tag_name, size_t tag_name_length, size_t offset, HTML_TAG_INFO & info);
+bool find_html_tag_boundaries(std::string_view content, const std::string & tag_name, size_t offset, HTML_TAG_INFO & info);
+bool find_html_tag_boundaries(std::string_view content, HTML_TAG_ID tag_id, size_t offset, HTML_TAG_INFO & info);
+std::string_view get_html_inner_view(std::string_view content, const HTML_TAG_INFO & tag_info);
+bool find_html_attribute_boundaries(std::string_view content, std::string_view attr_name, size_t offset_start, size_t offset_end, HTML_ATTRIBUTE_INFO & info);
+std::string_view get_html_attribute_view(std::string_view content, std::string_view attr_name, const HTML_TAG_INFO & tag_info);
+std::string get_html_attribute_value(std::string_view content, std::string_view attr_name, const HTML_TAG_INFO & tag_info);
+HTML_ATTRIBUTE_ID get_html_attribute_id(const char * name, size_t length);
+void parse_html_attributes(std::string_view content, const HTML_TAG_INFO & tag_info, HtmlAttributeTable & table);
+bool has_html_attribute(const HtmlAttributeTable & table, HTML_ATTRIBUTE_ID attr_id);
+std::string_view get_html_attribute_view(std::string_view content, const HtmlAttributeTable & table, HTML_ATTRIBUTE_ID attr_id);
+std::string_view find_class_property_view(std::string_view class_value, std::string_view property_name);
+std::string find_class_property(std::string_view class_value, std::string_view property_name);
 size_t get_html_tag_indentation(const char * content, const HTML_TAG_INFO & tag_info);
 bool is_any(char c, const std::vector<char> & characters);
 bool is_any(char c, const char * characters, size_t num_characters);
 std::string read_until(const std::string & content, size_t offset, const std::vector<char> & stop_characters);
+std::string_view read_until_view(const std::string & content, size_t offset, const char * characters, size_t num_characters);
 std::string read_until(const std::string & content, size_t offset, const char * characters, size_t num_characters);
+std::string_view read_html_tag_view(const std::string & content, size_t offset);
 std::string read_html_tag(const std::string & content, size_t offset);
-bool has_inner_html_tags(const std::string & content, int ignore_html_tag_flags = HTML_TAG_BR|HTML_TAG_SUB|HTML_TAG_SUP|HTML_TAG_COMMENT);
+bool has_inner_html_tags(std::string_view content, int ignore_html_tag_flags = HTML_TAG_BR|HTML_TAG_SUB|HTML_TAG_SUP|HTML_TAG_COMMENT);
+bool has_inner_html_tags(const char * content, size_t length, int ignore_html_tag_flags = HTML_TAG_BR|HTML_TAG_SUB|HTML_TAG_SUP|HTML_TAG_COMMENT);
 bool has_inner_html_tags(const HtmlTableRow & row, int ignore_html_tag_flags = HTML_TAG_BR|HTML_TAG_SUB|HTML_TAG_SUP|HTML_TAG_COMMENT);
 bool has_inner_html_tags(const HtmlTable & table, int ignore_html_tag_flags = HTML_TAG_BR|HTML_TAG_SUB|HTML_TAG_SUP|HTML_TAG_COMMENT);
-bool has_cell_spanning(const std::string & content);
+bool has_cell_spanning(std::string_view content);
+bool is_html_void_element(HTML_TAG_ID tag_id);
+void tokenize_html(const std::string & content, std::pmr::vector<HTML_TOKEN> & tokens);
+void build_html_element_tree(const std::string & content, HtmlElementTree & tree);
+size_t get_html_max_depth(const HtmlElementTree & tree);
+size_t get_html_max_depth(const std::string & content);
+std::vector<std::string_view> split_view(std::string_view content, char split_character);
 std::vector<std::string> split(const std::string & content, char split_character);
 std::string join(const std::vector<std::string> & lines, char join_character);
+std::string_view trim_view(std::string_view text, char trim_character);
+std::string_view trim_view(std::string_view text, const char * trim_str);
 size_t trim(std::string & text, char trim_character);
 size_t trim(std::string & text, const char * trim_str);
+std::string_view trim_html_whitespace_view(std::string_view text);
 size_t trim_html_whitespace(std::string & text);
+size_t trim_html_whitespace(std::pmr::string & text);
 size_t trim_html_whitespace(HtmlTable & table);
+void find_html_whitespace_trim_range(const std::string & content, size_t & start, size_t & end);
 bool is_html_white_character(const std::string & content, size_t offset);
+bool is_html_white_character(const char * content, size_t length, size_t offset);
 size_t get_first_nonwhite_html_character(const char * content, size_t offset);
+size_t get_first_nonwhite_html_character(const char * content, size_t length, size_t offset);
 void decrease_indent(std::vector<std::string> & lines, size_t num_spaces);
+void decrease_indent(std::string & text, size_t num_spaces);
+std::string_view get_line_view_at_offset(const std::string & content, size_t offset);
 std::string get_line_at_offset(std::string & content, size_t offset);
-bool is_custom_css_class(const std::string & class_);
-bool is_division_gallery(const std::string & content, const HTML_TAG_INFO & info);
-bool parse_gallery_table(std::string & content, HtmlTable & table);
-bool parse_html_table(std::string & content, HtmlTable & table);
+bool is_custom_css_class(std::string_view class_);
+bool is_division_gallery(std::string_view content, const HTML_TAG_INFO & info);
+bool parse_gallery_table(std::string_view content, HtmlTable & table);
+bool parse_html_table(std::string_view content, HtmlTable & table);
 bool file_exists(const char * path);
 bool dir_exists(const char * path);
 std::string get_env_variable(const char * name);
 std::string get_temp_directory();
 std::string get_file_separator();
 std::string find_argument(const char * name, int argc, char* argv[]);
+bool has_argument(const char * name, int argc, char* argv[]);
 std::vector<std::string> get_files_in_directory(const char * directory);
 std::vector<std::string> read_file_lines(const char * path);
+std::string_view get_parent_directory_view(std::string_view path);
+std::string_view get_file_name_view(std::string_view path);
+std::string_view get_file_extension_view(std::string_view path);
+std::string_view get_file_name_with_extension_view(std::string_view path);
 std::string get_parent_directory(const char * path);
 std::string get_file_name(const char * path);
 std::string get_file_extension(const char * path);
@@ -104,6 +348,9 @@ std::string get_file_name_with_extension(const char * path);
 bool is_sub_image_size(const char * master_path, const char * test_path);
 void uppercase(std::string & str);
 bool delete_file(const std::string & path);
+bool create_directories(const std::string & path);
+std::ostream & get_log_stream();
+void set_log_stream(std::ostream * stream);
 
 // Functions
 template <class T>